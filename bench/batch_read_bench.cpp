@@ -0,0 +1,105 @@
+// compares the two BatchReader paths on many small files, built by CMakeLists.txt as batch_read_bench:
+//   ./batch_read_bench [files = 10000] [ticks = 100]
+// the files are created in a temporary directory, a tick re-reads all of them once
+
+#include "batch_reader.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <vector>
+
+
+namespace {
+
+	struct Result {
+		bool uring;
+		double us_per_tick;
+		double syscalls_per_tick;
+	};
+
+	Result run(std::vector<ProcFile>& files, bool use_uring, int ticks) {
+
+		BatchReader batch(use_uring);
+		for (const auto& file : files) {
+			batch.add(file);
+		}
+
+		batch.read_all(); // sets up the ring, not measured
+		auto syscalls = batch.syscalls();
+
+		auto start = std::chrono::steady_clock::now();
+		for (int tick = 0; tick != ticks; ++tick) {
+			batch.read_all();
+		}
+		double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+		// every file holds its own index, so a value read into the wrong buffer would show up here
+		for (std::size_t i = 0; i != files.size(); ++i) {
+			if (batch.get(i) != std::to_string(i) + "\n") {
+				throw std::runtime_error("Unexpected content of " + files[i].get_path());
+			}
+		}
+
+		return { batch.uses_uring(), us / ticks, static_cast<double>(batch.syscalls() - syscalls) / ticks };
+	}
+
+}
+
+
+int main(int argc, char* argv[]) {
+
+	std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+	int ticks = argc > 2 ? std::atoi(argv[2]) : 100;
+
+	// every file stays open, like the attributes of the collectors
+	rlimit limit{};
+	getrlimit(RLIMIT_NOFILE, &limit);
+	limit.rlim_cur = limit.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &limit);
+
+	char dir_template[] = "/tmp/batch_read_bench.XXXXXX";
+	if (!mkdtemp(dir_template)) {
+		std::perror("mkdtemp");
+		return 1;
+	}
+	std::string dir = dir_template;
+
+	int status = 0;
+	std::vector<ProcFile> files;
+	try {
+		files.reserve(count);
+		for (std::size_t i = 0; i != count; ++i) {
+
+			auto path = dir + "/" + std::to_string(i);
+			std::ofstream(path) << i << "\n";
+			files.emplace_back(path, 32);
+		}
+
+		for (bool use_uring : { false, true }) {
+
+			auto result = run(files, use_uring, ticks);
+			std::cout << (result.uring ? "io_uring" : "pread   ")
+				<< "  files: " << count
+				<< "  us/tick: " << result.us_per_tick
+				<< "  syscalls/tick: " << result.syscalls_per_tick << std::endl;
+		}
+	}
+	catch (const std::exception& ex) {
+		std::cerr << "Error : " << ex.what() << std::endl;
+		status = 1;
+	}
+
+	files.clear();
+	for (std::size_t i = 0; i != count; ++i) {
+		unlink((dir + "/" + std::to_string(i)).c_str());
+	}
+	rmdir(dir.c_str());
+
+	return status;
+}
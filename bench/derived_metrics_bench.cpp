@@ -0,0 +1,113 @@
+// measures DerivedMetrics::evaluate() on a synthetic batch, built by CMakeLists.txt as derived_metrics_bench:
+//   ./derived_metrics_bench [expressions = 1000] [ticks = 1000]
+// the batch has 256 cpus and 64 memory series; the expressions cycle through a ratio, an average over a range,
+// a rate and a nested arithmetic one. Allocations are counted by replacing operator new: after the first tick
+// (binding) a tick only allocates the emitted samples
+
+#include "derived_metrics.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+	std::atomic<std::uint64_t> allocations{ 0 };
+
+}
+
+
+void* operator new(std::size_t size) {
+
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+
+int main(int argc, char* argv[]) {
+
+	std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+	int ticks = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+	constexpr int CPUS = 256;
+	constexpr int MEMORY = 64;
+
+	std::vector<DerivedExpression> expressions;
+	for (std::size_t i = 0; i != count; ++i) {
+
+		auto cpu = std::to_string(i % CPUS);
+		auto first = std::to_string(i % (CPUS - 32));
+		auto spec = std::to_string(i % MEMORY);
+		const std::string texts[] = {
+			"memory.used" + spec + " / (memory.used" + spec + " + memory.free" + spec + ") * 100",
+			"avg(cpu[" + first + ".." + std::to_string(i % (CPUS - 32) + 31) + "])",
+			"rate(cpu." + cpu + ")",
+			"max(cpu." + cpu + ", 50) - abs(cpu." + cpu + " - memory.used" + spec + ") / 2",
+		};
+		expressions.push_back(DerivedExpression::compile({ { "name", "derived." + std::to_string(i) }, { "expr", texts[i % 4] } }));
+	}
+
+	DerivedMetrics derived(std::move(expressions));
+
+	std::vector<std::unique_ptr<Metric>> batch;
+	for (int cpu = 0; cpu != CPUS; ++cpu) {
+		batch.emplace_back(new CpuLoad(cpu, cpu % 100));
+	}
+	for (int spec = 0; spec != MEMORY; ++spec) {
+		batch.emplace_back(new MemoryMetric("used" + std::to_string(spec), spec + 1));
+		batch.emplace_back(new MemoryMetric("free" + std::to_string(spec), spec + 2));
+	}
+	auto samples = batch.size();
+	batch.reserve(samples + count);
+
+	auto now = std::chrono::steady_clock::now();
+	derived.evaluate(batch, now); // binds the slots, not measured
+	batch.resize(samples);
+
+	std::chrono::steady_clock::duration elapsed{};
+	std::uint64_t allocated = 0;
+	std::size_t emitted = 0;
+
+	for (int tick = 0; tick != ticks; ++tick) {
+
+		now += std::chrono::milliseconds(100);
+		for (int cpu = 0; cpu != CPUS; ++cpu) {
+			static_cast<CpuLoad&>(*batch[cpu]).load = (cpu + tick) % 100;
+		}
+
+		auto before = allocations.load(std::memory_order_relaxed);
+		auto start = std::chrono::steady_clock::now();
+		derived.evaluate(batch, now);
+		elapsed += std::chrono::steady_clock::now() - start;
+		allocated += allocations.load(std::memory_order_relaxed) - before;
+
+		emitted = batch.size() - samples;
+		batch.resize(samples);
+	}
+
+	double us = std::chrono::duration<double, std::micro>(elapsed).count() / ticks;
+	std::cout << "expressions: " << count
+		<< "  samples: " << samples
+		<< "  us/tick: " << us
+		<< "  ns/expression: " << us * 1000 / count
+		<< "  emitted/tick: " << emitted
+		<< "  allocations/tick: " << static_cast<double>(allocated) / ticks << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,108 @@
+// compares the /proc/interrupts parsers, built by CMakeLists.txt as irq_parse_bench:
+//   ./irq_parse_bench [file = tests/fixtures/proc/interrupts-256cpu] [ticks = 1000]
+// the default file is a 256-cpu /proc/interrupts in the kernel's layout (" %10u" per cpu, 288 rows). A tick
+// re-reads it and parses every row: through IrqStatsReader (the SWAR fixed-width path) and through a strtoull
+// loop, the way a straightforward reader would do it; the read alone is measured too, to subtract it
+
+#include "irq_stats.hpp"
+#include "proc_snapshot.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+	// [row][cpu] of every row with a label, the missing columns (ERR, MIS) are left 0
+	std::size_t parse_strtoull(std::string_view text, std::vector<std::uint64_t>& matrix) {
+
+		std::string_view line;
+		proc_parse::next_line(text, line);
+
+		std::size_t cpus = 0;
+		for (auto token = proc_parse::next_token(line); !token.empty(); token = proc_parse::next_token(line)) {
+			++cpus;
+		}
+
+		std::size_t rows = 0;
+		while (proc_parse::next_line(text, line)) {
+
+			auto colon = line.find(':');
+			if (colon == std::string_view::npos) continue;
+
+			matrix.resize((rows + 1) * cpus);
+			std::uint64_t* row = matrix.data() + rows * cpus;
+
+			// the line isn't null-terminated, but every line of the file ends with '\n', so strtoull stops there
+			const char* pos = line.data() + colon + 1;
+			for (std::size_t cpu = 0; cpu != cpus; ++cpu) {
+
+				char* end;
+				row[cpu] = std::strtoull(pos, &end, 10);
+				if (end == pos) {
+					std::memset(row + cpu, 0, (cpus - cpu) * sizeof(std::uint64_t));
+					break;
+				}
+				pos = end;
+			}
+			++rows;
+		}
+		return rows;
+	}
+
+	template<typename Tick>
+	void run(const char* label, ProcSnapshot& snapshot, int ticks, Tick&& tick) {
+
+		snapshot.next_tick();
+		tick(); // opens the file and allocates, not measured
+
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i != ticks; ++i) {
+			snapshot.next_tick();
+			tick();
+		}
+		double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << label << "  us/tick: " << us / ticks << std::endl;
+	}
+
+}
+
+
+int main(int argc, char* argv[]) {
+
+	std::string path = argc > 1 ? argv[1] : IRQ_FIXTURE;
+	int ticks = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+	try {
+		ProcSnapshot snapshot;
+		auto& file = snapshot.file(path, 1 << 20);
+
+		IrqStatsReader all(file, { "*" });
+		IrqStatsReader some(file, { "LOC", "*mlx5_comp1@*" });
+		std::vector<std::uint64_t> matrix;
+		std::size_t rows = 0;
+
+		const auto& rates = all.sample();
+		std::cout << path << ": " << rates.irqs.size() << " rows x " << rates.cpus.size() << " cpus" << std::endl;
+
+		run("read only              ", snapshot, ticks, [&]() { file.read(); });
+		run("strtoull, all rows     ", snapshot, ticks, [&]() { rows = parse_strtoull(file.read(), matrix); });
+		run("IrqStatsReader, all    ", snapshot, ticks, [&]() { all.sample(); });
+		run("IrqStatsReader, 2 rows ", snapshot, ticks, [&]() { some.sample(); });
+
+		if (rows != rates.irqs.size()) {
+			throw std::runtime_error("The parsers disagree on the rows: " + std::to_string(rows) + " vs " + std::to_string(rates.irqs.size()));
+		}
+	}
+	catch (const std::exception& ex) {
+		std::cerr << "Error : " << ex.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,91 @@
+// compares the sources of the network collector, built by CMakeLists.txt as net_stats_bench:
+//   ./net_stats_bench [interfaces = 4] [ticks = 1000]
+// needs root and iproute2: the bench moves into its own network namespace (with its own sysfs mount, so that
+// /sys/class/net lists the namespace's interfaces), creates `interfaces` veth ends there and samples all of
+// them through every source, then a single one of them through sysfs
+
+#include "net_stats.hpp"
+#include "proc_snapshot.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sched.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mount.h>
+#include <vector>
+
+
+namespace {
+
+	void enter_namespace() {
+
+		if (unshare(CLONE_NEWNET | CLONE_NEWNS) != 0) {
+			throw std::runtime_error(std::string("unshare: ") + std::strerror(errno) + ", run the bench as root");
+		}
+		if (mount(nullptr, "/", nullptr, MS_REC | MS_PRIVATE, nullptr) != 0 || mount("sysfs", "/sys", "sysfs", 0, nullptr) != 0) {
+			throw std::runtime_error(std::string("Failed to mount the namespace's sysfs: ") + std::strerror(errno));
+		}
+	}
+
+	// veth pairs, both ends count
+	void create_interfaces(std::size_t count) {
+
+		FILE* ip = popen("ip -batch -", "w");
+		if (!ip) {
+			throw std::runtime_error("Failed to run ip");
+		}
+		for (std::size_t i = 0; i < count; i += 2) {
+			std::fprintf(ip, "link add v%zu type veth peer name p%zu\n", i / 2, i / 2);
+		}
+		if (pclose(ip) != 0) {
+			throw std::runtime_error("Failed to create the veth interfaces");
+		}
+	}
+
+	void run(const char* label, NetSource source, const std::string& pattern, int ticks) {
+
+		ProcSnapshot snapshot;
+		NetStatsReader reader({ pattern }, source, snapshot);
+		std::vector<NetRates> rates;
+
+		snapshot.next_tick();
+		reader.sample(rates); // the first tick opens the files, not measured
+
+		auto start = std::chrono::steady_clock::now();
+		for (int tick = 0; tick != ticks; ++tick) {
+
+			rates.clear();
+			snapshot.next_tick();
+			reader.sample(rates);
+		}
+		double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << label << "  interfaces: " << rates.size() << "  us/tick: " << us / ticks << std::endl;
+	}
+
+}
+
+
+int main(int argc, char* argv[]) {
+
+	std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+	int ticks = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+	try {
+		enter_namespace();
+		create_interfaces(count);
+
+		run("netlink       ", NetSource::netlink, "*", ticks);
+		run("procfs        ", NetSource::procfs, "*", ticks);
+		run("sysfs         ", NetSource::sysfs, "*", ticks);
+		run("sysfs, one    ", NetSource::sysfs, "v0", ticks);
+	}
+	catch (const std::exception& ex) {
+		std::cerr << "Error : " << ex.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
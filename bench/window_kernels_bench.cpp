@@ -0,0 +1,152 @@
+// compares the window_kernels implementations, built by CMakeLists.txt as window_kernels_bench:
+//   ./window_kernels_bench [series = 256] [ticks = 600] [windows = 200] [baseline series = 100000]
+// accumulate(): a window folds `ticks` columns of `series` values (every 50th value is missing) into
+// min/max/sum/sumsq; update(): `ticks` columns of a seasonal signal with spikes go through the Holt-Winters
+// baselines of `baseline series` series. That they return bit-for-bit the results of the scalar one is checked
+// by tests/window_kernels_test.cpp
+
+#include "window_kernels.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+	struct Stats {
+
+		explicit Stats(std::size_t series)
+			: min(series, std::numeric_limits<double>::infinity())
+			, max(series, -std::numeric_limits<double>::infinity())
+			, sum(series, 0)
+			, sumsq(series, 0)
+		{}
+
+		std::vector<double> min, max, sum, sumsq;
+	};
+
+	// one window, tick after tick, as the Aggregator does it
+	Stats fold(window_kernels::Accumulate accumulate, const std::vector<double>& columns, std::size_t series) {
+
+		Stats stats(series);
+		for (std::size_t offset = 0; offset != columns.size(); offset += series) {
+			accumulate(columns.data() + offset, series, stats.min.data(), stats.max.data(), stats.sum.data(), stats.sumsq.data());
+		}
+		return stats;
+	}
+
+
+	struct Baselines {
+
+		explicit Baselines(std::size_t series, std::size_t phases)
+			: level(series), trend(series), season(series * phases), var(series), seen(series), forecast(series), score(series)
+		{}
+
+		std::vector<double> level, trend, season, var, seen, forecast, score;
+		std::size_t flagged = 0;
+	};
+
+	constexpr std::size_t PHASES = 12;
+
+	// the tick's value of every series: a season of PHASES ticks, noise, a spike now and then, some missing values
+	void fill(std::vector<double>& values, std::size_t tick) {
+
+		for (std::size_t i = 0; i != values.size(); ++i) {
+
+			auto h = (i * 2654435761u + tick * 40503u) % 1000;
+			double value = 10 * static_cast<double>((tick + i) % PHASES) + static_cast<double>(h) / 100;
+			values[i] = h == 7 ? std::numeric_limits<double>::quiet_NaN() : h == 3 ? value + 500 : value;
+		}
+	}
+
+	// the time of the update() calls only
+	double run_baselines(window_kernels::Update update, Baselines& state, const std::vector<std::vector<double>>& ticks) {
+
+		const window_kernels::BaselineParams params{ 0.1, 0.01, 0.2, 9, 0.01, 24 };
+		auto series = state.level.size();
+
+		std::chrono::steady_clock::duration elapsed{};
+		for (std::size_t tick = 0; tick != ticks.size(); ++tick) {
+
+			window_kernels::BaselineColumns columns{ state.level.data(), state.trend.data(), state.season.data() + tick % PHASES * series
+				, state.var.data(), state.seen.data(), state.forecast.data(), state.score.data() };
+
+			auto start = std::chrono::steady_clock::now();
+			update(ticks[tick].data(), series, params, columns);
+			elapsed += std::chrono::steady_clock::now() - start;
+
+			state.flagged += static_cast<std::size_t>(std::count_if(state.score.begin(), state.score.end(), [](double score) { return score != 0; }));
+		}
+		return std::chrono::duration<double, std::micro>(elapsed).count();
+	}
+
+}
+
+
+int main(int argc, char* argv[]) {
+
+	std::size_t series = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+	std::size_t ticks = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 600;
+	int windows = argc > 3 ? std::atoi(argv[3]) : 200;
+	std::size_t baseline_series = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 100000;
+
+	// per-core loads in percent with some negative and missing values, so the NaN lanes and the tails are checked
+	std::mt19937_64 random(42);
+	std::normal_distribution<double> load(50, 30);
+	std::vector<double> columns(series * ticks);
+	for (std::size_t i = 0; i != columns.size(); ++i) {
+		columns[i] = i % 50 == 7 ? std::numeric_limits<double>::quiet_NaN() : load(random);
+	}
+
+	std::cout << "best: " << window_kernels::name(window_kernels::best()) << std::endl;
+
+	for (auto isa : { window_kernels::Isa::scalar, window_kernels::Isa::sse4, window_kernels::Isa::avx2 }) {
+
+		auto accumulate = window_kernels::get(isa);
+		if (!accumulate || isa > window_kernels::best()) {
+			std::cout << window_kernels::name(isa) << "  not supported" << std::endl;
+			continue;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		for (int window = 0; window != windows; ++window) {
+			fold(accumulate, columns, series);
+		}
+		double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << window_kernels::name(isa)
+			<< "  series: " << series
+			<< "  ticks: " << ticks
+			<< "  us/window: " << us / windows
+			<< "  ns/sample: " << us * 1000 / windows / columns.size() << std::endl;
+	}
+
+	std::vector<std::vector<double>> baseline_ticks(ticks, std::vector<double>(baseline_series));
+	for (std::size_t tick = 0; tick != ticks; ++tick) {
+		fill(baseline_ticks[tick], tick);
+	}
+
+	for (auto isa : { window_kernels::Isa::scalar, window_kernels::Isa::avx2 }) {
+
+		auto update = window_kernels::get_update(isa);
+		if (!update || isa > window_kernels::best()) {
+			std::cout << "update " << window_kernels::name(isa) << "  not supported" << std::endl;
+			continue;
+		}
+
+		Baselines state(baseline_series, PHASES);
+		double us = run_baselines(update, state, baseline_ticks);
+
+		std::cout << "update " << window_kernels::name(isa)
+			<< "  series: " << baseline_series
+			<< "  us/tick: " << us / ticks
+			<< "  ns/series: " << us * 1000 / ticks / baseline_series
+			<< "  flagged: " << state.flagged << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,77 @@
+// an example collector plugin reporting /proc/loadavg, built as a MODULE library by CMakeLists.txt:
+// { "type": "plugin", "path": "./libloadavg_plugin.so", "config": { "path": "/proc/loadavg" } }
+
+#include "plugin_abi.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+
+namespace {
+
+	struct State {
+		std::string path;
+	};
+
+	void* init(const char* config_json, char* error, size_t error_size) {
+
+		// the config is tiny, a real plugin would use a JSON parser here
+		std::string config(config_json);
+		std::string path = "/proc/loadavg";
+
+		auto key = config.find("\"path\"");
+		if (key != std::string::npos) {
+
+			auto begin = config.find('"', config.find(':', key));
+			auto end = config.find('"', begin + 1);
+			if (begin == std::string::npos || end == std::string::npos) {
+				std::snprintf(error, error_size, "'path' must be a string");
+				return nullptr;
+			}
+			path = config.substr(begin + 1, end - begin - 1);
+		}
+
+		return new (std::nothrow) State{path};
+	}
+
+	int collect(void* state, sm_sample* samples, size_t capacity, char* error, size_t error_size) {
+
+		auto* self = static_cast<State*>(state);
+
+		std::FILE* file = std::fopen(self->path.c_str(), "r");
+		if (!file) {
+			std::snprintf(error, error_size, "can't open %s: %s", self->path.c_str(), std::strerror(errno));
+			return -1;
+		}
+
+		double load[3] = {};
+		int read = std::fscanf(file, "%lf %lf %lf", &load[0], &load[1], &load[2]);
+		std::fclose(file);
+
+		if (read != 3) {
+			std::snprintf(error, error_size, "unexpected content of %s", self->path.c_str());
+			return -1;
+		}
+
+		const char* names[3] = { "load1", "load5", "load15" };
+		size_t count = capacity < 3 ? capacity : 3;
+		for (size_t i = 0; i != count; ++i) {
+			std::snprintf(samples[i].name, sizeof(samples[i].name), "%s", names[i]);
+			samples[i].value = load[i];
+		}
+		return static_cast<int>(count);
+	}
+
+	void destroy(void* state) {
+		delete static_cast<State*>(state);
+	}
+
+	const sm_plugin plugin = { SM_PLUGIN_ABI_VERSION, "loadavg", init, collect, destroy };
+
+}
+
+
+extern "C" const sm_plugin* sm_plugin_entry(void) {
+	return &plugin;
+}
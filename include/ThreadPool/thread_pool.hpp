@@ -22,17 +22,7 @@ struct StaticThreadPool {
 		for(std::size_t i = 0; i != count_threads; ++i) {
 
 			try {
-				workers.emplace_back([this]{
-
-					while(is_active.load()) {
-						
-						Task task;
-						tasks.wait_and_pop(task);
-
-						task();
-					}
-
-				});
+				workers.emplace_back([this]{ work(); });
 			} catch(...) {
 
 				is_active.store(false);
@@ -56,6 +46,20 @@ struct StaticThreadPool {
 	StaticThreadPool& operator=(const StaticThreadPool&) = delete;
 
 
+	std::size_t size() const {
+		return workers.size();
+	}
+
+	// starts workers until there are count_threads, the running ones aren't interrupted; if starting one fails,
+	// those started so far stay
+	void grow(std::size_t count_threads) {
+
+		while (workers.size() < count_threads) {
+			workers.emplace_back([this]{ work(); });
+		}
+	}
+
+
 	template<typename F, typename... Args>
 	auto submit(F&& f, Args&&... args) -> std::future<std::invoke_result_t<F, Args...>>
 	{
@@ -91,6 +95,18 @@ struct StaticThreadPool {
 
 private:
 
+	void work() {
+
+		while(is_active.load()) {
+
+			Task task;
+			tasks.wait_and_pop(task);
+
+			task();
+		}
+	}
+
+
 	std::vector<std::thread> workers;
 	thread_safe_queue<Task> tasks;
 	std::atomic_bool is_active;
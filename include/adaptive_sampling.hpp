@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <vector>
+#include "metrics.hpp"
+
+using json = nlohmann::json;
+
+
+// the "adaptive" field of a "metrics" entry:
+//   { "type": "cpu", "ids": [0], "adaptive": { "min": 0.5, "max": 30, "change": 0.05, "min_change": 5, "thresholds": [80, 95] } }
+// the collector's interval halves (down to "min" seconds) when one of its values has moved since its previous
+// sample by more than "change" (relative) and more than "min_change" (absolute, 0 by default, so that the jitter
+// of an idle cpu around 1% doesn't count), drops to "min" at once when a value crosses one of the "thresholds",
+// and grows by half (up to "max") when all of them are flat
+struct AdaptiveOptions {
+
+	static AdaptiveOptions parse(const json& adaptive);
+
+	std::chrono::milliseconds min;
+	std::chrono::milliseconds max;
+	double change = 0.05;
+	double min_change = 0;
+	std::vector<double> thresholds;
+};
+
+
+// when one collector runs next: every "settings.period" without options, otherwise at an interval adapted to
+// the collector's last samples. The run() loop sleeps until the earliest due schedule and runs the due collectors
+struct CollectorSchedule {
+
+	CollectorSchedule(std::chrono::milliseconds period, std::optional<AdaptiveOptions> options);
+
+	bool due(std::chrono::steady_clock::time_point now) const {
+		return now >= next;
+	}
+
+	std::chrono::steady_clock::time_point next_run() const {
+		return next;
+	}
+
+	// the interval the collector's current samples were taken at
+	std::chrono::milliseconds interval() const {
+		return current;
+	}
+
+	bool adaptive() const {
+		return options.has_value();
+	}
+
+	// after the collector has run at `now`: adapts the interval to the samples and schedules the next run
+	void update(const std::vector<std::unique_ptr<Metric>>& samples, std::chrono::steady_clock::time_point now);
+
+private:
+
+	std::optional<AdaptiveOptions> options;
+	std::chrono::milliseconds current;
+	std::chrono::steady_clock::time_point next; // the first run is due at once
+	std::vector<double> previous; // the values of the last run, by position
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "metrics.hpp"
+#include "quantile_sketch.hpp"
+
+
+// the stage between collect_metrics() and output_metrics() when "settings.aggregation" is configured: every
+// sample goes into the quantile sketch of its series and into the window's min/max/sum/sumsq columns, and once
+// per window the outputs get min/mean/stddev/p50/p90/p99/max of each series instead of the raw samples, e.g.
+// sampling every 100 ms and writing once a minute
+struct Aggregator {
+
+	Aggregator(std::chrono::milliseconds window, double accuracy);
+
+	void add(const std::vector<std::unique_ptr<Metric>>& metrics);
+
+	bool window_ended(std::chrono::steady_clock::time_point now) const {
+		return now - window_start >= window;
+	}
+
+	// the statistics of the series that got samples during the window, in the order they first appeared;
+	// the sketches start over (keeping their memory) and the series without a sample are forgotten
+	std::vector<std::unique_ptr<Metric>> flush(std::chrono::steady_clock::time_point now);
+
+private:
+
+	struct Series {
+		std::string name;
+		QuantileSketch sketch;
+	};
+
+	std::size_t find_series(const std::string& name);
+
+private:
+
+	std::chrono::milliseconds window;
+	double accuracy;
+	std::chrono::steady_clock::time_point window_start;
+	std::vector<Series> series;
+	std::unordered_map<std::string, std::size_t> index; // name -> position in `series`
+	std::vector<std::size_t> positions; // the series of the i-th sample of the last tick, checked by name every tick
+
+	// columnar, indexed like `series`: a tick gathers its samples into `column` (NaN for a series without one)
+	// and folds it into the statistics with one window_kernels::accumulate() call
+	std::vector<double> column;
+	std::vector<double> min;
+	std::vector<double> max;
+	std::vector<double> sum;
+	std::vector<double> sumsq;
+};
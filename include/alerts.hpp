@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+#include "metrics.hpp"
+#include "series_slots.hpp"
+
+using json = nlohmann::json;
+
+
+// an entry of the "alerts" array of the config:
+//   { "name": "cpu0_hot", "series": "cpu.0", "above": 95, "clear": 90, "for": 30 }
+//   { "name": "faults", "series": "vmstat.pgfault", "kind": "rate", "above": 1000 }
+// "kind" is "threshold" (the value itself, the default) or "rate" (its change per second); the rule breaches
+// "above" or "below" its threshold. It fires once the breach has lasted "for" seconds (0 by default) and resolves
+// only when the value is back past "clear" (the threshold by default), so a value hovering around the threshold
+// doesn't flap
+struct AlertRule {
+
+	enum class Kind { threshold, rate };
+
+	static AlertRule parse(const json& alert);
+
+	std::string name;
+	std::string series;
+	Kind kind = Kind::threshold;
+	bool above = true; // false for "below"
+	double threshold = 0;
+	double clear = 0;
+	std::chrono::milliseconds duration{0};
+};
+
+
+// the stage after the derived metrics: every tick each rule looks at one slot and moves between inactive,
+// pending (breached for less than its duration) and firing; the transitions to firing and back are returned as
+// AlertEvent samples for the outputs. O(rules) per tick, no history is kept
+struct Alerts {
+
+	explicit Alerts(std::vector<AlertRule> rules);
+
+	bool empty() const {
+		return rules.empty();
+	}
+
+	// the events of the tick, usually none
+	std::vector<std::unique_ptr<Metric>> evaluate(const std::vector<std::unique_ptr<Metric>>& metrics, std::chrono::steady_clock::time_point now);
+
+private:
+
+	enum class State : std::uint8_t { inactive, pending, firing };
+
+	struct Rule {
+		AlertRule config;
+		std::size_t slot;
+		State state = State::inactive;
+		std::chrono::steady_clock::time_point since{}; // of the breach
+		double last = 0; // the previous value and its time, for "rate"
+		std::chrono::steady_clock::time_point last_time{};
+		bool has_last = false;
+	};
+
+	// the value the rule compares, NaN if there is none this tick
+	static double observe(Rule& rule, double value, std::chrono::steady_clock::time_point now);
+
+private:
+
+	std::vector<Rule> rules;
+	SeriesSlots slots;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "metrics.hpp"
+#include "window_kernels.hpp"
+
+
+// the options of "settings.anomaly", see AnomalyDetector
+struct AnomalyOptions {
+
+	std::vector<std::string> series{ "*" }; // glob patterns of the watched series
+	double alpha = 0.1;
+	double k = 3;
+	double min_sigma = 0.001;
+	double warmup = 30; // samples
+	std::size_t season = 0; // periods in a season, 0 for a plain EWMA
+	std::chrono::milliseconds period{ 1000 }; // "settings.period", the length of a phase of the season
+	double beta = 0;
+	double gamma = 0.1;
+};
+
+
+// the optional stage that flags samples far from their series' baseline: an EWMA of the mean and the variance
+// of every watched series, or with a "season" a Holt-Winters forecast (level + trend + the seasonal component
+// of the tick's phase). A sample more than k sigma from the forecast becomes an AnomalyEvent.
+//
+// The state is kept in flat arrays indexed by series position, parallel to the tick's column of values, and the
+// whole column is updated by one window_kernels::update() call (AVX2 where available); a season of m ticks
+// keeps m seasonal components per series, 8 * m bytes. The phase is the number of periods elapsed since the
+// first tick, not of ticks, which come at the adaptive collectors' pace when some are configured. A series
+// without a sample for a season (at least FORGET_AFTER) is forgotten, its baseline would be stale by then
+struct AnomalyDetector {
+
+	explicit AnomalyDetector(const AnomalyOptions& options);
+
+	// the events of the tick, usually none
+	std::vector<std::unique_ptr<Metric>> evaluate(const std::vector<std::unique_ptr<Metric>>& metrics, std::chrono::steady_clock::time_point now);
+
+private:
+
+	static constexpr std::size_t IGNORED = SIZE_MAX;
+
+	static constexpr std::chrono::minutes FORGET_AFTER{ 10 };
+
+	// the position of the series in the columns, IGNORED if it isn't watched; remembered for every name seen
+	std::size_t find_series(const std::string& name);
+
+	// drops the series last seen before `time` with their columns, keeping the order of the rest
+	void forget(std::chrono::steady_clock::time_point time);
+
+private:
+
+	std::vector<std::string> patterns;
+	window_kernels::BaselineParams params;
+	std::size_t phases; // 1 without a season
+	std::chrono::milliseconds period;
+	std::optional<std::chrono::steady_clock::time_point> start; // of the first tick, phase 0
+	std::chrono::steady_clock::duration horizon; // how long a series is kept without a sample
+	std::chrono::steady_clock::time_point next_sweep;
+
+	std::vector<std::string> known; // every series name seen so far
+	std::vector<std::size_t> known_slots; // parallel to known: the column position or IGNORED
+	std::vector<std::chrono::steady_clock::time_point> seen_at; // parallel to known: its last tick
+	std::unordered_map<std::string, std::size_t> index; // name -> position in `known`
+	std::vector<std::size_t> positions; // the `known` entry of the i-th sample of the last tick, checked by name
+
+	std::vector<std::string> names; // parallel to the columns
+	std::vector<double> column; // the tick's values, NaN for a series without a sample
+	std::vector<double> level;
+	std::vector<double> trend;
+	std::vector<std::vector<double>> season; // [phase][series]
+	std::vector<double> var;
+	std::vector<double> seen;
+	std::vector<double> forecast;
+	std::vector<double> score;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "proc_file.hpp"
+
+
+// re-reads a fixed set of small attribute files (sysfs, /proc/<pid>/...) at offset 0 every tick. With io_uring
+// the reads of a tick are queued in one submission ring and sent to the kernel with a single io_uring_enter per
+// ring-full (up to 4096 files), reading into one registered buffer through registered fds; without it (old
+// kernels, seccomp filters that block io_uring) every file costs one pread, the same as ProcFile::read_attribute()
+struct BatchReader {
+
+	// `use_uring` = false forces the pread path, e.g. to compare the two
+	explicit BatchReader(bool use_uring = true);
+
+	BatchReader(const BatchReader&) = delete;
+
+	BatchReader& operator=(const BatchReader&) = delete;
+
+	~BatchReader();
+
+	// registers an open file, which must stay open while it is registered; a value longer than `capacity`
+	// is truncated. Returns the index for get()
+	std::size_t add(const ProcFile& file, std::size_t capacity = 32);
+
+	// forgets all the files, e.g. when the set of interfaces has changed
+	void clear();
+
+	// reads every registered file, throws std::runtime_error if one of the reads fails
+	void read_all();
+
+	// the content of the index-th file from the last read_all(), valid until the next one
+	std::string_view get(std::size_t index) const {
+		return std::string_view(arena.data() + entries[index].offset, entries[index].size);
+	}
+
+	std::size_t size() const {
+		return entries.size();
+	}
+
+	// whether the last read_all() went through io_uring
+	bool uses_uring() const {
+		return ring_fd >= 0;
+	}
+
+	// the read syscalls (pread or io_uring_enter) made by read_all() so far
+	std::uint64_t syscalls() const {
+		return syscall_count;
+	}
+
+private:
+
+	struct Entry {
+		int fd;
+		std::string path;
+		std::size_t offset; // of the buffer in the arena
+		std::size_t capacity;
+		std::size_t size; // read by the last read_all()
+	};
+
+	// (re)creates the ring for the current set of files, falls back to pread if that fails
+	void setup_ring();
+
+	void close_ring();
+
+	void read_with_pread();
+
+	void read_with_uring();
+
+	[[noreturn]] void fail(const Entry& entry, int error) const;
+
+private:
+
+	bool use_uring;
+	bool dirty = true; // the files have changed since the ring was set up
+	std::vector<Entry> entries;
+	std::vector<char> arena; // the buffers of all the files, registered with the ring as a single fixed buffer
+	std::uint64_t syscall_count = 0;
+
+	// io_uring state, ring_fd = -1 when the pread path is used
+	int ring_fd = -1;
+	bool fixed_buffer = false;
+	bool fixed_files = false;
+	void* sq_ring = nullptr;
+	std::size_t sq_ring_size = 0;
+	void* cq_ring = nullptr; // == sq_ring with IORING_FEAT_SINGLE_MMAP
+	std::size_t cq_ring_size = 0;
+	void* sqes = nullptr;
+	std::size_t sqes_size = 0;
+	unsigned sq_entries = 0;
+	unsigned* sq_tail = nullptr;
+	unsigned* sq_mask = nullptr;
+	unsigned* sq_array = nullptr;
+	unsigned* cq_head = nullptr;
+	unsigned* cq_tail = nullptr;
+	unsigned* cq_mask = nullptr;
+	void* cqes = nullptr;
+};
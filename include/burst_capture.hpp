@@ -0,0 +1,117 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+#include "metrics.hpp"
+
+using json = nlohmann::json;
+
+
+// "settings.burst":
+//   { "path": "/var/log/monitor-burst", "rate": 0.1, "before": 60, "after": 10, "memory": 16,
+//     "alerts": ["*"], "socket": "/run/monitor.sock" }
+// every collector is sampled each "rate" seconds and the raw batches are kept in memory; on a trigger the
+// batches of the last "before" seconds and those of the next "after" seconds are written to "<path>-<time>.jsonl".
+// The stages after the capture still see one batch a period, the mean of the batches recorded during it
+struct BurstOptions {
+
+	static BurstOptions parse(const json& burst);
+
+	std::string path; // the prefix of the burst files
+	std::chrono::milliseconds rate{ 100 };
+	std::chrono::milliseconds before{ 60000 };
+	std::chrono::milliseconds after{ 10000 };
+	std::size_t memory = 16 << 20; // bytes, "memory" is given in MB
+	std::vector<std::string> alerts{ "*" }; // glob patterns of the alerts whose firing triggers a capture
+	std::string socket; // the control socket, none if empty
+};
+
+
+// the pre-trigger ring of raw batches and the burst files written from it. Triggers: the firing of a matching
+// alert, SIGUSR1, or a "burst [reason]" datagram on the control socket (socat - UNIX-SENDTO:/run/monitor.sock).
+//
+// The ring is one buffer of "memory" bytes allocated up front and never grown: a batch is stored as its time,
+// its layout and its values, 8 bytes each, and the oldest batches are dropped to make room for a new one. The
+// series names are kept once per batch layout, for at most MAX_LAYOUTS layouts, outside of that budget. A batch
+// larger than the whole ring is neither kept nor written to a running burst file, it only goes into the means
+struct BurstCapture {
+
+	explicit BurstCapture(const BurstOptions& options);
+
+	~BurstCapture();
+
+	BurstCapture(const BurstCapture&) = delete;
+
+	BurstCapture& operator=(const BurstCapture&) = delete;
+
+	// stores the tick's raw batch, checks the signal and the socket, and writes the batch to the burst file if
+	// a capture is running
+	void record(const std::vector<std::unique_ptr<Metric>>& metrics);
+
+	// replaces the values of the tick's batch, the last one recorded, with the means of the batches recorded since
+	// the previous call (or since the layout last changed), and starts the next means
+	void take_means(std::vector<std::unique_ptr<Metric>>& metrics);
+
+	// starts a capture if one of the events is a matching alert that has just fired
+	void check_events(const std::vector<std::unique_ptr<Metric>>& events);
+
+private:
+
+	static constexpr std::size_t MAX_LAYOUTS = 8;
+
+	static constexpr std::size_t OVERSIZED = SIZE_MAX - 1; // the layout of a batch that doesn't fit in the ring
+
+	struct Layout {
+		std::vector<std::string> names;
+		std::size_t records = 0; // the records in the ring that use the layout
+	};
+
+	// the index of the batch's layout, adding it (and dropping the oldest records if all slots are in use) if new
+	std::size_t find_layout(const std::vector<std::unique_ptr<Metric>>& metrics);
+
+	bool same_layout(const Layout& layout, const std::vector<std::unique_ptr<Metric>>& metrics) const;
+
+	void drop_oldest();
+
+	std::uint64_t word(std::size_t i) const {
+		return ring[(head + i) % ring.size()];
+	}
+
+	void poll_triggers();
+
+	void trigger(const std::string& reason);
+
+	// appends one record to the open burst file: a "series" line first if the layout differs from the last one
+	void write(std::int64_t time, std::size_t layout, const std::vector<double>& values);
+
+private:
+
+	BurstOptions options;
+
+	std::vector<std::uint64_t> ring; // [time ns][layout << 32 | count][values...], wrapping around word by word
+	std::size_t head = 0; // the first word of the oldest record
+	std::size_t used = 0; // words
+	std::size_t records = 0;
+	std::vector<Layout> layouts;
+	std::size_t current = SIZE_MAX; // the layout of the last batch
+	bool too_large_warned = false;
+
+	int socket_fd = -1;
+	std::uint64_t socket_inode = 0; // of the socket file this capture bound
+
+	std::vector<double> values; // scratch, the values of one record
+
+	std::vector<double> sums; // of the batches since take_means(), parallel to the last batch
+	std::vector<std::uint32_t> counts; // the samples in sums, NaN isn't counted
+	std::size_t summed_layout = SIZE_MAX;
+	Layout oversized; // the names of the last batch too large for the ring, checked by name every tick
+
+	std::ofstream file;
+	std::int64_t until = 0; // the end of the running capture, the system clock in nanoseconds like the records
+	std::size_t written_layout = SIZE_MAX;
+};
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "metrics.hpp"
+#include "proc_snapshot.hpp"
+#include "self_stats.hpp"
+
+using json = nlohmann::json;
+
+struct StaticThreadPool;
+
+
+// the metrics one collector produced during a tick
+struct SampleBatch {
+
+	template<typename M, typename... Args>
+	void add(Args&&... args) {
+		metrics.emplace_back(new M(std::forward<Args>(args)...));
+	}
+
+	std::vector<std::unique_ptr<Metric>> metrics;
+
+	// set by a collector whose series differ from its previous batch in something other than the values (a disk,
+	// an interface or a listener came or went); the stages that bind series to batch positions then check the names
+	bool layout_changed = false;
+};
+
+
+// the identities of the series a collector reported on its last tick (device names, mount points, ...), compared
+// with the tick's ones in place, so an unchanged set costs a few comparisons and no allocation
+template<typename Key>
+struct SeriesKeys {
+
+	// true if the keys of `range` differ from those of the previous call
+	template<typename Range, typename KeyOf>
+	bool changed(const Range& range, KeyOf&& key_of) {
+		return changed(std::begin(range), std::end(range), std::forward<KeyOf>(key_of));
+	}
+
+	template<typename It, typename KeyOf>
+	bool changed(It first, It last, KeyOf&& key_of) {
+
+		bool changed = false;
+		std::size_t i = 0;
+		for (; first != last; ++first) {
+
+			const auto& key = key_of(*first);
+			if (i == keys.size()) {
+				keys.emplace_back(key);
+				changed = true;
+			}
+			else if (!(keys[i] == key)) {
+				keys[i] = key;
+				changed = true;
+			}
+			++i;
+		}
+		if (i != keys.size()) {
+			keys.resize(i);
+			changed = true;
+		}
+		return changed;
+	}
+
+	std::vector<Key> keys;
+};
+
+
+// what the monitor hands to the collectors in prepare()
+struct CollectorContext {
+
+	ProcSnapshot& snapshot; // the /proc files shared by the collectors
+	SelfStats& self; // the monitor's own latencies
+};
+
+
+// one entry of the "metrics" array of the config: configure() validates the json once and keeps the options
+// in typed fields, prepare() opens the files and builds the tables, collect() is then called every tick;
+// /proc files that several collectors read are taken from the snapshot, so they are read once per tick
+struct Collector {
+
+	virtual ~Collector() = default;
+
+	// throws std::runtime_error with a message for the user if the entry is invalid
+	virtual void configure(const json& metric) = 0;
+
+	virtual void prepare(CollectorContext&) {}
+
+	virtual void collect(SampleBatch& batch) = 0;
+
+	// collectors that submit tasks to the pool themselves return how many workers those tasks may hold;
+	// the pool gets that many extra threads, start() is called on the monitor thread at the beginning of
+	// the tick and collect() runs there as well, since a worker waiting for tasks queued behind it could stall the pool
+	virtual std::size_t own_workers() const {
+		return 0;
+	}
+
+	virtual void start(StaticThreadPool&) {}
+
+	std::string type; // the "type" of the config entry, set by CollectorRegistry::create()
+};
+
+
+// the metric types known to the monitor, every collector registers itself with REGISTER_COLLECTOR
+// in its own translation unit, so adding a type doesn't touch the config or the monitor
+struct CollectorRegistry {
+
+	using Factory = std::function<std::unique_ptr<Collector>()>;
+
+	static void add(const std::string& type, Factory factory);
+
+	// throws std::runtime_error for an unknown type
+	static std::unique_ptr<Collector> create(const std::string& type);
+
+private:
+
+	static std::map<std::string, Factory>& factories();
+};
+
+
+template<typename T>
+struct CollectorRegistrar {
+
+	explicit CollectorRegistrar(const char* type) {
+		CollectorRegistry::add(type, [] { return std::make_unique<T>(); });
+	}
+};
+
+#define REGISTER_COLLECTOR(type, Class) \
+	static const CollectorRegistrar<Class> registrar_##Class(type)
+
+
+// validation helpers shared by the collectors' configure()
+
+namespace collector_config {
+
+	// throws `error` unless metric[field] is an array of strings
+	void validate_string_array(const json& metric, const char* field, const std::string& error);
+
+	// metric[field] or `fallback` if the field is absent; throws `error` unless it is an array of strings
+	std::vector<std::string> strings(const json& metric, const char* field, const std::string& error, std::vector<std::string> fallback = {});
+
+	// metric[field] or an empty vector if the field is absent; throws `error` unless it is an array of integers
+	std::vector<int> ints(const json& metric, const char* field, const std::string& error);
+
+	// the "spec" array resolved against a table of the known specs, in the configured order;
+	// the whole table if there is no "spec" field
+	template<typename T>
+	std::vector<std::pair<std::string, T>> select_specs(const json& metric, const std::vector<std::pair<std::string, T>>& known
+		, const std::string& type, const std::string& error)
+	{
+		if (!metric.contains("spec")) {
+			return known;
+		}
+		validate_string_array(metric, "spec", error);
+
+		std::vector<std::pair<std::string, T>> selected;
+		for (const auto& spec : metric["spec"]) {
+
+			const auto& name = spec.get_ref<const std::string&>();
+			auto it = std::find_if(known.begin(), known.end(), [&](const auto& entry) { return entry.first == name; });
+			if (it == known.end()) {
+				throw std::runtime_error("Unknown " + type + " spec: " + name);
+			}
+			selected.push_back(*it);
+		}
+		return selected;
+	}
+
+}
@@ -1,10 +1,23 @@
 #pragma once
 
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
 #include <stdexcept>
 #include <nlohmann/json.hpp>
 #include <vector>
 #include <fstream>
+#include <limits>
+#include "adaptive_sampling.hpp"
+#include "alerts.hpp"
+#include "anomaly_detector.hpp"
+#include "burst_capture.hpp"
+#include "collector.hpp"
+#include "deadband.hpp"
+#include "derived_metrics.hpp"
 
 using json = nlohmann::json;
 
@@ -18,18 +31,90 @@ struct Config {
         validate_config();
     }
 
-    int get_period() const {
+    // the file re-read on a reload, validated the same way
+    explicit Config(const std::string& path)
+        : config_path(path)
+    {
+        load_config();
+        validate_config();
+    }
+
+    const std::string& get_path() const {
+        return config_path;
+    }
+
+    // the whole parsed file, compared section by section on a reload
+    const json& get_data() const {
+        return config_data;
+    }
+
+    std::chrono::milliseconds get_period() const {
         return period;
     }
 
+    // 0 if the samples are written every tick
+    std::chrono::milliseconds get_aggregation_window() const {
+        return aggregation_window;
+    }
+
+    // the relative error of the reported quantiles
+    double get_aggregation_accuracy() const {
+        return aggregation_accuracy;
+    }
+
+    // only if "settings.anomaly" is configured
+    const std::optional<AnomalyOptions>& get_anomaly() const {
+        return anomaly;
+    }
+
+    // only if "settings.burst" is configured
+    const std::optional<BurstOptions>& get_burst() const {
+        return burst;
+    }
+
     const std::vector<json>& get_metrics() const {
         return metrics;
     }
 
+    // parallel to the collectors: the "adaptive" options of each, if any
+    const std::vector<std::optional<AdaptiveOptions>>& get_adaptive() const {
+        return adaptive;
+    }
+
+    // the configured collectors in the order of the "metrics" array; can be taken only once
+    std::vector<std::unique_ptr<Collector>> take_collectors() {
+        return std::move(collectors);
+    }
+
+    // the collectors before they are taken
+    const std::vector<std::unique_ptr<Collector>>& get_collectors() const {
+        return collectors;
+    }
+
+    // parallel to the collectors: the "metrics" entry of each
+    const std::vector<json>& get_collector_configs() const {
+        return collector_configs;
+    }
+
+    // the compiled "derived" entries in the order of the "metrics" array; can be taken only once
+    std::vector<DerivedExpression> take_derived() {
+        return std::move(derived);
+    }
+
+    // the "alerts" rules, empty if there are none; can be taken only once
+    std::vector<AlertRule> take_alerts() {
+        return std::move(alerts);
+    }
+
     const std::vector<json>& get_outputs() const {
         return outputs;
     }
 
+    // parallel to the outputs: the "deadband" options of each, if any
+    const std::vector<std::optional<DeadbandOptions>>& get_deadbands() const {
+        return deadbands;
+    }
+
     void setup_logging(std::ofstream& log_file) const {
 
         for (const auto& output : outputs) {
@@ -88,30 +173,138 @@ private:
     void validate_config() {
 
         validate_period();
+        validate_aggregation();
+        validate_anomaly();
         validate_metrics();
+        validate_burst();
+        validate_alerts();
         validate_outputs();
     }
 
     void validate_period() {
 
     	if (!config_data.contains("settings") || !config_data["settings"].is_object() ||
-            !config_data["settings"].contains("period") || !config_data["settings"]["period"].is_number_integer()) 
+            !config_data["settings"].contains("period") || !config_data["settings"]["period"].is_number()) 
     	{    
-            throw std::runtime_error("Config must contain 'settings.period' as an integer");
+            throw std::runtime_error("Config must contain 'settings.period' as a number of seconds");
+        }
+
+        // fractions of a second are allowed, e.g. 0.1 to sample often and write aggregated windows
+        period = to_milliseconds(config_data["settings"]["period"].get<double>());
+        if (period.count() <= 0) {
+            throw std::runtime_error("Period must be at least 1 ms");
+        }
+    }
+
+    void validate_aggregation() {
+
+        const auto& settings = config_data["settings"];
+        if (!settings.contains("aggregation")) {
+            return;
+        }
+
+        const auto& aggregation = settings["aggregation"];
+        if (!aggregation.is_object() || !aggregation.contains("window") || !aggregation["window"].is_number()) {
+            throw std::runtime_error("'settings.aggregation' must have a 'window' as a number of seconds");
+        }
+
+        aggregation_window = to_milliseconds(aggregation["window"].get<double>());
+        if (aggregation_window < period) {
+            throw std::runtime_error("Aggregation window must not be shorter than the period");
+        }
+
+        if (aggregation.contains("accuracy")) {
+
+            if (!aggregation["accuracy"].is_number()) {
+                throw std::runtime_error("Aggregation 'accuracy' must be a number");
+            }
+            aggregation_accuracy = aggregation["accuracy"].get<double>();
+            if (aggregation_accuracy <= 0 || aggregation_accuracy >= 1) {
+                throw std::runtime_error("Aggregation 'accuracy' must be between 0 and 1, e.g. 0.01 for 1%");
+            }
+        }
+    }
+
+    void validate_anomaly() {
+
+        const auto& settings = config_data["settings"];
+        if (!settings.contains("anomaly")) {
+            return;
+        }
+
+        const auto& options = settings["anomaly"];
+        if (!options.is_object()) {
+            throw std::runtime_error("'settings.anomaly' must be an object");
+        }
+
+        anomaly.emplace();
+        anomaly->series = collector_config::strings(options, "series", "Anomaly 'series' must be an array of names or glob patterns", { "*" });
+
+        auto number = [&](const char* field, double& value, double min, double max, const char* range) {
+
+            if (!options.contains(field)) {
+                return;
+            }
+            if (!options[field].is_number() || options[field].get<double>() < min || options[field].get<double>() > max) {
+                throw std::runtime_error("Anomaly '" + std::string(field) + "' must be " + range);
+            }
+            value = options[field].get<double>();
+        };
+
+        const double unlimited = std::numeric_limits<double>::max();
+        number("alpha", anomaly->alpha, 1e-4, 1, "a number in (0, 1], e.g. 0.1");
+        number("k", anomaly->k, 0.1, unlimited, "a positive number of standard deviations, e.g. 3");
+        number("min_sigma", anomaly->min_sigma, 0, unlimited, "a non-negative number");
+        number("warmup", anomaly->warmup, 1, unlimited, "a number of samples, at least 1");
+        number("beta", anomaly->beta, 0, 1, "a number in [0, 1]");
+        number("gamma", anomaly->gamma, 0, 1, "a number in [0, 1]");
+
+        // the season is given in seconds, the detector counts it in periods
+        anomaly->period = period;
+        double season = 0;
+        number("season", season, 0, unlimited, "a non-negative number of seconds");
+        if (season > 0) {
+
+            anomaly->season = static_cast<std::size_t>(std::llround(season * 1000 / period.count()));
+            if (anomaly->season < 2) {
+                throw std::runtime_error("Anomaly 'season' must be at least two periods long");
+            }
+        }
+    }
+
+    void validate_burst() {
+
+        const auto& settings = config_data["settings"];
+        if (!settings.contains("burst")) {
+            return;
+        }
+
+        burst = BurstOptions::parse(settings["burst"]);
+        if (burst->rate > period) {
+            throw std::runtime_error("Burst 'rate' must not be longer than 'settings.period', it is the faster sampling");
         }
 
-        period = config_data["settings"]["period"].get<int>();
-        if (period <= 0) {
-            throw std::runtime_error("Period must be a positive integer");
+        // the ring needs whole batches at a steady rate, every collector is sampled at the burst rate
+        for (const auto& options : adaptive) {
+            if (options) {
+                throw std::runtime_error("'adaptive' can't be combined with 'settings.burst', which samples every collector at its own rate");
+            }
         }
     }
 
+    static std::chrono::milliseconds to_milliseconds(double seconds) {
+        return std::chrono::milliseconds(static_cast<std::int64_t>(std::llround(seconds * 1000)));
+    }
+
     void validate_metrics() {
 
     	if (!config_data.contains("metrics") || !config_data["metrics"].is_array()) {
             
             throw std::runtime_error("Config must contain 'metrics' as an array");
         }
+        if (config_data["metrics"].empty()) {
+            throw std::runtime_error("Config 'metrics' must not be empty, there would be nothing to collect");
+        }
 
         metrics = config_data["metrics"].get<std::vector<json>>();
         
@@ -122,26 +315,45 @@ private:
                 throw std::runtime_error("Each metric must have a 'type' field as a string");
             }
 
-            std::string type = metric["type"].get<std::string>();
-            if (type == "cpu") {
-                
-                if (!metric.contains("ids") || !metric["ids"].is_array()) {
-                    throw std::runtime_error("CPU metric must have an 'ids' array");
-                }
+            // not a collector: the expression is compiled here once and evaluated over the collected samples
+            if (metric["type"] == "derived") {
 
-            } else if (type == "memory") {
-                
-                if (!metric.contains("spec") || !metric["spec"].is_array()) {
-                    throw std::runtime_error("Memory metric must have a 'spec' array");
+                if (metric.contains("adaptive")) {
+                    throw std::runtime_error("'adaptive' applies to collectors, a derived metric is computed whenever its series are collected");
                 }
+                derived.push_back(DerivedExpression::compile(metric));
+                continue;
+            }
 
-            } else {
-                
-                throw std::runtime_error("Unknown metric type: " + type);
+            // the type-specific fields are checked by the collector, which keeps them as typed options
+            auto collector = CollectorRegistry::create(metric["type"].get<std::string>());
+            collector->configure(metric);
+            collectors.push_back(std::move(collector));
+            collector_configs.push_back(metric);
+
+            // the schedule is the monitor's business, any collector can have one
+            adaptive.emplace_back();
+            if (metric.contains("adaptive")) {
+                adaptive.back() = AdaptiveOptions::parse(metric["adaptive"]);
             }
         }
     }
 
+    void validate_alerts() {
+
+        if (!config_data.contains("alerts")) {
+            return;
+        }
+
+        if (!config_data["alerts"].is_array()) {
+            throw std::runtime_error("'alerts' must be an array of rules");
+        }
+
+        for (const auto& alert : config_data["alerts"]) {
+            alerts.push_back(AlertRule::parse(alert));
+        }
+    }
+
     void validate_outputs() {
 
     	if (!config_data.contains("outputs") || !config_data["outputs"].is_array()) {
@@ -168,6 +380,11 @@ private:
                 
                 throw std::runtime_error("Log output must have a 'path' field as a string");
             }
+
+            deadbands.emplace_back();
+            if (output.contains("deadband")) {
+                deadbands.back() = DeadbandOptions::parse(output["deadband"]);
+            }
         }
     }
 
@@ -176,7 +393,17 @@ private:
 
 	std::string config_path;
     json config_data;
-    int period;
+    std::chrono::milliseconds period;
+    std::chrono::milliseconds aggregation_window{0};
+    double aggregation_accuracy = 0.01;
+    std::optional<AnomalyOptions> anomaly;
+    std::optional<BurstOptions> burst;
     std::vector<json> metrics;
+    std::vector<std::unique_ptr<Collector>> collectors;
+    std::vector<json> collector_configs;
+    std::vector<std::optional<AdaptiveOptions>> adaptive;
+    std::vector<DerivedExpression> derived;
+    std::vector<AlertRule> alerts;
     std::vector<json> outputs;
+    std::vector<std::optional<DeadbandOptions>> deadbands;
 };
\ No newline at end of file
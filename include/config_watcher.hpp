@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+
+// tells the monitor when to re-read its config: the file was written or replaced (inotify on its directory,
+// as editors usually write a new file and rename it over the old one), or SIGHUP arrived. Nothing blocks,
+// the monitor asks once per tick. Without inotify only SIGHUP is left
+struct ConfigWatcher {
+
+	explicit ConfigWatcher(const std::string& path);
+
+	~ConfigWatcher();
+
+	ConfigWatcher(const ConfigWatcher&) = delete;
+
+	ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+	// true if the config should be re-read, drains the pending events
+	bool changed();
+
+private:
+
+	std::string name; // the file's name within the watched directory
+	int fd = -1;
+};
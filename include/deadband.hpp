@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "metrics.hpp"
+
+using json = nlohmann::json;
+
+
+// the "deadband" field of an output:
+//   { "type": "log", "path": "monitor.log", "deadband": { "absolute": 0.5, "relative": 0.01, "heartbeat": 60 } }
+// a series is written only when it has moved since its last written value by more than "absolute" or by more than
+// "relative" (a fraction of that value), or when it hasn't been written for "heartbeat" seconds (60 by default,
+// 0 for never). Without "absolute" and "relative" any change is written
+struct DeadbandOptions {
+
+	static DeadbandOptions parse(const json& deadband);
+
+	std::optional<double> absolute;
+	std::optional<double> relative;
+	std::chrono::milliseconds heartbeat{ 60000 };
+};
+
+
+// the deadband of one output. The last written value and time of every series are kept in flat arrays indexed
+// by series position, found through the same position cache as the Aggregator's: every sample's name is still
+// built and compared with the one at its last position, which saves the hash lookup but not that string.
+// A series that hasn't been seen for a heartbeat (10 minutes without one) is forgotten: it would be written on
+// its return anyway, as its heartbeat is due by then
+struct DeadbandFilter {
+
+	explicit DeadbandFilter(const DeadbandOptions& options);
+
+	// the samples to write, in their order
+	std::vector<const Metric*> filter(const std::vector<std::unique_ptr<Metric>>& metrics, std::chrono::steady_clock::time_point now);
+
+private:
+
+	std::size_t find_series(const std::string& name);
+
+	bool moved(double last, double value) const;
+
+	// drops the series last seen before `time`, keeping the order of the rest
+	void forget(std::int64_t time);
+
+private:
+
+	static constexpr std::int64_t NEVER = INT64_MIN;
+
+	static constexpr std::chrono::minutes FORGET_WITHOUT_HEARTBEAT{ 10 };
+
+	DeadbandOptions options;
+
+	std::vector<std::string> names; // every series seen so far
+	std::unordered_map<std::string, std::size_t> index; // name -> position
+	std::vector<std::size_t> positions; // the position of the i-th sample of the last tick
+
+	std::vector<double> emitted; // parallel to names: the last written value
+	std::vector<std::int64_t> emitted_at; // the steady clock in nanoseconds when it was written, NEVER if it wasn't
+	std::vector<std::int64_t> seen_at; // when it was last in a batch
+	std::int64_t next_sweep = NEVER;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+#include "metrics.hpp"
+#include "series_slots.hpp"
+
+using json = nlohmann::json;
+
+
+// a "derived" entry of the config: { "type": "derived", "name": "memory.used_pct", "expr": "memory.used / (memory.used + memory.free) * 100" },
+// compiled once by Config into the bytecode of a small stack machine.
+//
+// The expression language:
+//   - numbers, + - * /, unary minus and parentheses;
+//   - series by name: memory.used, cpu.0, or in single quotes if the name has other characters: 'disk.dm-0.util';
+//   - ranges of series numbered in their name: cpu[0..31] is cpu.0, cpu.1, ..., cpu.31, perf[0..3].ipc is
+//     perf.0.ipc, ..., perf.3.ipc; only as arguments of the functions below;
+//   - sum, avg, min, max of any number of arguments, skipping the series missing in a tick;
+//   - rate(x): the change of x per second since the previous tick, abs(x).
+// A series that isn't in the batch is NaN and so is the arithmetic over it; a derived sample whose value isn't a
+// number isn't emitted
+struct DerivedExpression {
+
+	enum class Op : std::uint8_t { constant, load, add, sub, mul, div, neg, abs, sum, avg, min, max, rate };
+
+	struct Instruction {
+		Op op;
+		std::uint32_t arg; // load: the series, sum/avg/min/max: the number of arguments, rate: its state
+		double value; // constant
+	};
+
+	// throws std::runtime_error with the position of a syntax error
+	static DerivedExpression compile(const json& metric);
+
+	std::string name;
+	std::string text;
+	std::vector<Instruction> code;
+	std::vector<std::string> series; // what `load` reads, by index
+	std::uint32_t rates = 0; // how many `rate` instructions have state
+	std::size_t stack_depth = 0;
+};
+
+
+// the stage after collect_metrics(): evaluates every compiled expression over the tick's samples and appends the
+// results to the batch. The referenced series are SeriesSlots (deduplicated across the expressions), so a tick
+// copies the values into the slots and runs the bytecode without string lookups or allocation (apart from the
+// emitted samples)
+struct DerivedMetrics {
+
+	explicit DerivedMetrics(std::vector<DerivedExpression> expressions);
+
+	bool empty() const {
+		return expressions.empty();
+	}
+
+	void evaluate(std::vector<std::unique_ptr<Metric>>& metrics, std::chrono::steady_clock::time_point now);
+
+private:
+
+	struct Rate {
+		double value;
+		std::chrono::steady_clock::time_point time;
+		bool known = false;
+	};
+
+	double run(const DerivedExpression& expression, std::chrono::steady_clock::time_point now);
+
+private:
+
+	std::vector<DerivedExpression> expressions; // `load` and `rate` renumbered to the slots and the states below
+	SeriesSlots slots;
+	std::vector<std::size_t> result_slots; // parallel to expressions: the slot of a derived series used by a later one
+	std::vector<Rate> rates;
+	std::vector<double> stack;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "proc_snapshot.hpp"
+
+
+//helper-struct with the cumulative counters of one block device taken from /proc/diskstats
+struct DiskCounters {
+
+	std::uint64_t reads
+		, sectors_read
+		, ms_reading
+		, writes
+		, sectors_written
+		, ms_writing
+		, ms_doing_io;
+};
+
+
+// per-second rates of one block device between two consecutive reads
+struct DiskRates {
+
+	std::string device;
+	double read_iops;
+	double write_iops;
+	double read_throughput; // MB/s
+	double write_throughput; // MB/s
+	double read_latency; // average ms per completed read
+	double write_latency; // average ms per completed write
+	double util; // % of the interval the device was busy
+};
+
+
+// reads /proc/diskstats (shared with the other disk entries of the tick) and computes rates for the devices matching the glob patterns
+struct DiskStatsReader {
+
+	DiskStatsReader(std::vector<std::string> patterns, SharedProcFile& file);
+
+	// fills `out` with the rates since the previous call (the first call reports zeros)
+	void sample(std::vector<DiskRates>& out);
+
+private:
+
+	struct Device {
+		std::string name;
+		bool selected;
+		bool has_prev;
+		DiskCounters prev;
+	};
+
+	bool matches(const std::string& name) const;
+
+	// re-creates the name -> slot table, keeping the previous counters of the devices that are still present
+	void rebuild(std::string_view text);
+
+	static bool parse_line(std::string_view line, std::string_view& name, DiskCounters& counters);
+
+private:
+
+	SharedProcFile& file;
+	std::vector<std::string> patterns;
+	std::vector<Device> devices; // slot i corresponds to the i-th line of /proc/diskstats
+	std::chrono::steady_clock::time_point prev_time;
+};
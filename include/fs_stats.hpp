@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "proc_file.hpp"
+#include "thread_pool.hpp"
+
+
+struct FsUsage {
+
+	std::string mount;
+	bool responding; // false if statvfs didn't return within the timeout (a hung NFS server, ...)
+	double size; // GB
+	double avail; // GB available to unprivileged users
+	double used; // % of the space available to unprivileged users
+	double inodes_avail;
+	double inodes_used; // %
+};
+
+
+// capacity and inode usage of the mounted filesystems; the mount table is taken from /proc/self/mountinfo,
+// which is only re-parsed when poll() reports POLLPRI on it (the kernel signals every mount/umount that way),
+// and the statvfs calls run in parallel on the pool and are waited for with a timeout
+struct FsStatsReader {
+
+	// mount_patterns are matched against the mount point, fstype_patterns against the filesystem type;
+	// the calls are spread over `lanes` pool tasks, so no more than that many workers can hang in statvfs
+	FsStatsReader(std::vector<std::string> mount_patterns, std::vector<std::string> fstype_patterns
+		, std::chrono::milliseconds timeout, std::size_t lanes, const std::string& path = "/proc/self/mountinfo");
+
+	// starts the statvfs calls of this tick; called from the thread that owns the pool
+	void submit(StaticThreadPool& pool);
+
+	// waits for the calls started by submit() until the timeout and fills `out`
+	void collect(std::vector<FsUsage>& out);
+
+private:
+
+	// the results of one mount point; shared with the pool tasks, so a call that outlives its tick
+	// (or the mount itself) writes into memory that is still alive
+	struct Probe {
+		std::string mount;
+		std::atomic_bool queued{false}; // in the queue or being called, not finished yet
+		std::atomic<std::uint64_t> tick{0}; // the tick of the last finished call, published after the results
+		int error = 0;
+		std::uint64_t block_size = 0;
+		std::uint64_t blocks = 0;
+		std::uint64_t blocks_avail = 0; // f_bavail
+		std::uint64_t blocks_free = 0; // f_bfree
+		std::uint64_t files = 0;
+		std::uint64_t files_free = 0;
+
+		void run(std::uint64_t current_tick);
+	};
+
+	// the probes waiting for a lane, shared by all of them: a lane takes the next probe when its call returns,
+	// so the probes behind a hung call are taken by the other lanes, this tick or the next one
+	struct Queue {
+		std::mutex mutex;
+		std::deque<std::shared_ptr<Probe>> probes;
+		std::uint64_t tick = 0; // the tick a probe taken now is reported in
+
+		// false if the queue is empty
+		bool pop(std::shared_ptr<Probe>& probe, std::uint64_t& current_tick);
+	};
+
+	// one pool task calling statvfs for the queued probes one after another; a lane stuck in a call isn't
+	// started again until the call returns, so hung mounts never take more than `lanes` workers
+	struct Lane {
+		std::atomic_bool busy{false};
+	};
+
+	void parse(std::string_view text);
+
+	static bool matches(const std::vector<std::string>& patterns, const std::string& value);
+
+	// mountinfo escapes spaces, tabs, newlines and backslashes as \ooo
+	static std::string unescape(std::string_view field);
+
+private:
+
+	ProcFile mountinfo;
+	std::vector<std::string> mount_patterns;
+	std::vector<std::string> fstype_patterns;
+	std::chrono::milliseconds timeout;
+	std::vector<std::shared_ptr<Probe>> probes; // in mountinfo order, one per filesystem
+	std::shared_ptr<Queue> queue;
+	std::vector<std::shared_ptr<Lane>> lanes;
+	std::vector<std::future<void>> pending; // [lane], invalid if the lane wasn't started this tick
+	std::chrono::steady_clock::time_point deadline;
+	std::uint64_t tick = 0;
+};
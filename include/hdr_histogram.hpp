@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+
+// an HDR histogram (Gil Tene's HdrHistogram layout) of durations in microseconds from 1 us to 60 s with two
+// significant digits: every recorded value lands in a bucket at most 1% wider than the value itself, whatever
+// its magnitude, and the counts array has a fixed size (2560 counters, 20 KiB).
+//
+// record() is meant for a single writer thread and uses relaxed atomic increments, so another thread can
+// read (merge) the histogram at any time without locks; a sum of such reads may mix two records of the
+// same step, which is fine for statistics
+struct HdrHistogram {
+
+	static constexpr std::uint64_t HIGHEST = 60'000'000; // 60 s, longer durations are counted as 60 s
+
+	HdrHistogram();
+
+	HdrHistogram(const HdrHistogram&) = delete;
+
+	HdrHistogram& operator=(const HdrHistogram&) = delete;
+
+	void record(std::uint64_t us);
+
+	// this += other
+	void add(const HdrHistogram& other);
+
+	// this -= other, where `other` is an earlier copy of the same (cumulative) histogram
+	void subtract(const HdrHistogram& other);
+
+	// this = other
+	void copy_from(const HdrHistogram& other);
+
+	void reset();
+
+	std::uint64_t count() const {
+		return total.load(std::memory_order_relaxed);
+	}
+
+	// q in [0, 1]; the highest value that is equivalent to the q-th one, 0 for an empty histogram
+	std::uint64_t value_at_quantile(double q) const;
+
+	// the highest value equivalent to the largest recorded one
+	std::uint64_t max() const;
+
+private:
+
+	static std::size_t index_of(std::uint64_t value);
+
+	static std::uint64_t value_at_index(std::size_t index);
+
+	static std::uint64_t highest_equivalent(std::uint64_t value);
+
+private:
+
+	std::unique_ptr<std::atomic<std::uint64_t>[]> counts;
+	std::atomic<std::uint64_t> total{ 0 };
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "proc_snapshot.hpp"
+
+
+// per-cpu rates of the selected rows of /proc/interrupts or /proc/softirqs
+struct IrqRates {
+
+	std::vector<int> cpus; // the ids from the CPUn header columns
+	std::vector<std::string> irqs; // the labels of the selected rows ("24", "LOC", "NET_RX", ...)
+	std::vector<double> rates; // [irq][cpu], row-major, per second
+	std::vector<double> totals; // [cpu], the sum over the selected irqs
+};
+
+
+// parses the wide per-cpu matrices of /proc/interrupts and /proc/softirqs into a preallocated [irq][cpu]
+// matrix; rows that aren't selected are skipped with memchr and the table is only rebuilt when the set of
+// rows or cpus changes, so a tick doesn't allocate
+struct IrqStatsReader {
+
+	// patterns are matched against the row label and against the description (e.g. "*eth0*")
+	IrqStatsReader(SharedProcFile& file, std::vector<std::string> patterns);
+
+	// the view stays valid until the next call
+	const IrqRates& sample();
+
+private:
+
+	struct Row {
+		std::size_t line;
+		std::string label;
+	};
+
+	void rebuild(std::string_view text);
+
+	// fills `curr`; returns false if the rows or cpus don't match the table anymore
+	bool parse(std::string_view text);
+
+	bool matches(std::string_view label, std::string_view description) const;
+
+	static std::size_t count_cpus(std::string_view header, std::vector<int>* ids);
+
+	// parses up to `cpus` right-aligned counters into `row`, the missing columns (ERR, MIS) are left 0
+	static void parse_counters(std::string_view& line, std::uint64_t* row, std::size_t cpus);
+
+	// the fast path for rows in the kernel's fixed-width layout; returns false if the row doesn't follow it
+	static bool parse_fixed_width(std::string_view& line, std::uint64_t* row, std::size_t cpus);
+
+private:
+
+	SharedProcFile& file;
+	std::vector<std::string> patterns;
+	std::vector<Row> rows; // the selected rows sorted by line
+	std::size_t lines = 0; // lines in the file when the table was built
+	std::vector<std::uint64_t> curr; // [irq][cpu]
+	std::vector<std::uint64_t> prev; // [irq][cpu]
+	IrqRates result;
+	std::chrono::steady_clock::time_point prev_time;
+	bool has_prev = false;
+};
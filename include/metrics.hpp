@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <iomanip>
 #include <nlohmann/json.hpp>
@@ -14,8 +15,20 @@ struct Metric {
 
 	virtual json to_json() const = 0;
 
+	// a name that identifies the series between ticks ("cpu.0", "disk.sda.util", ...), used by the stages that
+	// work on the numbers rather than on the text
+	virtual std::string series() const = 0;
+
+	virtual double get_value() const = 0;
+
+	// replaces the value get_value() returns and the text shows, e.g. with the mean of several samples
+	virtual void set_value(double value) = 0;
+
 	virtual ~Metric() = default;
 
+	// the interval the sample was taken at, set when adaptive sampling is configured (0 otherwise)
+	std::chrono::milliseconds resolution{0};
+
 	std::string double_to_string(double value, int precision) const {
 
 		std::stringstream ss;
@@ -46,12 +59,62 @@ struct CpuLoad : Metric {
         return j;
     }
 
+	std::string series() const override {
+		return "cpu." + std::to_string(cpu_id);
+	}
+
+	double get_value() const override {
+		return load;
+	}
+
+	void set_value(double value) override {
+		load = value;
+	}
+
 
 	int cpu_id;
 	double load;
 };
 
 
+// the load of a group of cpus (a NUMA node or a socket)
+struct CpuGroupLoad : Metric {
+
+	CpuGroupLoad(const std::string& group, double load) : group(group), load(load) {}
+
+	std::string to_string() const override {
+
+		char buffer[64];
+		std::snprintf(buffer, sizeof(buffer), "CPU %s: %.2f%%", group.c_str(), load);
+		return buffer;
+	}
+
+	json to_json() const override {
+		json j;
+		j["type"] = "cpu";
+		j["id"] = group;
+		j["load"] = double_to_string(load, 2);
+		return j;
+	}
+
+	std::string series() const override {
+		return "cpu." + group;
+	}
+
+	double get_value() const override {
+		return load;
+	}
+
+	void set_value(double value) override {
+		load = value;
+	}
+
+
+	std::string group; // node0, socket1, ...
+	double load;
+};
+
+
 struct MemoryMetric : Metric {
 
 	MemoryMetric(const std::string& spec, double value) : spec(spec), value(value) {}
@@ -72,12 +135,721 @@ struct MemoryMetric : Metric {
         return j;
     }
 
+	std::string series() const override {
+		return "memory." + spec;
+	}
+
+	double get_value() const override {
+		return value;
+	}
+
+	void set_value(double value) override {
+		this->value = value;
+	}
+
 
 	std::string spec; // 
 	double value;
 };
 
 
+struct DiskMetric : Metric {
+
+	DiskMetric(const std::string& device, const std::string& spec, double value) 
+		: device(device), spec(spec), value(value) {}
+
+	std::string to_string() const override {
+
+		char buffer[96];
+		std::snprintf(buffer, sizeof(buffer), "Disk %s %s: %.2f%s", device.c_str(), spec.c_str(), value, unit());
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = "disk";
+		j["device"] = device;
+		j["spec"] = spec;
+		j["value"] = double_to_string(value, 2);
+		return j;
+	}
+
+	const char* unit() const {
+
+		if (spec == "read_iops" || spec == "write_iops") return "/s";
+		if (spec == "read_throughput" || spec == "write_throughput") return " MB/s";
+		if (spec == "read_latency" || spec == "write_latency") return " ms";
+		return "%";
+	}
+
+	std::string series() const override {
+		return "disk." + device + "." + spec;
+	}
+
+	double get_value() const override {
+		return value;
+	}
+
+	void set_value(double value) override {
+		this->value = value;
+	}
+
+
+	std::string device;
+	std::string spec; // read_iops, write_iops, read_throughput, write_throughput, read_latency, write_latency, util
+	double value;
+};
+
+
+struct NetworkMetric : Metric {
+
+	NetworkMetric(const std::string& interface, const std::string& spec, double value)
+		: interface(interface), spec(spec), value(value) {}
+
+	std::string to_string() const override {
+
+		char buffer[96];
+		std::snprintf(buffer, sizeof(buffer), "Net %s %s: %.2f/s", interface.c_str(), spec.c_str(), value);
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = "network";
+		j["interface"] = interface;
+		j["spec"] = spec;
+		j["value"] = double_to_string(value, 2);
+		return j;
+	}
+
+	std::string series() const override {
+		return "net." + interface + "." + spec;
+	}
+
+	double get_value() const override {
+		return value;
+	}
+
+	void set_value(double value) override {
+		this->value = value;
+	}
+
+
+	std::string interface;
+	std::string spec; // rx_bytes, rx_packets, rx_errors, rx_drops and the same for tx
+	double value;
+};
+
+
+struct SocketMetric : Metric {
+
+	SocketMetric(const std::string& spec, const std::string& name, double value)
+		: spec(spec), name(name), value(value) {}
+
+	std::string to_string() const override {
+
+		char buffer[128];
+		std::snprintf(buffer, sizeof(buffer), "Sockets %s %s: %.2f%s", spec.c_str(), name.c_str(), value, spec == "counter" ? "/s" : "");
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = "sockets";
+		j["spec"] = spec;
+		j["name"] = name;
+		j["value"] = double_to_string(value, 2);
+		return j;
+	}
+
+	std::string series() const override {
+		return "sockets." + spec + "." + name;
+	}
+
+	double get_value() const override {
+		return value;
+	}
+
+	void set_value(double value) override {
+		this->value = value;
+	}
+
+
+	std::string spec; // state, accept_queue, backlog or counter
+	std::string name; // a TCP state, a listening address or a "Section:Field" counter
+	double value;
+};
+
+
+struct PerfMetric : Metric {
+
+	PerfMetric(int cpu_id, const std::string& spec, double value) noexcept
+		: cpu_id(cpu_id), spec(spec), value(value) {}
+
+	std::string to_string() const override {
+
+		char buffer[64];
+		const char* unit = (spec == "ipc") ? "" : (spec.find("_rate") != std::string::npos) ? "%" : "/s";
+		std::snprintf(buffer, sizeof(buffer), "CPU%d %s: %.2f%s", cpu_id, spec.c_str(), value, unit);
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = "perf";
+		j["id"] = cpu_id;
+		j["spec"] = spec;
+		j["value"] = double_to_string(value, 2);
+		return j;
+	}
+
+	std::string series() const override {
+		return "perf." + std::to_string(cpu_id) + "." + spec;
+	}
+
+	double get_value() const override {
+		return value;
+	}
+
+	void set_value(double value) override {
+		this->value = value;
+	}
+
+
+	int cpu_id;
+	std::string spec; // ipc, cache_miss_rate, branch_miss_rate or (without a PMU) context_switches, cpu_migrations, page_faults
+	double value;
+};
+
+
+struct VmstatMetric : Metric {
+
+	VmstatMetric(const std::string& field, double value, bool is_rate) : field(field), value(value), is_rate(is_rate) {}
+
+	std::string to_string() const override {
+
+		char buffer[96];
+		std::snprintf(buffer, sizeof(buffer), "Vmstat %s: %.2f%s", field.c_str(), value, is_rate ? "/s" : "");
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = "vmstat";
+		j["field"] = field;
+		j["value"] = double_to_string(value, 2);
+		return j;
+	}
+
+	std::string series() const override {
+		return "vmstat." + field;
+	}
+
+	double get_value() const override {
+		return value;
+	}
+
+	void set_value(double value) override {
+		this->value = value;
+	}
+
+
+	std::string field; // a counter from /proc/vmstat
+	double value;
+	bool is_rate;
+};
+
+
+struct IrqMetric : Metric {
+
+	IrqMetric(const std::string& type, const std::string& irq, int cpu_id, double value)
+		: type(type), irq(irq), cpu_id(cpu_id), value(value) {}
+
+	std::string to_string() const override {
+
+		char buffer[96];
+		std::snprintf(buffer, sizeof(buffer), "%s %s CPU%d: %.2f/s"
+			, type == "softirqs" ? "SoftIRQ" : "IRQ", irq.c_str(), cpu_id, value);
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = type;
+		j["irq"] = irq;
+		j["id"] = cpu_id;
+		j["value"] = double_to_string(value, 2);
+		return j;
+	}
+
+	std::string series() const override {
+		return type + "." + irq + "." + std::to_string(cpu_id);
+	}
+
+	double get_value() const override {
+		return value;
+	}
+
+	void set_value(double value) override {
+		this->value = value;
+	}
+
+
+	std::string type; // interrupts or softirqs
+	std::string irq; // a row label of /proc/interrupts or /proc/softirqs, "total" for the sum of the selected rows
+	int cpu_id;
+	double value;
+};
+
+
+struct SchedLatencyMetric : Metric {
+
+	SchedLatencyMetric(bool is_pid, int id, const std::string& spec, double value)
+		: is_pid(is_pid), id(id), spec(spec), value(value) {}
+
+	std::string to_string() const override {
+
+		char buffer[64];
+		std::snprintf(buffer, sizeof(buffer), "%s%d %s: %.2f %s"
+			, is_pid ? "PID " : "CPU", id, spec.c_str(), value, spec == "delay" ? "ms/s" : "us");
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = "schedlat";
+		j[is_pid ? "pid" : "id"] = id;
+		j["spec"] = spec;
+		j["value"] = double_to_string(value, 2);
+		return j;
+	}
+
+	std::string series() const override {
+		return "schedlat." + std::string(is_pid ? "pid" : "cpu") + std::to_string(id) + "." + spec;
+	}
+
+	double get_value() const override {
+		return value;
+	}
+
+	void set_value(double value) override {
+		this->value = value;
+	}
+
+
+	bool is_pid;
+	int id;
+	std::string spec; // delay (ms of run-queue waiting per second) or avg_wait (us per timeslice)
+	double value;
+};
+
+
+struct FilesystemMetric : Metric {
+
+	FilesystemMetric(const std::string& mount, const std::string& spec, double value)
+		: mount(mount), spec(spec), value(value) {}
+
+	std::string to_string() const override {
+
+		char buffer[128];
+		std::snprintf(buffer, sizeof(buffer), "FS %s %s: %.2f%s", mount.c_str(), spec.c_str(), value, unit());
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = "filesystem";
+		j["mount"] = mount;
+		j["spec"] = spec;
+		j["value"] = double_to_string(value, 2);
+		return j;
+	}
+
+	const char* unit() const {
+
+		if (spec == "used" || spec == "inodes_used") return "%";
+		if (spec == "size" || spec == "avail") return " GB";
+		return "";
+	}
+
+	std::string series() const override {
+		return "fs." + mount + "." + spec;
+	}
+
+	double get_value() const override {
+		return value;
+	}
+
+	void set_value(double value) override {
+		this->value = value;
+	}
+
+
+	std::string mount;
+	std::string spec; // size, avail, used, inodes_avail, inodes_used or timeout (1 if statvfs didn't return in time)
+	double value;
+};
+
+
+struct NumaMetric : Metric {
+
+	NumaMetric(int node, const std::string& spec, double value) : node(node), spec(spec), value(value) {}
+
+	std::string to_string() const override {
+
+		char buffer[96];
+		std::snprintf(buffer, sizeof(buffer), "Node%d %s: %.2f%s", node, spec.c_str(), value, unit());
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = "numa";
+		j["node"] = node;
+		j["spec"] = spec;
+		j["value"] = double_to_string(value, 2);
+		return j;
+	}
+
+	const char* unit() const {
+
+		if (spec == "total" || spec == "free" || spec == "used") return " GB";
+		return "/s";
+	}
+
+	std::string series() const override {
+		return "numa." + std::to_string(node) + "." + spec;
+	}
+
+	double get_value() const override {
+		return value;
+	}
+
+	void set_value(double value) override {
+		this->value = value;
+	}
+
+
+	int node;
+	std::string spec; // total, free, used, numa_hit, numa_miss, numa_foreign, local_node, other_node
+	double value;
+};
+
+
+struct ThermalMetric : Metric {
+
+	ThermalMetric(const std::string& source, const std::string& spec, double value)
+		: source(source), spec(spec), value(value) {}
+
+	std::string to_string() const override {
+
+		char buffer[128];
+		std::snprintf(buffer, sizeof(buffer), "Thermal %s %s: %.2f%s", source.c_str(), spec.c_str(), value, unit());
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = "thermal";
+		j["id"] = source;
+		j["spec"] = spec;
+		j["value"] = double_to_string(value, 2);
+		return j;
+	}
+
+	const char* unit() const {
+
+		if (spec == "freq") return " MHz";
+		if (spec == "temp") return " C";
+		return "/s";
+	}
+
+	std::string series() const override {
+		return "thermal." + source + "." + spec;
+	}
+
+	double get_value() const override {
+		return value;
+	}
+
+	void set_value(double value) override {
+		this->value = value;
+	}
+
+
+	std::string source; // cpu<N> or a hwmon sensor ("coretemp/Core 0")
+	std::string spec; // freq, core_throttle, package_throttle or temp
+	double value;
+};
+
+
+struct PluginMetric : Metric {
+
+	PluginMetric(const std::string& plugin, const std::string& name, double value)
+		: plugin(plugin), name(name), value(value) {}
+
+	std::string to_string() const override {
+
+		char buffer[128];
+		std::snprintf(buffer, sizeof(buffer), "%s %s: %.2f", plugin.c_str(), name.c_str(), value);
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = "plugin";
+		j["plugin"] = plugin;
+		j["name"] = name;
+		j["value"] = double_to_string(value, 2);
+		return j;
+	}
+
+	std::string series() const override {
+		return plugin + "." + name;
+	}
+
+	double get_value() const override {
+		return value;
+	}
+
+	void set_value(double value) override {
+		this->value = value;
+	}
+
+
+	std::string plugin;
+	std::string name;
+	double value;
+};
+
+
+// the monitor's own latency of one step (collect.cpu.0, output.log.1, ...) since the previous tick
+struct SelfMetric : Metric {
+
+	SelfMetric(const std::string& step, const std::string& spec, double value)
+		: step(step), spec(spec), value(value) {}
+
+	std::string to_string() const override {
+
+		char buffer[128];
+		std::snprintf(buffer, sizeof(buffer), "Self %s %s: %.2f%s", step.c_str(), spec.c_str(), value
+			, spec == "count" ? "" : spec == "suppressed" ? "%" : " us");
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = "self";
+		j["step"] = step;
+		j["spec"] = spec;
+		j["value"] = double_to_string(value, 2);
+		return j;
+	}
+
+	std::string series() const override {
+		return "self." + step + "." + spec;
+	}
+
+	double get_value() const override {
+		return value;
+	}
+
+	void set_value(double value) override {
+		this->value = value;
+	}
+
+
+	std::string step;
+	std::string spec; // p50, p90, p99, max (us), count (runs of the step) or suppressed (% of an output's samples)
+	double value;
+};
+
+
+// a statistic (min, mean, stddev, p50, p90, p99, max) of one series over an aggregation window
+struct QuantileMetric : Metric {
+
+	QuantileMetric(const std::string& source, const char* stat, double value, std::uint64_t samples)
+		: source(source), stat(stat), value(value), samples(samples) {}
+
+	std::string to_string() const override {
+
+		char buffer[160];
+		std::snprintf(buffer, sizeof(buffer), "%s %s: %.2f", source.c_str(), stat, value);
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = "aggregate";
+		j["series"] = source;
+		j["stat"] = stat;
+		j["value"] = double_to_string(value, 2);
+		j["samples"] = samples;
+		return j;
+	}
+
+	std::string series() const override {
+		return source + "." + stat;
+	}
+
+	double get_value() const override {
+		return value;
+	}
+
+	void set_value(double value) override {
+		this->value = value;
+	}
+
+
+	std::string source; // the series the statistic is computed over
+	const char* stat;
+	double value;
+	std::uint64_t samples; // in the window
+};
+
+
+// the value of a "derived" expression, see include/derived_metrics.hpp
+struct DerivedMetric : Metric {
+
+	DerivedMetric(const std::string& name, double value) : name(name), value(value) {}
+
+	std::string to_string() const override {
+
+		char buffer[160];
+		std::snprintf(buffer, sizeof(buffer), "%s: %.2f", name.c_str(), value);
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = "derived";
+		j["name"] = name;
+		j["value"] = double_to_string(value, 2);
+		return j;
+	}
+
+	std::string series() const override {
+		return name;
+	}
+
+	double get_value() const override {
+		return value;
+	}
+
+	void set_value(double value) override {
+		this->value = value;
+	}
+
+
+	std::string name;
+	double value;
+};
+
+
+// a transition of an alert rule, see include/alerts.hpp: firing once the threshold has been breached for the
+// rule's duration, resolved once the value is back past the clear level
+struct AlertEvent : Metric {
+
+	AlertEvent(const std::string& name, const std::string& source, bool firing, double value, double threshold)
+		: name(name), source(source), firing(firing), value(value), threshold(threshold) {}
+
+	std::string to_string() const override {
+
+		char buffer[256];
+		std::snprintf(buffer, sizeof(buffer), "Alert %s %s: %s = %.2f (%s %.2f)", name.c_str(), firing ? "firing" : "resolved"
+			, source.c_str(), value, firing ? "threshold" : "clear", threshold);
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = "alert";
+		j["name"] = name;
+		j["state"] = firing ? "firing" : "resolved";
+		j["series"] = source;
+		j["value"] = double_to_string(value, 2);
+		j[firing ? "threshold" : "clear"] = double_to_string(threshold, 2);
+		return j;
+	}
+
+	std::string series() const override {
+		return "alert." + name;
+	}
+
+	double get_value() const override {
+		return firing ? 1 : 0;
+	}
+
+	void set_value(double value) override {
+		firing = value != 0;
+	}
+
+
+	std::string name;
+	std::string source; // the series the rule watches
+	bool firing; // false for resolved
+	double value; // that triggered the transition
+	double threshold; // the threshold for firing, the clear level for resolved
+};
+
+// a sample flagged by the anomaly detector (include/anomaly_detector.hpp): `score` sigmas away from the forecast
+struct AnomalyEvent : Metric {
+
+	AnomalyEvent(const std::string& source, double value, double expected, double score)
+		: source(source), value(value), expected(expected), score(score) {}
+
+	std::string to_string() const override {
+
+		char buffer[256];
+		std::snprintf(buffer, sizeof(buffer), "Anomaly %s: %.2f, expected %.2f (%+.1f sigma)", source.c_str(), value, expected, score);
+		return buffer;
+	}
+
+	json to_json() const override {
+
+		json j;
+		j["type"] = "anomaly";
+		j["series"] = source;
+		j["value"] = double_to_string(value, 2);
+		j["expected"] = double_to_string(expected, 2);
+		j["score"] = double_to_string(score, 1);
+		return j;
+	}
+
+	std::string series() const override {
+		return "anomaly." + source;
+	}
+
+	double get_value() const override {
+		return score;
+	}
+
+	void set_value(double value) override {
+		score = value;
+	}
+
+
+	std::string source;
+	double value;
+	double expected; // the forecast of the baseline
+	double score; // signed, in standard deviations of the forecast error
+};
+
 //helper-class for calculating the load on a cpu
 struct CpuStats {
 
@@ -90,6 +862,8 @@ struct CpuStats {
 		, softirq
 		, steal;
 
+	bool present = false; // the cpu had a line in /proc/stat, it is offline otherwise
+
 	inline std::uint64_t total() const {
 		return user +
 			+ nice +
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "netlink_socket.hpp"
+#include "batch_reader.hpp"
+#include "proc_snapshot.hpp"
+
+
+//helper-struct with the cumulative counters of one network interface
+struct NetCounters {
+
+	std::uint64_t rx_bytes
+		, rx_packets
+		, rx_errors
+		, rx_drops
+		, tx_bytes
+		, tx_packets
+		, tx_errors
+		, tx_drops;
+};
+
+
+// per-second rates of one network interface between two consecutive reads
+struct NetRates {
+
+	std::string interface;
+	double rx_bytes;
+	double rx_packets;
+	double rx_errors;
+	double rx_drops;
+	double tx_bytes;
+	double tx_packets;
+	double tx_errors;
+	double tx_drops;
+};
+
+
+// where the counters are taken from:
+//  - netlink: one RTM_GETSTATS dump with the binary rtnl_link_stats64 of every interface, no text parsing at all;
+//    names come from an RTM_GETLINK dump that is repeated only when the set of interfaces changes
+//    (a full RTM_GETLINK dump with statistics is slower than /proc/net/dev because of all the other link
+//    attributes); falls back to procfs if a netlink socket can't be opened or the kernel rejects RTM_GETSTATS
+//  - procfs: one pread of /proc/net/dev per tick, the kernel formats every interface of the namespace
+//  - sysfs: one pread per counter of /sys/class/net/<if>/statistics/*, cheaper when only a few interfaces
+//    out of many are selected
+enum class NetSource { netlink, procfs, sysfs };
+
+
+// reads the counters of the interfaces matching the glob patterns and computes their rates;
+// the previous tick is kept in a flat array indexed by ifindex
+struct NetStatsReader {
+
+	NetStatsReader(std::vector<std::string> patterns, NetSource source, ProcSnapshot& snapshot);
+
+	// fills `out` with the rates since the previous call (the first call reports zeros)
+	void sample(std::vector<NetRates>& out);
+
+	static NetSource parse_source(const std::string& name);
+
+private:
+
+	struct Interface {
+		std::string name;
+		unsigned ifindex = 0;
+		bool selected = false;
+		std::vector<ProcFile> counters; // sysfs only, in the order of the NetCounters fields
+		std::size_t first_slot = 0; // sysfs only, the slot of the first counter in the batch
+	};
+
+	bool matches(const std::string& name) const;
+
+	void sample_procfs(double seconds, std::vector<NetRates>& out);
+
+	void sample_sysfs(double seconds, std::vector<NetRates>& out);
+
+	void sample_netlink(double seconds, std::vector<NetRates>& out);
+
+	void refresh_netlink_names();
+
+	void reserve_ifindex(unsigned ifindex);
+
+	void open_procfs(ProcSnapshot& snapshot);
+
+	// re-creates the interface table from the list of names, opening sysfs counters if needed
+	void rebuild(const std::vector<std::string>& names);
+
+	bool sysfs_layout_changed() const;
+
+	std::vector<std::string> list_sysfs_interfaces() const;
+
+	void push_rates(const Interface& iface, const NetCounters& curr, double seconds, std::vector<NetRates>& out);
+
+	static bool parse_line(std::string_view line, std::string_view& name, NetCounters& counters);
+
+private:
+
+	NetSource source;
+	SharedProcFile* proc_net_dev = nullptr; // procfs only
+	std::vector<std::string> patterns;
+	std::unique_ptr<NetlinkSocket> netlink;
+	BatchReader sysfs_batch; // the counters of all the selected interfaces, read together
+	std::vector<Interface> interfaces; // procfs: slot i is the i-th interface line of /proc/net/dev, netlink: indexed by ifindex
+	std::vector<NetCounters> prev; // indexed by ifindex
+	std::vector<char> has_prev; // indexed by ifindex
+	std::vector<NetCounters> curr; // netlink only, indexed by ifindex
+	std::vector<char> seen; // netlink only, the ifindexes present in the last dump
+	std::size_t netlink_count = 0;
+	std::chrono::steady_clock::time_point prev_time;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <linux/netlink.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+
+// a netlink socket that is opened once and reused for a dump request on every tick;
+// the receive buffer is allocated up front so that a dump doesn't allocate
+struct NetlinkSocket {
+
+	explicit NetlinkSocket(int protocol, std::size_t buffer_size = 64 * 1024)
+		: buffer(buffer_size)
+	{
+		fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, protocol);
+		if (fd < 0) {
+			throw std::runtime_error(std::string("Failed to open a netlink socket: ") + std::strerror(errno));
+		}
+
+		sockaddr_nl local{};
+		local.nl_family = AF_NETLINK;
+		if (::bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0) {
+			int err = errno;
+			::close(fd);
+			throw std::runtime_error(std::string("Failed to bind a netlink socket: ") + std::strerror(err));
+		}
+	}
+
+	NetlinkSocket(const NetlinkSocket&) = delete;
+
+	NetlinkSocket& operator=(const NetlinkSocket&) = delete;
+
+	NetlinkSocket(NetlinkSocket&& other) noexcept
+		: fd(other.fd)
+		, seq(other.seq)
+		, buffer(std::move(other.buffer))
+	{
+		other.fd = -1;
+	}
+
+	NetlinkSocket& operator=(NetlinkSocket&& other) noexcept {
+
+		if (&other != this) {
+			if (fd >= 0) ::close(fd);
+			fd = other.fd;
+			seq = other.seq;
+			buffer = std::move(other.buffer);
+			other.fd = -1;
+		}
+		return *this;
+	}
+
+	~NetlinkSocket() {
+
+		if (fd >= 0) {
+			::close(fd);
+		}
+	}
+
+	// sends `request` (an nlmsghdr followed by the family header and attributes) with NLM_F_DUMP set
+	// and calls on_message(const nlmsghdr*) for every message of the reply, so the caller can aggregate
+	// while the dump is streaming instead of keeping it in memory
+	template<typename F>
+	void dump(nlmsghdr* request, F&& on_message) {
+
+		request->nlmsg_flags |= NLM_F_REQUEST | NLM_F_DUMP;
+		request->nlmsg_seq = ++seq;
+
+		sockaddr_nl kernel{};
+		kernel.nl_family = AF_NETLINK;
+		if (::sendto(fd, request, request->nlmsg_len, 0, reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel)) < 0) {
+			throw std::runtime_error(std::string("Failed to send a netlink request: ") + std::strerror(errno));
+		}
+
+		while (true) {
+
+			ssize_t received = ::recv(fd, buffer.data(), buffer.size(), 0);
+			if (received < 0) {
+				if (errno == EINTR) continue;
+				throw std::runtime_error(std::string("Failed to receive a netlink reply: ") + std::strerror(errno));
+			}
+
+			int len = static_cast<int>(received);
+			auto* nh = reinterpret_cast<nlmsghdr*>(buffer.data());
+			for (; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+
+				if (nh->nlmsg_seq != seq) continue; // a late reply to an earlier request
+
+				if (nh->nlmsg_type == NLMSG_DONE) {
+					return;
+				}
+				if (nh->nlmsg_type == NLMSG_ERROR) {
+					auto* err = static_cast<nlmsgerr*>(NLMSG_DATA(nh));
+					throw std::runtime_error(std::string("Netlink dump failed: ") + std::strerror(-err->error));
+				}
+
+				on_message(nh);
+			}
+		}
+	}
+
+private:
+
+	int fd = -1;
+	std::uint32_t seq = 0;
+	std::vector<char> buffer;
+};
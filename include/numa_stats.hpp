@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "proc_file.hpp"
+
+
+// cpus ordered so that every group (a NUMA node or a socket) is a contiguous range
+struct CpuGrouping {
+
+	struct Group {
+		std::string name; // node0, socket1, ...
+		std::size_t begin;
+		std::size_t end;
+	};
+
+	std::vector<int> cpus;
+	std::vector<Group> groups;
+
+	// nullptr if there is no such group
+	const Group* find(std::string_view name) const;
+};
+
+
+// the NUMA nodes and sockets of the machine; read once at startup, hotplug isn't followed
+struct CpuTopology {
+
+	CpuGrouping nodes;
+	CpuGrouping sockets;
+
+	// root is the sysfs directory with the cpu/ and node/ subdirectories; a kernel without NUMA support
+	// has no node/ directory and gets a single node0 with all cpus
+	static CpuTopology read(const std::string& root = "/sys/devices/system");
+
+	// "node0" or "socket1" -> the group, nullptr if the name is unknown
+	const CpuGrouping::Group* find(std::string_view name, const CpuGrouping** grouping) const;
+
+	// "0-3,8-11" -> {0, 1, 2, 3, 8, 9, 10, 11}
+	static std::vector<int> parse_cpulist(std::string_view list);
+};
+
+
+// memory of one NUMA node and the rates of its numastat counters between two consecutive reads
+struct NumaNodeStats {
+
+	int node;
+	double total; // GB
+	double free; // GB
+	double used; // GB
+	double numa_hit; // per second: allocations intended for this node that succeeded here
+	double numa_miss; // per second: allocations that landed here because the intended node was full
+	double numa_foreign; // per second: allocations intended for this node that landed elsewhere
+	double local_node; // per second: allocations of processes running on this node
+	double other_node; // per second: allocations made here by processes running on other nodes
+};
+
+
+// reads node<N>/meminfo and node<N>/numastat of the selected nodes through persistent fds
+struct NumaStatsReader {
+
+	// an empty list selects every online node
+	explicit NumaStatsReader(std::vector<int> nodes, const std::string& root = "/sys/devices/system/node");
+
+	// fills `out` with one entry per node in the configured order (the first call reports zero rates)
+	void sample(std::vector<NumaNodeStats>& out);
+
+private:
+
+	struct Node {
+		int id;
+		ProcFile meminfo;
+		ProcFile numastat;
+		std::uint64_t prev[5]; // numa_hit, numa_miss, numa_foreign, local_node, other_node
+	};
+
+private:
+
+	std::vector<Node> nodes;
+	std::chrono::steady_clock::time_point prev_time;
+	bool has_prev = false;
+};
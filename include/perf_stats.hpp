@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+// rates of one cpu between two consecutive reads; which of them are filled depends on PerfStatsReader::hardware()
+struct PerfRates {
+
+	int cpu;
+	double ipc; // instructions per cycle
+	double cache_miss_rate; // % of last level cache references that missed
+	double branch_miss_rate; // % of branches that were mispredicted
+	double context_switches; // per second
+	double cpu_migrations; // per second
+	double page_faults; // per second
+};
+
+
+// one perf_event_open group on one cpu: the leader and its members are scheduled on the PMU together
+// and read with a single read() thanks to PERF_FORMAT_GROUP
+struct PerfGroup {
+
+	static constexpr std::size_t MAX_EVENTS = 4;
+
+	// read() layout with PERF_FORMAT_GROUP | TOTAL_TIME_ENABLED | TOTAL_TIME_RUNNING: nr, enabled, running, values[nr]
+	using Values = std::array<std::uint64_t, 3 + MAX_EVENTS>;
+
+	PerfGroup() = default;
+
+	PerfGroup(const PerfGroup&) = delete;
+
+	PerfGroup& operator=(const PerfGroup&) = delete;
+
+	PerfGroup(PerfGroup&& other) noexcept;
+
+	PerfGroup& operator=(PerfGroup&& other) noexcept;
+
+	~PerfGroup();
+
+	// returns 0 or the errno of perf_event_open
+	int add(std::uint32_t type, std::uint64_t config, int cpu);
+
+	// reads all counters of the group with one syscall
+	void read();
+
+	// the increase of the event-th counter between the two last reads
+	std::uint64_t delta(std::size_t event) const;
+
+	bool has_prev = false;
+
+private:
+
+	void close();
+
+private:
+
+	std::array<int, MAX_EVENTS> fds{ -1, -1, -1, -1 };
+	std::size_t size = 0;
+	Values prev{};
+	Values curr{};
+};
+
+
+// per-cpu hardware counters (IPC, cache and branch miss rates) read via perf_event_open;
+// falls back to software events (task-clock, context switches, ...) when there is no hardware PMU, e.g. in VMs
+struct PerfStatsReader {
+
+	explicit PerfStatsReader(const std::vector<int>& cpus);
+
+	bool hardware() const {
+		return is_hardware;
+	}
+
+	void sample(std::vector<PerfRates>& out);
+
+private:
+
+	// returns false if the hardware events aren't supported on this machine
+	bool open_hardware(int cpu, std::vector<PerfGroup>& groups);
+
+	void open_software(int cpu, std::vector<PerfGroup>& groups);
+
+private:
+
+	struct CpuGroups {
+		int cpu;
+		std::vector<PerfGroup> groups;
+	};
+
+	std::vector<CpuGroups> cpus;
+	bool is_hardware = true;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+/*
+ * The C ABI of the collector plugins ({"type": "plugin", "path": "libfoo.so"}).
+ *
+ * A plugin is a shared object exporting
+ *
+ *     const sm_plugin* sm_plugin_entry(void);
+ *
+ * The returned table must stay valid until the library is unloaded. The monitor checks abi_version,
+ * calls init() once with the "config" object of the metric serialized to JSON, collect() every tick
+ * from a worker thread (never concurrently for the same state) and destroy() before unloading.
+ * Nothing allocated by one side is freed by the other one, and exceptions must not leave the plugin.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SM_PLUGIN_ABI_VERSION 1
+#define SM_PLUGIN_ENTRY "sm_plugin_entry"
+#define SM_SAMPLE_NAME_MAX 64
+
+/* one value, written by the plugin into the buffer owned by the monitor */
+typedef struct sm_sample {
+	char name[SM_SAMPLE_NAME_MAX]; /* NUL-terminated */
+	double value;
+} sm_sample;
+
+typedef struct sm_plugin {
+
+	uint32_t abi_version; /* SM_PLUGIN_ABI_VERSION */
+	const char* name; /* reported with every sample */
+
+	/* returns the plugin state or NULL, with a message in `error`, if the plugin can't work */
+	void* (*init)(const char* config_json, char* error, size_t error_size);
+
+	/* writes up to `capacity` samples; returns how many were written or -1, with a message in `error` */
+	int (*collect)(void* state, sm_sample* samples, size_t capacity, char* error, size_t error_size);
+
+	void (*destroy)(void* state);
+
+} sm_plugin;
+
+typedef const sm_plugin* (*sm_plugin_entry_fn)(void);
+
+#ifdef __cplusplus
+}
+#endif
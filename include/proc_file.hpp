@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+
+// keeps a /proc (or sysfs) file open for the whole lifetime of the monitor and re-reads it with
+// pread at offset 0, so a tick costs one syscall and no allocations once the buffer has grown
+struct ProcFile {
+
+	ProcFile() = default;
+
+	explicit ProcFile(const std::string& path, std::size_t initial_capacity = 4096) {
+		open(path, initial_capacity);
+	}
+
+	ProcFile(const ProcFile&) = delete;
+
+	ProcFile& operator=(const ProcFile&) = delete;
+
+	ProcFile(ProcFile&& other) noexcept
+		: fd(other.fd)
+		, path(std::move(other.path))
+		, buffer(std::move(other.buffer))
+	{
+		other.fd = -1;
+	}
+
+	ProcFile& operator=(ProcFile&& other) noexcept {
+
+		if (&other != this) {
+			close();
+			fd = other.fd;
+			path = std::move(other.path);
+			buffer = std::move(other.buffer);
+			other.fd = -1;
+		}
+		return *this;
+	}
+
+	~ProcFile() {
+		close();
+	}
+
+	void open(const std::string& file_path, std::size_t initial_capacity = 4096) {
+
+		close();
+		fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			throw std::runtime_error("Failed to open " + file_path + ": " + std::strerror(errno));
+		}
+		path = file_path;
+		buffer.resize(initial_capacity);
+	}
+
+	bool is_open() const {
+		return fd >= 0;
+	}
+
+	int get_fd() const {
+		return fd;
+	}
+
+	const std::string& get_path() const {
+		return path;
+	}
+
+	// returns the whole content of the file; the view stays valid until the next read()
+	std::string_view read() {
+
+		if (fd < 0) {
+			throw std::runtime_error("Attempt to read a closed file");
+		}
+
+		// seq_file-based /proc files return short reads (whole records only), so we keep reading until EOF
+		std::size_t size = 0;
+		while (true) {
+
+			if (size == buffer.size()) {
+				buffer.resize(buffer.size() * 2); // grows once, the following ticks won't allocate
+			}
+
+			ssize_t n = ::pread(fd, buffer.data() + size, buffer.size() - size, static_cast<off_t>(size));
+			if (n < 0) {
+				if (errno == EINTR) continue;
+				throw std::runtime_error("Failed to read " + path + ": " + std::strerror(errno));
+			}
+			if (n == 0) {
+				return std::string_view(buffer.data(), size);
+			}
+
+			size += static_cast<std::size_t>(n);
+		}
+	}
+
+	// a single pread for sysfs attributes, which always return their whole (at most a page long) value at once;
+	// saves the second syscall read() makes to see the EOF, which adds up with hundreds of files per tick
+	std::string_view read_attribute() {
+
+		if (fd < 0) {
+			throw std::runtime_error("Attempt to read a closed file");
+		}
+
+		while (true) {
+
+			ssize_t n = ::pread(fd, buffer.data(), buffer.size(), 0);
+			if (n >= 0) {
+				return std::string_view(buffer.data(), static_cast<std::size_t>(n));
+			}
+			if (errno != EINTR) {
+				throw std::runtime_error("Failed to read " + path + ": " + std::strerror(errno));
+			}
+		}
+	}
+
+	void close() {
+
+		if (fd >= 0) {
+			::close(fd);
+			fd = -1;
+		}
+	}
+
+private:
+
+	int fd = -1;
+	std::string path;
+	std::vector<char> buffer;
+};
+
+
+// allocation-free helpers for tokenizing the text of /proc files
+
+namespace proc_parse {
+
+	inline void skip_spaces(std::string_view& s) {
+
+		std::size_t i = 0;
+		while (i < s.size() && (s[i] == ' ' || s[i] == '\t')) ++i;
+		s.remove_prefix(i);
+	}
+
+	// extracts the next whitespace-delimited token from the current line
+	inline std::string_view next_token(std::string_view& s) {
+
+		skip_spaces(s);
+		std::size_t i = 0;
+		while (i < s.size() && s[i] != ' ' && s[i] != '\t' && s[i] != '\n') ++i;
+		auto token = s.substr(0, i);
+		s.remove_prefix(i);
+		return token;
+	}
+
+	inline std::uint64_t next_u64(std::string_view& s) {
+
+		skip_spaces(s);
+		std::uint64_t value = 0;
+		std::size_t i = 0;
+		while (i < s.size() && s[i] >= '0' && s[i] <= '9') {
+			value = value * 10 + static_cast<std::uint64_t>(s[i] - '0');
+			++i;
+		}
+		s.remove_prefix(i);
+		return value;
+	}
+
+	// splits off the next line (without '\n'); returns false when the text is exhausted
+	inline bool next_line(std::string_view& text, std::string_view& line) {
+
+		if (text.empty()) return false;
+
+		auto pos = text.find('\n');
+		if (pos == std::string_view::npos) {
+			line = text;
+			text = std::string_view{};
+		}
+		else {
+			line = text.substr(0, pos);
+			text.remove_prefix(pos + 1);
+		}
+		return true;
+	}
+
+	// calls f(cpu_id, rest_of_line) for every "cpuN ..." line, the aggregate "cpu" line is skipped;
+	// shared by the per-core readers of /proc/stat and /proc/schedstat
+	template<typename F>
+	void for_each_cpu_line(std::string_view text, F&& f) {
+
+		std::string_view line;
+		while (next_line(text, line)) {
+
+			if (line.size() < 4 || line.compare(0, 3, "cpu") != 0 || line[3] < '0' || line[3] > '9') {
+				continue;
+			}
+
+			line.remove_prefix(3);
+			int cpu = static_cast<int>(next_u64(line));
+			f(cpu, line);
+		}
+	}
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "metrics.hpp"
+#include "proc_file.hpp"
+
+
+// a /proc file as seen by one tick: the first read() of a tick preads it, every following read() of the same
+// tick returns the same text, whichever collector and thread it comes from
+struct SharedProcFile {
+
+	SharedProcFile(const std::string& path, std::size_t initial_capacity, const std::atomic<std::uint64_t>& tick);
+
+	// the view stays valid until the end of the tick
+	std::string_view read();
+
+	const std::string& get_path() const {
+		return file.get_path();
+	}
+
+private:
+
+	ProcFile file;
+	const std::atomic<std::uint64_t>& tick;
+	std::mutex mutex;
+	std::uint64_t read_tick = 0; // the tick `text` belongs to, 0 - never read
+	std::string_view text;
+};
+
+
+// the fields of /proc/meminfo the collectors use, in kB
+struct MemInfo {
+
+	std::uint64_t total_kb;
+	std::uint64_t free_kb;
+	std::uint64_t available_kb;
+};
+
+
+// the /proc sources of one tick: every file is read once per tick however many collectors use it, and the
+// commonly shared parses (per-cpu times, meminfo) are done once as well; the collectors keep their own
+// previous values, so two "cpu" entries still compute their deltas independently
+struct ProcSnapshot {
+
+	// `root` is the /proc the snapshot's own parses read, a fixture tree in the tests
+	explicit ProcSnapshot(std::string root = "/proc")
+		: root(std::move(root))
+	{}
+
+	// the file is opened on the first call; call from prepare(), the returned reference lives as long as the snapshot
+	SharedProcFile& file(const std::string& path, std::size_t initial_capacity = 4096);
+
+	// the "cpuN" lines of /proc/stat indexed by N, valid until the end of the tick; the vector has an entry up to
+	// the highest cpu seen so far, the entries of the offline cpus aren't `present`
+	const std::vector<CpuStats>& cpu_times();
+
+	const MemInfo& mem_info();
+
+	// called by the monitor before the collectors of a new tick run
+	void next_tick() {
+		tick.fetch_add(1, std::memory_order_release);
+	}
+
+private:
+
+	// `parse` fills `value` from the text of `source` unless it has been done during this tick
+	template<typename T, typename Parse>
+	const T& parsed(SharedProcFile& source, std::uint64_t& parsed_tick, T& value, Parse&& parse);
+
+private:
+
+	std::string root;
+	std::atomic<std::uint64_t> tick{ 1 };
+	std::mutex files_mutex;
+	std::map<std::string, std::unique_ptr<SharedProcFile>> files;
+
+	std::mutex parse_mutex;
+	std::uint64_t cpu_times_tick = 0;
+	std::vector<CpuStats> times;
+	std::uint64_t mem_info_tick = 0;
+	MemInfo meminfo{};
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+
+// DDSketch (Masson, Rim, Lee, VLDB 2019): values are counted in logarithmic buckets, so every quantile is
+// returned with a relative error of at most `accuracy`, and two sketches with the same accuracy are merged by
+// adding up their buckets.
+//
+// Memory is bounded: positive and negative values have a dense store of at most MAX_BINS 4-byte counters each;
+// if a store would get wider, its lowest buckets (the values closest to zero) are collapsed into one, which
+// only affects the quantiles that fall into them. With the default 1% accuracy 2048 buckets span 17 orders of
+// magnitude, so real metrics don't get there: the worst case is 2 * 2048 * 4 = 16 KiB per sketch, a series
+// that stays within [1, 100] needs ~230 buckets (under 1 KiB). clear() keeps the memory for the next window.
+struct QuantileSketch {
+
+	static constexpr std::size_t MAX_BINS = 2048;
+
+	explicit QuantileSketch(double accuracy = 0.01);
+
+	// NaN, a missing sample, isn't counted
+	void add(double value);
+
+	// `other` must have the same accuracy
+	void merge(const QuantileSketch& other);
+
+	// q in [0, 1]; 0 for an empty sketch, the exact maximum for q = 1
+	double quantile(double q) const;
+
+	double max() const {
+		return max_value;
+	}
+
+	std::uint64_t count() const {
+		return total;
+	}
+
+	void clear();
+
+private:
+
+	// counters of the consecutive keys [offset, offset + counts.size())
+	struct Store {
+
+		void add(int key, std::uint64_t n);
+
+		void clear() {
+			counts.clear();
+			offset = 0;
+		}
+
+		std::vector<std::uint32_t> counts;
+		int offset = 0;
+	};
+
+	int key(double value) const;
+
+	// the value every number counted under `key` is reported as, within `accuracy` of all of them
+	double value_of(int key) const;
+
+private:
+
+	double gamma;
+	double log_gamma;
+	double min_value; // smaller magnitudes are counted as zero
+	Store positive;
+	Store negative; // keyed by the magnitude
+	std::uint64_t zeros = 0;
+	std::uint64_t total = 0;
+	double max_value = 0;
+};
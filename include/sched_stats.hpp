@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "proc_snapshot.hpp"
+
+
+// run-queue latency of one cpu or one process between two consecutive reads
+struct SchedLatency {
+
+	bool is_pid; // false - `id` is a cpu, true - `id` is a pid
+	int id;
+	double delay; // ms spent waiting on a run queue per second
+	double avg_wait; // us of waiting per timeslice
+};
+
+
+// reads the time spent waiting on the run queues from /proc/schedstat (per cpu) and /proc/<pid>/schedstat
+// (per process); the files are kept open and re-read with pread, /proc/schedstat is shared through the snapshot
+struct SchedStatsReader {
+
+	SchedStatsReader(const std::vector<int>& cpus, const std::vector<int>& pids, ProcSnapshot& snapshot);
+
+	// fills `out` with the latencies since the previous call (the first call reports zeros);
+	// processes that have exited are left out
+	void sample(std::vector<SchedLatency>& out);
+
+private:
+
+	struct Counters {
+		std::uint64_t wait_ns;
+		std::uint64_t timeslices;
+		bool has_prev;
+	};
+
+	struct Task {
+		int pid;
+		ProcFile file;
+		Counters prev;
+	};
+
+	void push(bool is_pid, int id, std::uint64_t wait_ns, std::uint64_t timeslices
+		, Counters& prev, double seconds, std::vector<SchedLatency>& out);
+
+private:
+
+	SharedProcFile* schedstat = nullptr; // only if there are cpus
+	std::vector<int> cpus;
+	std::vector<Counters> cpu_prev; // indexed by cpu id
+	std::vector<Task> tasks;
+	std::chrono::steady_clock::time_point prev_time;
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "hdr_histogram.hpp"
+
+
+// the monitor's own instrumentation: how long every collector and every output takes. Each thread records
+// into its own histograms without locks or shared cache lines; a reader merges the threads whenever it needs
+// the distribution (the "self" metric type). A step that filters samples (an output with a deadband) also
+// counts how many it got and how many it dropped
+struct SelfStats {
+
+	struct Filtered {
+		std::uint64_t total = 0;
+		std::uint64_t suppressed = 0;
+	};
+
+	SelfStats();
+
+	// the steps are registered before recording starts (when the monitor is built), returns the step id
+	std::size_t add_step(const std::string& name, bool filters = false);
+
+	const std::vector<std::string>& steps() const {
+		return names;
+	}
+
+	bool filters(std::size_t step) const {
+		return filtering[step];
+	}
+
+	void count_filtered(std::size_t step, std::uint64_t total, std::uint64_t suppressed) {
+
+		counters[step].total.fetch_add(total, std::memory_order_relaxed);
+		counters[step].suppressed.fetch_add(suppressed, std::memory_order_relaxed);
+	}
+
+	// everything counted for `step` since the start
+	Filtered filtered(std::size_t step) const {
+		return { counters[step].total.load(std::memory_order_relaxed), counters[step].suppressed.load(std::memory_order_relaxed) };
+	}
+
+	// lock-free except for the first call on a new thread, which registers the thread's histograms
+	void record(std::size_t step, std::chrono::steady_clock::duration elapsed);
+
+	// out = the sum over the threads of everything recorded for `step` since the start
+	void merge(std::size_t step, HdrHistogram& out) const;
+
+private:
+
+	struct Thread {
+
+		explicit Thread(std::size_t steps)
+			: histograms(steps)
+		{}
+
+		std::vector<HdrHistogram> histograms; // indexed by step, never resized
+	};
+
+	Thread& local();
+
+private:
+
+	struct Counters {
+		std::atomic<std::uint64_t> total{0};
+		std::atomic<std::uint64_t> suppressed{0};
+	};
+
+	std::uint64_t id; // unique in the process
+	std::vector<std::string> names;
+	std::vector<bool> filtering; // parallel to names
+	std::deque<Counters> counters; // parallel to names, a deque as the atomics can't be moved
+	mutable std::mutex threads_mutex; // guards `threads` only, never held while recording
+	std::vector<std::unique_ptr<Thread>> threads;
+};
+
+
+// records the time from its construction to its destruction into a step
+struct ScopedTimer {
+
+	ScopedTimer(SelfStats& stats, std::size_t step)
+		: stats(stats)
+		, step(step)
+		, start(std::chrono::steady_clock::now())
+	{}
+
+	ScopedTimer(const ScopedTimer&) = delete;
+
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+	~ScopedTimer() {
+		stats.record(step, std::chrono::steady_clock::now() - start);
+	}
+
+private:
+
+	SelfStats& stats;
+	std::size_t step;
+	std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+#include "metrics.hpp"
+
+
+// a fixed set of series names bound to their positions in the tick's batch, for the stages that read a few known
+// series every tick (derived metrics, alerts). The names are registered once when the stage is built; the binding
+// is made on the first tick and only remade when the batch layout changes, so read() neither looks up strings nor
+// allocates.
+//
+// A layout matches a binding if the batch has the same size and the bound metrics the same dynamic types. A series
+// replaced by another of the same type (a disk swapped for another one) keeps both, so whenever a collector reports
+// a changed layout (SampleBatch::layout_changed) the monitor calls series_changed() and every binding is checked by
+// name once before it is used again. Up to MAX_BINDINGS layouts are kept, since with adaptive sampling the batch
+// alternates between the layouts of the collectors that are due
+struct SeriesSlots {
+
+	// `owner` prefixes the warning about the series that aren't collected
+	explicit SeriesSlots(const char* owner);
+
+	// the slot of `name`, the same one for the same name; a slot that isn't `from_batch` is never bound, its
+	// owner writes it (a derived series used by a later expression)
+	std::size_t add(const std::string& name, bool from_batch = true);
+
+	// every slot gets the value of its series in `metrics`, NaN if the series isn't there
+	void read(const std::vector<std::unique_ptr<Metric>>& metrics);
+
+	double& operator[](std::size_t slot) {
+		return values[slot];
+	}
+
+	double operator[](std::size_t slot) const {
+		return values[slot];
+	}
+
+	std::size_t size() const {
+		return names.size();
+	}
+
+	const std::string& name(std::size_t slot) const {
+		return names[slot];
+	}
+
+	// called by the monitor when a collector's series have changed, for all the SeriesSlots at once
+	static void series_changed() {
+		generation.fetch_add(1, std::memory_order_relaxed);
+	}
+
+private:
+
+	struct Binding {
+		std::size_t size = 0;
+		std::vector<std::size_t> positions; // in the batch by slot, SIZE_MAX if the series isn't there
+		std::vector<const std::type_info*> types;
+		std::uint64_t used = 0; // the tick it last matched
+		std::uint64_t verified = 0; // the generation its names were last checked at
+	};
+
+	bool matches(Binding& binding, const std::vector<std::unique_ptr<Metric>>& metrics) const;
+
+	Binding& bind(const std::vector<std::unique_ptr<Metric>>& metrics);
+
+	static constexpr std::size_t MAX_BINDINGS = 8;
+
+private:
+
+	const char* owner;
+	std::vector<std::string> names;
+	std::unordered_map<std::string, std::size_t> slot_of; // names -> slot, only used by add()
+	std::vector<bool> from_batch;
+	std::vector<double> values;
+	std::vector<Binding> bindings;
+	std::size_t current = 0; // the binding of the last tick, tried first
+	std::uint64_t ticks = 0;
+
+	static inline std::atomic<std::uint64_t> generation{ 0 };
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "netlink_socket.hpp"
+#include "proc_snapshot.hpp"
+
+
+// accept queue of one listening address (SO_REUSEPORT groups are summed up)
+struct ListenerQueue {
+
+	std::string address; // "ip:port"
+	double accept_queue; // connections waiting for accept()
+	double backlog; // the limit passed to listen()
+};
+
+
+struct SocketCounterRate {
+
+	std::string name; // "Section:Field", e.g. "Tcp:RetransSegs"
+	double value; // per second
+};
+
+
+struct SocketSample {
+
+	static constexpr std::size_t STATES_COUNT = 13; // TCP_ESTABLISHED (1) .. TCP_NEW_SYN_RECV (12)
+
+	std::array<std::uint64_t, STATES_COUNT> states; // number of TCP sockets in each state
+	std::vector<ListenerQueue> listeners;
+	std::vector<SocketCounterRate> counters;
+
+	static const char* state_name(std::size_t state);
+};
+
+
+// counts TCP sockets with NETLINK_SOCK_DIAG: the dump is aggregated while it is streaming, so memory doesn't
+// depend on the number of sockets; protocol counters are taken from /proc/net/snmp and /proc/net/netstat
+struct SocketStatsReader {
+
+	// `counters` are "Section:Field" names from /proc/net/snmp or /proc/net/netstat, they are resolved
+	// into (line, column) pairs here once, so a tick only looks at the requested columns
+	SocketStatsReader(const std::vector<std::string>& counters, ProcSnapshot& snapshot);
+
+	void sample(SocketSample& out);
+
+private:
+
+	struct Listener {
+		int family;
+		std::uint8_t address[16];
+		std::uint16_t port;
+		std::uint64_t accept_queue;
+		std::uint64_t backlog;
+		std::size_t next; // the next listener on the same family and port, SIZE_MAX at the end
+	};
+
+	struct CounterSlot {
+		std::size_t file; // 0 - /proc/net/snmp, 1 - /proc/net/netstat
+		std::size_t line; // the number of the line with the values
+		std::size_t column;
+		std::string name;
+	};
+
+	void dump_family(int family, SocketSample& out);
+
+	void resolve_counter(const std::string& counter, ProcSnapshot& snapshot);
+
+	static std::string format_address(const Listener& listener);
+
+private:
+
+	NetlinkSocket sock_diag;
+	std::array<SharedProcFile*, 2> snmp_files{}; // opened when a counter is resolved
+	std::vector<CounterSlot> counter_slots;
+	std::vector<std::uint64_t> prev_counters;
+	std::vector<Listener> listeners; // reused between ticks
+	std::unordered_map<std::uint32_t, std::size_t> listener_index; // family << 16 | port -> the first listener, rebuilt per dump
+	std::chrono::steady_clock::time_point prev_time;
+	bool has_prev = false;
+};
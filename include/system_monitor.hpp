@@ -1,18 +1,34 @@
 #pragma once
 
+#include <chrono>
 #include <nlohmann/json.hpp>
 #include <vector>
 #include <fstream>
+#include <memory>
+#include <optional>
 #include <string>
+#include "adaptive_sampling.hpp"
+#include "aggregator.hpp"
+#include "alerts.hpp"
+#include "anomaly_detector.hpp"
+#include "burst_capture.hpp"
+#include "collector.hpp"
 #include "config.hpp"
+#include "config_watcher.hpp"
+#include "deadband.hpp"
+#include "derived_metrics.hpp"
 #include "metrics.hpp"
+#include "proc_snapshot.hpp"
+#include "self_stats.hpp"
 #include "thread_pool.hpp"
 
 using json = nlohmann::json;
 
 struct SystemMonitor {
 
-	SystemMonitor(const Config& config);
+	// takes the configured collectors out of the config and prepares them; the config file is then watched
+	// and re-applied whenever it changes (or on SIGHUP)
+	explicit SystemMonitor(Config& config);
 
 	~SystemMonitor();
 
@@ -20,25 +36,57 @@ struct SystemMonitor {
 
 private:
 
-	std::vector<CpuStats> get_cpu_times() const;
+	// builds everything the config describes and swaps it in. The collectors, stages and outputs whose entries
+	// are unchanged since the running config are carried over with their state (cpu deltas, open fds, alert
+	// states, baselines, the log file), the rest is built anew. Everything that can fail is done before the
+	// swap, so an exception leaves the running plan as it was
+	void apply(Config& config);
 
-	std::vector<std::unique_ptr<Metric>> collect_cpu_metrics(const json& metric) const;
+	// at a tick boundary: re-reads the config file, an invalid one is reported and the running plan kept
+	void reload();
 
-	std::vector<std::unique_ptr<Metric>> collect_memory_metrics(const json& metric) const;
+	// runs the collectors that are due at `now`
+	std::vector<std::unique_ptr<Metric>> collect_metrics(std::chrono::steady_clock::time_point now);
 
-	std::vector<std::unique_ptr<Metric>> collect_metrics() const;
+	void sleep_until_due(std::chrono::steady_clock::time_point now) const;
 
-	void output_metrics(const std::vector<std::unique_ptr<Metric>>& metrics);
+	static SampleBatch run_collector(Collector* collector, SelfStats* self, std::size_t step);
 
-	void read_mem_info(double& mem_total, double& mem_free, double& mem_availible) const;
+	// the events (alerts, anomalies) are written by every output as they are, the metrics through its deadband if any
+	void output_metrics(const std::vector<std::unique_ptr<Metric>>& metrics, const std::vector<std::unique_ptr<Metric>>& events);
 
 	std::string join(const std::vector<std::string>& vec, const std::string& delim) const;
 
 private:
 	
-	int period; // how often we should check the metrics
-	std::vector<json> metrics_config; // the metrics (cpu-load, free memory, etc.)
+	std::chrono::milliseconds period; // how often we should check the metrics
+	std::chrono::milliseconds collect_period{0}; // how often the collectors without "adaptive" run: the period or the burst rate
+	std::string config_path; // re-read on a reload
+	ProcSnapshot snapshot; // the /proc files shared by the collectors, declared before them as they keep references into it
+	json applied; // the config the running plan was built from, null before the first one
+	std::unique_ptr<SelfStats> self; // the latencies of the steps below, read by the "self" metric type; replaced on a reload
+	std::vector<std::unique_ptr<Collector>> collectors; // the metrics (cpu-load, free memory, etc.) in the order of the config
+	std::vector<json> collector_configs; // parallel to collectors: their "metrics" entries
+	std::vector<CollectorSchedule> schedules; // parallel to collectors: when each of them runs next
+	bool tag_resolution = false; // if any collector is adaptive, every sample says what interval it was taken at
 	std::vector<json> outputs; // where we should put the output
+	std::vector<std::optional<DeadbandFilter>> deadbands; // parallel to outputs
+	std::size_t collect_step; // the whole collect_metrics()
+	std::vector<std::size_t> collector_steps; // parallel to collectors
+	std::vector<std::size_t> output_steps; // parallel to outputs
+	DerivedMetrics derived{ {} }; // the "derived" entries, evaluated after every collection
+	std::size_t derived_step = 0;
+	Alerts alerts{ {} }; // the "alerts" rules, evaluated after the derived metrics
+	std::size_t alerts_step = 0;
+	std::optional<AnomalyDetector> anomaly; // only if "settings.anomaly" is configured
+	std::size_t anomaly_step = 0;
+	std::optional<Aggregator> aggregator; // only if the samples are written as windowed quantiles
+	std::unique_ptr<BurstCapture> burst; // only if "settings.burst" is configured: the collectors then run at its rate
+	std::size_t burst_step = 0;
+	std::size_t burst_ticks = 0;
+	std::size_t pipeline_every = 1; // with a burst capture, the stages after it run on every n-th tick, once a period
 	std::ofstream log_file;
-	mutable StaticThreadPool pool;
+	std::string log_path; // of the open log_file, empty if there's no "log" output
+	ConfigWatcher watcher;
+	StaticThreadPool pool; // kept running across reloads, grown when a config needs more workers
 };
\ No newline at end of file
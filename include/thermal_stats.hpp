@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "batch_reader.hpp"
+#include "proc_file.hpp"
+
+
+// frequency and throttling of one cpu; a field is only meaningful if the matching has_ flag is set,
+// since cpufreq and thermal_throttle depend on the driver (neither exists in most VMs)
+struct CpuThermal {
+
+	int cpu;
+	bool has_freq;
+	bool has_throttle; // core_throttle_count
+	bool has_package_throttle; // package_throttle_count
+	double freq; // MHz, scaling_cur_freq
+	double core_throttle; // throttling events per second
+	double package_throttle; // throttling events of the whole package per second
+};
+
+
+struct SensorTemp {
+
+	// "<hwmon name>/<label>", e.g. "coretemp/Core 0" or "nvme/temp1", or "<thermal zone type>/zone<N>", e.g. "acpitz/zone0"
+	std::string sensor;
+	double temp; // degrees Celsius
+};
+
+
+struct ThermalSample {
+
+	std::vector<CpuThermal> cpus;
+	std::vector<SensorTemp> sensors;
+};
+
+
+// cpufreq, thermal_throttle, hwmon and thermal zone readings from sysfs; every attribute is opened once and re-read at offset 0
+// through a BatchReader, so a tick is one io_uring submission for all the files (or one pread per file without
+// io_uring) and no open/close or allocation
+struct ThermalStatsReader {
+
+	// root is the sysfs mount point, so the reader can be pointed at a copy of the tree;
+	// an empty `cpus` selects every online cpu, sensor_patterns are matched against SensorTemp::sensor
+	ThermalStatsReader(const std::vector<int>& cpus, std::vector<std::string> sensor_patterns, const std::string& root = "/sys");
+
+	// the view stays valid until the next call; the first call reports zero throttling rates
+	const ThermalSample& sample();
+
+private:
+
+	struct CpuFiles {
+		ProcFile freq;
+		ProcFile core_throttle;
+		ProcFile package_throttle;
+		std::size_t freq_slot = 0, core_slot = 0, package_slot = 0; // in the batch, if the file is open
+		std::uint64_t prev_core = 0;
+		std::uint64_t prev_package = 0;
+	};
+
+	// opens `path` into `file` if it exists and can be read, returns false otherwise
+	static bool try_open(ProcFile& file, const std::string& path);
+
+	std::uint64_t read_value(std::size_t slot) const;
+
+	void open_sensors(const std::string& root);
+
+	void add_sensor(const std::string& sensor, const std::string& path);
+
+private:
+
+	std::vector<CpuFiles> cpu_files; // parallel to result.cpus
+	std::vector<ProcFile> sensor_files; // parallel to result.sensors
+	std::vector<std::size_t> sensor_slots; // parallel to result.sensors
+	BatchReader batch;
+	std::vector<std::string> patterns;
+	ThermalSample result;
+	std::chrono::steady_clock::time_point prev_time;
+	bool has_prev = false;
+};
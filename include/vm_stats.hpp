@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "proc_snapshot.hpp"
+
+
+struct VmRate {
+
+	std::string field; // a /proc/vmstat name, e.g. pgmajfault
+	double value; // per second for event counters, the current value for nr_* gauges
+	bool is_rate;
+};
+
+
+// reads the selected counters of /proc/vmstat; the selection (names or glob patterns) is compiled once into
+// a table of line numbers, so a tick only parses the requested lines and skips the others with memchr
+struct VmStatsReader {
+
+	VmStatsReader(std::vector<std::string> patterns, SharedProcFile& file);
+
+	// fills `out` with the rates since the previous call (the first call reports zeros); if the layout of the file
+	// has changed, the table is compiled again and the same text parsed with it, a field that kept its name keeps
+	// its previous value
+	void sample(std::vector<VmRate>& out);
+
+private:
+
+	struct Slot {
+		std::size_t line;
+		std::string field;
+		bool is_rate;
+		std::uint64_t prev;
+		bool has_prev;
+	};
+
+	// resolves the patterns against the current layout of the file
+	void compile(std::string_view text);
+
+	// the values of the slots' lines into `values`, false if a line isn't the slot's field any more
+	bool parse(std::string_view text);
+
+private:
+
+	SharedProcFile& file;
+	std::vector<std::string> patterns;
+	std::vector<Slot> slots; // sorted by line
+	std::vector<std::uint64_t> values; // scratch, parallel to slots
+	std::chrono::steady_clock::time_point prev_time;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+
+
+// the per-tick kernels of the stages that keep numeric state per series in columnar arrays: element i of every
+// array belongs to series i, and a tick folds its column of values into the state of all the series at once.
+// A NaN value is a series without a sample in that tick and leaves its state unchanged.
+//
+// accumulate(): the min/max/sum/sumsq of the aggregation window.
+// update(): the Holt-Winters baseline of the anomaly detector.
+//
+// Every element is computed on its own with the same operations in the same order by all the implementations,
+// so the vector paths return bit-for-bit the results of the scalar one (checked by tests/window_kernels_test.cpp),
+// as long as the build doesn't enable FMA contraction (e.g. with -march=native)
+namespace window_kernels {
+
+	enum class Isa { scalar, sse4, avx2 };
+
+	using Accumulate = void (*)(const double* values, std::size_t n, double* min, double* max, double* sum, double* sumsq);
+
+	// additive Holt-Winters: the forecast of a series is level + trend + season, where `season` is the component
+	// of the current phase of the season. With beta = gamma = 0 and a zero season this is an EWMA of the mean
+	struct BaselineParams {
+		double alpha; // the smoothing of the level and of the variance of the forecast error
+		double beta; // of the trend
+		double gamma; // of the seasonal component
+		double k2; // a sample is flagged if (x - forecast)^2 > k2 * variance
+		double min_var; // the variance never counts as smaller than this, so a flat series isn't flagged for noise
+		double warmup; // samples of a series before it can be flagged
+	};
+
+	struct BaselineColumns {
+		double* level;
+		double* trend;
+		double* season; // of the tick's phase
+		double* var;
+		double* seen; // samples so far
+		double* forecast; // out: what the tick's value was expected to be
+		double* score; // out: (x - forecast) / sigma of the flagged samples, 0 for the rest
+	};
+
+	using Update = void (*)(const double* values, std::size_t n, const BaselineParams& params, const BaselineColumns& columns);
+
+	// the widest implementation the CPU (CPUID, and the OS for the AVX state) supports, detected once;
+	// scalar on other architectures
+	Isa best();
+
+	// nullptr if the implementation isn't built for this architecture
+	Accumulate get(Isa isa);
+
+	// the same for update(); there is no 128-bit version, sse4 gets the scalar one
+	Update get_update(Isa isa);
+
+	const char* name(Isa isa);
+
+	// with the best implementation
+	void accumulate(const double* values, std::size_t n, double* min, double* max, double* sum, double* sumsq);
+
+	void update(const double* values, std::size_t n, const BaselineParams& params, const BaselineColumns& columns);
+
+}
@@ -0,0 +1,121 @@
+#include "adaptive_sampling.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+
+namespace {
+
+	std::chrono::milliseconds seconds_field(const json& adaptive, const char* field) {
+
+		if (!adaptive.contains(field) || !adaptive[field].is_number() || adaptive[field].get<double>() <= 0) {
+			throw std::runtime_error("Adaptive sampling requires '" + std::string(field) + "' as a positive number of seconds");
+		}
+		return std::chrono::milliseconds(std::max<std::int64_t>(1, std::llround(adaptive[field].get<double>() * 1000)));
+	}
+
+}
+
+
+AdaptiveOptions AdaptiveOptions::parse(const json& adaptive) {
+
+	if (!adaptive.is_object()) {
+		throw std::runtime_error("'adaptive' must be an object with 'min' and 'max' intervals");
+	}
+
+	AdaptiveOptions options;
+	options.min = seconds_field(adaptive, "min");
+	options.max = seconds_field(adaptive, "max");
+	if (options.max < options.min) {
+		throw std::runtime_error("Adaptive sampling 'max' must not be shorter than 'min'");
+	}
+
+	if (adaptive.contains("change")) {
+
+		if (!adaptive["change"].is_number() || adaptive["change"].get<double>() < 0) {
+			throw std::runtime_error("Adaptive sampling 'change' must be a non-negative fraction, e.g. 0.05 for 5%");
+		}
+		options.change = adaptive["change"].get<double>();
+	}
+
+	if (adaptive.contains("min_change")) {
+
+		if (!adaptive["min_change"].is_number() || adaptive["min_change"].get<double>() < 0) {
+			throw std::runtime_error("Adaptive sampling 'min_change' must be a non-negative number");
+		}
+		options.min_change = adaptive["min_change"].get<double>();
+	}
+
+	if (adaptive.contains("thresholds")) {
+
+		if (!adaptive["thresholds"].is_array()) {
+			throw std::runtime_error("Adaptive sampling 'thresholds' must be an array of numbers");
+		}
+		for (const auto& threshold : adaptive["thresholds"]) {
+
+			if (!threshold.is_number()) {
+				throw std::runtime_error("Adaptive sampling 'thresholds' must be an array of numbers");
+			}
+			options.thresholds.push_back(threshold.get<double>());
+		}
+	}
+
+	return options;
+}
+
+
+CollectorSchedule::CollectorSchedule(std::chrono::milliseconds period, std::optional<AdaptiveOptions> adaptive)
+	: options(std::move(adaptive))
+	, current(options ? options->min : period) // start fast, a flat signal backs off within a few runs
+{}
+
+
+void CollectorSchedule::update(const std::vector<std::unique_ptr<Metric>>& samples, std::chrono::steady_clock::time_point now) {
+
+	if (options) {
+
+		bool crossed = false;
+		bool volatile_signal = false;
+
+		// the previous values are matched by position: a collector's layout only changes when something comes
+		// or goes, and then the interval is simply kept for one run
+		if (previous.size() == samples.size()) {
+
+			for (std::size_t i = 0; i != samples.size(); ++i) {
+
+				double before = previous[i];
+				double value = samples[i]->get_value();
+
+				double delta = std::fabs(value - before);
+				if (delta > options->change * std::max(std::fabs(before), std::fabs(value)) && delta > options->min_change) {
+					volatile_signal = true;
+				}
+				for (double threshold : options->thresholds) {
+					if ((before < threshold) != (value < threshold)) {
+						crossed = true;
+					}
+				}
+			}
+
+			if (crossed) {
+				current = options->min;
+			}
+			else if (volatile_signal) {
+				current = std::max(options->min, current / 2);
+			}
+			else {
+				// by half, one millisecond at least so that a "min" of 1 ms still grows
+				current = std::min(options->max, current + std::max(current / 2, std::chrono::milliseconds(1)));
+			}
+		}
+
+		previous.resize(samples.size());
+		for (std::size_t i = 0; i != samples.size(); ++i) {
+			previous[i] = samples[i]->get_value();
+		}
+	}
+
+	// from the time of this run, so a slow collection doesn't make the next one due at once
+	next = now + current;
+}
@@ -0,0 +1,129 @@
+#include "aggregator.hpp"
+#include "window_kernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+
+namespace {
+
+	constexpr double NO_SAMPLE = std::numeric_limits<double>::quiet_NaN();
+	constexpr double INF = std::numeric_limits<double>::infinity();
+
+}
+
+
+Aggregator::Aggregator(std::chrono::milliseconds window, double accuracy)
+	: window(window)
+	, accuracy(accuracy)
+	, window_start(std::chrono::steady_clock::now())
+{}
+
+
+std::size_t Aggregator::find_series(const std::string& name) {
+
+	auto it = index.find(name);
+	if (it != index.end()) {
+		return it->second;
+	}
+
+	series.push_back({name, QuantileSketch(accuracy)});
+	index.emplace(name, series.size() - 1);
+
+	column.push_back(NO_SAMPLE);
+	min.push_back(INF);
+	max.push_back(-INF);
+	sum.push_back(0);
+	sumsq.push_back(0);
+	return series.size() - 1;
+}
+
+
+void Aggregator::add(const std::vector<std::unique_ptr<Metric>>& metrics) {
+
+	positions.resize(metrics.size(), SIZE_MAX);
+
+	for (std::size_t i = 0; i != metrics.size(); ++i) {
+
+		// the collectors produce the same series in the same order unless something (a disk, a process) has
+		// come or gone, so the name is compared with the one at the previous tick's position before the lookup;
+		// that still builds the name of every sample, it only saves the hashing
+		auto name = metrics[i]->series();
+		if (positions[i] == SIZE_MAX || series[positions[i]].name != name) {
+			positions[i] = find_series(name);
+		}
+
+		auto pos = positions[i];
+		double value = metrics[i]->get_value();
+		series[pos].sketch.add(value);
+
+		// a series reported twice in a tick (two identical collectors) folds its first sample right away
+		if (!std::isnan(column[pos])) {
+			window_kernels::accumulate(&column[pos], 1, &min[pos], &max[pos], &sum[pos], &sumsq[pos]);
+		}
+		column[pos] = value;
+	}
+
+	window_kernels::accumulate(column.data(), column.size(), min.data(), max.data(), sum.data(), sumsq.data());
+	std::fill(column.begin(), column.end(), NO_SAMPLE);
+}
+
+
+std::vector<std::unique_ptr<Metric>> Aggregator::flush(std::chrono::steady_clock::time_point now) {
+
+	std::vector<std::unique_ptr<Metric>> summary;
+	std::vector<std::size_t> moved(series.size(), SIZE_MAX); // old position -> new one, SIZE_MAX if forgotten
+	std::size_t kept = 0;
+
+	for (std::size_t i = 0; i != series.size(); ++i) {
+
+		auto& [name, sketch] = series[i];
+		auto n = sketch.count();
+		if (n == 0) {
+
+			// the series hasn't been reported during the whole window (a process or a disk is gone), so it's
+			// forgotten rather than kept forever; it starts over as a new series if it comes back
+			index.erase(name);
+			continue;
+		}
+
+		double mean = sum[i] / n;
+		double variance = std::max(0.0, sumsq[i] / n - mean * mean); // rounding can take it slightly below zero
+
+		summary.emplace_back(new QuantileMetric(name, "min", min[i], n));
+		summary.emplace_back(new QuantileMetric(name, "mean", mean, n));
+		summary.emplace_back(new QuantileMetric(name, "stddev", std::sqrt(variance), n));
+		summary.emplace_back(new QuantileMetric(name, "p50", sketch.quantile(0.5), n));
+		summary.emplace_back(new QuantileMetric(name, "p90", sketch.quantile(0.9), n));
+		summary.emplace_back(new QuantileMetric(name, "p99", sketch.quantile(0.99), n));
+		summary.emplace_back(new QuantileMetric(name, "max", max[i], n));
+
+		sketch.clear();
+		min[i] = INF;
+		max[i] = -INF;
+		sum[i] = 0;
+		sumsq[i] = 0;
+
+		if (kept != i) {
+			series[kept] = std::move(series[i]);
+			index[series[kept].name] = kept;
+		}
+		moved[i] = kept++;
+	}
+
+	// the statistics were just reset, so the columns only need to be shortened
+	series.erase(series.begin() + kept, series.end());
+	column.resize(kept);
+	min.resize(kept);
+	max.resize(kept);
+	sum.resize(kept);
+	sumsq.resize(kept);
+
+	for (auto& position : positions) {
+		position = position == SIZE_MAX ? SIZE_MAX : moved[position];
+	}
+
+	window_start = now;
+	return summary;
+}
@@ -0,0 +1,142 @@
+#include "alerts.hpp"
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+
+AlertRule AlertRule::parse(const json& alert) {
+
+	if (!alert.is_object() || !alert.contains("name") || !alert["name"].is_string()) {
+		throw std::runtime_error("Each alert must have a 'name' as a string");
+	}
+
+	AlertRule rule;
+	rule.name = alert["name"].get<std::string>();
+
+	auto error = [&](const std::string& what) {
+		return std::runtime_error("Alert '" + rule.name + "': " + what);
+	};
+
+	if (!alert.contains("series") || !alert["series"].is_string()) {
+		throw error("'series' must be a string, e.g. \"cpu.0\"");
+	}
+	rule.series = alert["series"].get<std::string>();
+
+	if (alert.contains("kind")) {
+
+		if (alert["kind"] == "threshold") {
+			rule.kind = Kind::threshold;
+		}
+		else if (alert["kind"] == "rate") {
+			rule.kind = Kind::rate;
+		}
+		else {
+			throw error("'kind' must be \"threshold\" or \"rate\"");
+		}
+	}
+
+	if (alert.contains("above") == alert.contains("below")) {
+		throw error("exactly one of 'above' and 'below' is required");
+	}
+	rule.above = alert.contains("above");
+	const auto& threshold = alert[rule.above ? "above" : "below"];
+	if (!threshold.is_number()) {
+		throw error("the threshold must be a number");
+	}
+	rule.threshold = threshold.get<double>();
+
+	rule.clear = rule.threshold;
+	if (alert.contains("clear")) {
+
+		if (!alert["clear"].is_number()) {
+			throw error("'clear' must be a number");
+		}
+		rule.clear = alert["clear"].get<double>();
+		if (rule.above ? rule.clear > rule.threshold : rule.clear < rule.threshold) {
+			throw error(std::string("'clear' must not be ") + (rule.above ? "above" : "below") + " the threshold");
+		}
+	}
+
+	if (alert.contains("for")) {
+
+		if (!alert["for"].is_number() || alert["for"].get<double>() < 0) {
+			throw error("'for' must be a non-negative number of seconds");
+		}
+		rule.duration = std::chrono::milliseconds(static_cast<std::int64_t>(std::llround(alert["for"].get<double>() * 1000)));
+	}
+
+	return rule;
+}
+
+
+Alerts::Alerts(std::vector<AlertRule> configured)
+	: slots("Alerts")
+{
+	rules.reserve(configured.size());
+	for (auto& config : configured) {
+
+		auto slot = slots.add(config.series);
+		rules.push_back({ std::move(config), slot });
+	}
+}
+
+
+double Alerts::observe(Rule& rule, double value, std::chrono::steady_clock::time_point now) {
+
+	if (rule.config.kind == AlertRule::Kind::threshold || std::isnan(value)) {
+		return value;
+	}
+
+	double seconds = std::chrono::duration<double>(now - rule.last_time).count();
+	double rate = rule.has_last && seconds > 0 ? (value - rule.last) / seconds : std::numeric_limits<double>::quiet_NaN();
+
+	rule.last = value;
+	rule.last_time = now;
+	rule.has_last = true;
+	return rate;
+}
+
+
+std::vector<std::unique_ptr<Metric>> Alerts::evaluate(const std::vector<std::unique_ptr<Metric>>& metrics, std::chrono::steady_clock::time_point now) {
+
+	slots.read(metrics);
+
+	std::vector<std::unique_ptr<Metric>> events;
+	for (auto& rule : rules) {
+
+		double value = observe(rule, slots[rule.slot], now);
+		if (std::isnan(value)) continue; // the series isn't collected this tick, the rule keeps its state
+
+		const auto& config = rule.config;
+		bool breached = config.above ? value > config.threshold : value < config.threshold;
+		bool cleared = config.above ? value <= config.clear : value >= config.clear;
+
+		switch (rule.state) {
+
+			case State::inactive:
+				if (!breached) break;
+				rule.state = State::pending;
+				rule.since = now;
+				[[fallthrough]];
+
+			case State::pending:
+				if (!breached) {
+					rule.state = State::inactive;
+				}
+				else if (now - rule.since >= config.duration) {
+					rule.state = State::firing;
+					events.emplace_back(new AlertEvent(config.name, config.series, true, value, config.threshold));
+				}
+				break;
+
+			case State::firing:
+				if (cleared) {
+					rule.state = State::inactive;
+					events.emplace_back(new AlertEvent(config.name, config.series, false, value, config.clear));
+				}
+				break;
+		}
+	}
+
+	return events;
+}
@@ -0,0 +1,163 @@
+#include "anomaly_detector.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fnmatch.h>
+#include <limits>
+
+
+namespace {
+
+	constexpr double NO_SAMPLE = std::numeric_limits<double>::quiet_NaN();
+
+}
+
+
+AnomalyDetector::AnomalyDetector(const AnomalyOptions& options)
+	: patterns(options.series)
+	, params{ options.alpha, options.season ? options.beta : 0, options.season ? options.gamma : 0
+		, options.k * options.k, options.min_sigma * options.min_sigma, options.warmup }
+	, phases(options.season ? options.season : 1)
+	, period(options.period)
+	, horizon(std::max<std::chrono::steady_clock::duration>(FORGET_AFTER, options.period * phases))
+	, season(phases)
+{}
+
+
+std::size_t AnomalyDetector::find_series(const std::string& name) {
+
+	auto it = index.find(name);
+	if (it != index.end()) {
+		return it->second;
+	}
+
+	bool watched = std::any_of(patterns.begin(), patterns.end(), [&](const std::string& pattern) {
+		return fnmatch(pattern.c_str(), name.c_str(), 0) == 0;
+	});
+
+	std::size_t slot = IGNORED;
+	if (watched) {
+
+		slot = names.size();
+		names.push_back(name);
+		column.push_back(NO_SAMPLE);
+		level.push_back(0);
+		trend.push_back(0);
+		for (auto& phase : season) {
+			phase.push_back(0);
+		}
+		var.push_back(0);
+		seen.push_back(0);
+		forecast.push_back(0);
+		score.push_back(0);
+	}
+
+	known.push_back(name);
+	known_slots.push_back(slot);
+	seen_at.emplace_back();
+	index.emplace(name, known.size() - 1);
+	return known.size() - 1;
+}
+
+
+void AnomalyDetector::forget(std::chrono::steady_clock::time_point time) {
+
+	std::vector<std::size_t> moved_to(known.size(), SIZE_MAX);
+	std::size_t kept = 0;
+	std::size_t kept_slots = 0;
+
+	for (std::size_t i = 0; i != known.size(); ++i) {
+
+		if (seen_at[i] < time) {
+			index.erase(known[i]);
+			continue;
+		}
+
+		// the slots were given out in the order of `known`, so a kept slot only moves down
+		auto slot = known_slots[i];
+		if (slot != IGNORED && kept_slots != slot) {
+
+			names[kept_slots] = std::move(names[slot]);
+			for (auto* values : { &level, &trend, &var, &seen, &forecast, &score }) {
+				(*values)[kept_slots] = (*values)[slot];
+			}
+			for (auto& phase : season) {
+				phase[kept_slots] = phase[slot];
+			}
+		}
+		if (slot != IGNORED) {
+			slot = kept_slots++;
+		}
+
+		if (kept != i) {
+			known[kept] = std::move(known[i]);
+			seen_at[kept] = seen_at[i];
+			index[known[kept]] = kept;
+		}
+		known_slots[kept] = slot;
+		moved_to[i] = kept++;
+	}
+
+	known.resize(kept);
+	known_slots.resize(kept);
+	seen_at.resize(kept);
+
+	names.resize(kept_slots);
+	column.resize(kept_slots);
+	for (auto* values : { &level, &trend, &var, &seen, &forecast, &score }) {
+		values->resize(kept_slots);
+	}
+	for (auto& phase : season) {
+		phase.resize(kept_slots);
+	}
+
+	for (auto& position : positions) {
+		position = position == SIZE_MAX ? SIZE_MAX : moved_to[position];
+	}
+}
+
+
+std::vector<std::unique_ptr<Metric>> AnomalyDetector::evaluate(const std::vector<std::unique_ptr<Metric>>& metrics, std::chrono::steady_clock::time_point now) {
+
+	if (!start) {
+		start = now;
+		next_sweep = now + horizon;
+	}
+	else if (now >= next_sweep) {
+		forget(now - horizon);
+		next_sweep = now + horizon;
+	}
+
+	positions.resize(metrics.size(), SIZE_MAX);
+
+	for (std::size_t i = 0; i != metrics.size(); ++i) {
+
+		// the same position cache as the Aggregator: the name is checked against the last tick's position and
+		// looked up only if it differs, the batch layout rarely changes between ticks
+		auto name = metrics[i]->series();
+		if (positions[i] == SIZE_MAX || known[positions[i]] != name) {
+			positions[i] = find_series(name);
+		}
+
+		seen_at[positions[i]] = now;
+		auto slot = known_slots[positions[i]];
+		if (slot != IGNORED) {
+			column[slot] = metrics[i]->get_value();
+		}
+	}
+
+	auto phase = static_cast<std::size_t>((now - *start) / period) % phases;
+
+	window_kernels::BaselineColumns columns{ level.data(), trend.data(), season[phase].data(), var.data(), seen.data()
+		, forecast.data(), score.data() };
+	window_kernels::update(column.data(), column.size(), params, columns);
+
+	std::vector<std::unique_ptr<Metric>> events;
+	for (std::size_t slot = 0; slot != score.size(); ++slot) {
+		if (score[slot] != 0) {
+			events.emplace_back(new AnomalyEvent(names[slot], column[slot], forecast[slot], score[slot]));
+		}
+	}
+
+	std::fill(column.begin(), column.end(), NO_SAMPLE);
+	return events;
+}
@@ -0,0 +1,267 @@
+#include "batch_reader.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <linux/io_uring.h>
+#include <mutex>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+
+namespace {
+
+	constexpr unsigned MAX_RING_ENTRIES = 4096;
+	constexpr std::size_t BUFFER_ALIGNMENT = 64; // every file gets its own cache line(s)
+
+	// the same message for every reader, once per process
+	void report_fallback(int error) {
+
+		static std::once_flag once;
+		std::call_once(once, [error] {
+			std::cerr << "io_uring is unavailable (" << std::strerror(error) << "), falling back to pread" << std::endl;
+		});
+	}
+
+	void* map_ring(int fd, std::size_t size, off_t offset) {
+
+		void* ring = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+		return ring == MAP_FAILED ? nullptr : ring;
+	}
+
+	template<typename T>
+	T* at(void* base, std::uint32_t offset) {
+		return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+	}
+
+}
+
+
+BatchReader::BatchReader(bool use_uring)
+	: use_uring(use_uring)
+{}
+
+
+BatchReader::~BatchReader() {
+	close_ring();
+}
+
+
+std::size_t BatchReader::add(const ProcFile& file, std::size_t capacity) {
+
+	if (!file.is_open()) {
+		throw std::runtime_error("Attempt to register a closed file");
+	}
+
+	std::size_t offset = arena.size();
+	arena.resize(offset + (capacity + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT);
+
+	entries.push_back({file.get_fd(), file.get_path(), offset, capacity, 0});
+	dirty = true;
+	return entries.size() - 1;
+}
+
+
+void BatchReader::clear() {
+
+	entries.clear();
+	arena.clear();
+	dirty = true;
+}
+
+
+void BatchReader::read_all() {
+
+	if (dirty) {
+		setup_ring();
+	}
+
+	if (ring_fd >= 0) {
+		read_with_uring();
+	}
+	else {
+		read_with_pread();
+	}
+}
+
+
+void BatchReader::setup_ring() {
+
+	close_ring();
+	dirty = false;
+
+	if (!use_uring || entries.empty()) {
+		return;
+	}
+
+	io_uring_params params{};
+	unsigned depth = static_cast<unsigned>(std::min<std::size_t>(entries.size(), MAX_RING_ENTRIES));
+
+	ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+	if (ring_fd < 0) {
+		report_fallback(errno);
+		use_uring = false;
+		return;
+	}
+
+	sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+	if (single_mmap) {
+		sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+	}
+	sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+	sq_ring = map_ring(ring_fd, sq_ring_size, IORING_OFF_SQ_RING);
+	cq_ring = single_mmap ? sq_ring : map_ring(ring_fd, cq_ring_size, IORING_OFF_CQ_RING);
+	sqes = map_ring(ring_fd, sqes_size, IORING_OFF_SQES);
+
+	if (!sq_ring || !cq_ring || !sqes) {
+		int error = errno;
+		close_ring();
+		report_fallback(error);
+		use_uring = false;
+		return;
+	}
+
+	sq_entries = params.sq_entries;
+	sq_tail = at<unsigned>(sq_ring, params.sq_off.tail);
+	sq_mask = at<unsigned>(sq_ring, params.sq_off.ring_mask);
+	sq_array = at<unsigned>(sq_ring, params.sq_off.array);
+	cq_head = at<unsigned>(cq_ring, params.cq_off.head);
+	cq_tail = at<unsigned>(cq_ring, params.cq_off.tail);
+	cq_mask = at<unsigned>(cq_ring, params.cq_off.ring_mask);
+	cqes = at<io_uring_cqe>(cq_ring, params.cq_off.cqes);
+
+	// both registrations are optimizations: the kernel then doesn't pin the pages and look up the fds on every
+	// read, so if one is refused (e.g. RLIMIT_MEMLOCK on older kernels) the plain IORING_OP_READ is used
+	iovec buffer{ arena.data(), arena.size() };
+	fixed_buffer = syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS, &buffer, 1) == 0;
+
+	std::vector<int> fds;
+	fds.reserve(entries.size());
+	for (const auto& entry : entries) {
+		fds.push_back(entry.fd);
+	}
+	fixed_files = syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_FILES, fds.data(), static_cast<unsigned>(fds.size())) == 0;
+}
+
+
+void BatchReader::close_ring() {
+
+	if (sqes) munmap(sqes, sqes_size);
+	if (cq_ring && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+	if (sq_ring) munmap(sq_ring, sq_ring_size);
+	sqes = cq_ring = sq_ring = nullptr;
+
+	if (ring_fd >= 0) {
+		::close(ring_fd); // drops the registered buffer and files as well
+		ring_fd = -1;
+	}
+	fixed_buffer = fixed_files = false;
+}
+
+
+void BatchReader::read_with_pread() {
+
+	for (auto& entry : entries) {
+
+		ssize_t n;
+		do {
+			n = ::pread(entry.fd, arena.data() + entry.offset, entry.capacity, 0);
+			++syscall_count;
+		} while (n < 0 && errno == EINTR);
+
+		if (n < 0) {
+			fail(entry, errno);
+		}
+		entry.size = static_cast<std::size_t>(n);
+	}
+}
+
+
+void BatchReader::read_with_uring() {
+
+	auto* sq = static_cast<io_uring_sqe*>(sqes);
+	auto* cq = static_cast<io_uring_cqe*>(cqes);
+
+	const std::size_t count = entries.size();
+	int error = 0;
+	std::size_t failed = 0;
+
+	for (std::size_t begin = 0; begin != count; ) {
+
+		const unsigned chunk = static_cast<unsigned>(std::min<std::size_t>(count - begin, sq_entries));
+
+		// we are the only producer, so the tail can be read without synchronization
+		unsigned tail = *sq_tail;
+		for (unsigned i = 0; i != chunk; ++i, ++tail) {
+
+			const std::size_t index = begin + i;
+			const auto& entry = entries[index];
+
+			unsigned slot = tail & *sq_mask;
+			io_uring_sqe& sqe = sq[slot];
+			std::memset(&sqe, 0, sizeof(sqe));
+
+			sqe.opcode = fixed_buffer ? IORING_OP_READ_FIXED : IORING_OP_READ;
+			sqe.fd = fixed_files ? static_cast<int>(index) : entry.fd;
+			sqe.flags = fixed_files ? IOSQE_FIXED_FILE : 0;
+			sqe.addr = reinterpret_cast<std::uint64_t>(arena.data() + entry.offset);
+			sqe.len = static_cast<std::uint32_t>(entry.capacity);
+			sqe.off = 0;
+			sqe.buf_index = 0;
+			sqe.user_data = index;
+
+			sq_array[slot] = slot;
+		}
+		__atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+		// one syscall submits the whole chunk and waits for it; the loop only repeats after a signal
+		unsigned to_submit = chunk;
+		unsigned reaped = 0;
+		while (reaped != chunk) {
+
+			int submitted = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, chunk - reaped, IORING_ENTER_GETEVENTS, nullptr, 0));
+			++syscall_count;
+			if (submitted < 0) {
+				if (errno == EINTR) continue;
+				throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+			}
+			to_submit -= std::min(static_cast<unsigned>(submitted), to_submit);
+
+			unsigned head = *cq_head;
+			unsigned ready = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+			for (; head != ready; ++head, ++reaped) {
+
+				const io_uring_cqe& cqe = cq[head & *cq_mask];
+				auto& entry = entries[cqe.user_data];
+				if (cqe.res < 0) {
+					if (!error) {
+						error = -cqe.res;
+						failed = cqe.user_data;
+					}
+					entry.size = 0;
+				}
+				else {
+					entry.size = static_cast<std::size_t>(cqe.res);
+				}
+			}
+			__atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+		}
+
+		begin += chunk;
+	}
+
+	if (error) {
+		fail(entries[failed], error);
+	}
+}
+
+
+void BatchReader::fail(const Entry& entry, int error) const {
+	throw std::runtime_error("Failed to read " + entry.path + ": " + std::strerror(error));
+}
@@ -0,0 +1,438 @@
+#include "burst_capture.hpp"
+#include "collector.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <fnmatch.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+namespace {
+
+	volatile std::sig_atomic_t signalled = 0;
+
+	void on_signal(int) {
+		signalled = 1;
+	}
+
+	std::chrono::milliseconds seconds_field(const json& burst, const char* field, std::chrono::milliseconds value) {
+
+		if (!burst.contains(field)) {
+			return value;
+		}
+		if (!burst[field].is_number() || burst[field].get<double>() <= 0) {
+			throw std::runtime_error("Burst '" + std::string(field) + "' must be a positive number of seconds");
+		}
+		return std::chrono::milliseconds(std::max<std::int64_t>(1, std::llround(burst[field].get<double>() * 1000)));
+	}
+
+	std::int64_t now_ns() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	// "2026-10-18 23:01:16.250", the log's timestamps with milliseconds
+	std::string timestamp(std::int64_t ns, const char* format = "%Y-%m-%d %H:%M:%S") {
+
+		std::time_t seconds = ns / 1000000000;
+		std::tm tm{};
+		localtime_r(&seconds, &tm);
+
+		char buffer[64];
+		auto length = std::strftime(buffer, sizeof(buffer), format, &tm);
+		std::snprintf(buffer + length, sizeof(buffer) - length, ".%03d", static_cast<int>(ns / 1000000 % 1000));
+		return buffer;
+	}
+
+	std::uint64_t bits(double value) {
+
+		std::uint64_t word;
+		std::memcpy(&word, &value, sizeof(word));
+		return word;
+	}
+
+	double from_bits(std::uint64_t word) {
+
+		double value;
+		std::memcpy(&value, &word, sizeof(value));
+		return value;
+	}
+
+}
+
+
+BurstOptions BurstOptions::parse(const json& burst) {
+
+	if (!burst.is_object() || !burst.contains("path") || !burst["path"].is_string()) {
+		throw std::runtime_error("'settings.burst' must be an object with a 'path' prefix for the burst files");
+	}
+
+	BurstOptions options;
+	options.path = burst["path"].get<std::string>();
+	options.rate = seconds_field(burst, "rate", options.rate);
+	options.before = seconds_field(burst, "before", options.before);
+	options.after = seconds_field(burst, "after", options.after);
+
+	if (burst.contains("memory")) {
+
+		if (!burst["memory"].is_number() || burst["memory"].get<double>() <= 0) {
+			throw std::runtime_error("Burst 'memory' must be a positive number of megabytes");
+		}
+		options.memory = static_cast<std::size_t>(burst["memory"].get<double>() * (1 << 20));
+	}
+
+	options.alerts = collector_config::strings(burst, "alerts", "Burst 'alerts' must be an array of alert names or glob patterns", { "*" });
+
+	if (burst.contains("socket")) {
+
+		if (!burst["socket"].is_string() || burst["socket"].get<std::string>().size() >= sizeof(sockaddr_un::sun_path)) {
+			throw std::runtime_error("Burst 'socket' must be a path shorter than " + std::to_string(sizeof(sockaddr_un::sun_path)) + " characters");
+		}
+		options.socket = burst["socket"].get<std::string>();
+	}
+
+	return options;
+}
+
+
+BurstCapture::BurstCapture(const BurstOptions& options)
+	: options(options)
+	, ring(std::max<std::size_t>(options.memory / sizeof(std::uint64_t), 2))
+{
+	struct sigaction action{};
+	action.sa_handler = on_signal;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	sigaction(SIGUSR1, &action, nullptr);
+
+	if (!options.socket.empty()) {
+
+		socket_fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (socket_fd < 0) {
+			throw std::runtime_error(std::string("Failed to open the control socket: ") + std::strerror(errno));
+		}
+
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		std::strncpy(address.sun_path, options.socket.c_str(), sizeof(address.sun_path) - 1);
+		::unlink(options.socket.c_str()); // left over by a previous run
+		if (::bind(socket_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+			int err = errno;
+			::close(socket_fd);
+			throw std::runtime_error("Failed to bind the control socket " + options.socket + ": " + std::strerror(err));
+		}
+
+		struct stat status{};
+		if (::stat(options.socket.c_str(), &status) == 0) {
+			socket_inode = status.st_ino;
+		}
+	}
+}
+
+
+BurstCapture::~BurstCapture() {
+
+	// the SIGUSR1 handler stays: a signal after the capture is gone only sets a flag nobody reads
+	if (socket_fd >= 0) {
+
+		::close(socket_fd);
+
+		// a reload may have bound a new capture to the same path already, its socket stays
+		struct stat status{};
+		if (::stat(options.socket.c_str(), &status) == 0 && status.st_ino == socket_inode) {
+			::unlink(options.socket.c_str());
+		}
+	}
+}
+
+
+bool BurstCapture::same_layout(const Layout& layout, const std::vector<std::unique_ptr<Metric>>& metrics) const {
+
+	if (layout.names.size() != metrics.size()) {
+		return false;
+	}
+	for (std::size_t i = 0; i != metrics.size(); ++i) {
+		if (layout.names[i] != metrics[i]->series()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+std::size_t BurstCapture::find_layout(const std::vector<std::unique_ptr<Metric>>& metrics) {
+
+	if (current != SIZE_MAX && same_layout(layouts[current], metrics)) {
+		return current;
+	}
+	for (std::size_t i = 0; i != layouts.size(); ++i) {
+		if (same_layout(layouts[i], metrics)) {
+			return i;
+		}
+	}
+
+	auto free = [&]() {
+		return std::find_if(layouts.begin(), layouts.end(), [](const Layout& layout) { return layout.records == 0; });
+	};
+
+	std::size_t slot = layouts.size();
+	if (layouts.size() == MAX_LAYOUTS) {
+
+		// the oldest records go first, until one of the layouts isn't used any more
+		while (free() == layouts.end()) {
+			drop_oldest();
+		}
+		slot = free() - layouts.begin();
+		if (written_layout == slot) {
+			written_layout = SIZE_MAX;
+		}
+		if (summed_layout == slot) {
+			summed_layout = SIZE_MAX;
+		}
+	}
+	else {
+		layouts.emplace_back();
+	}
+
+	layouts[slot].names.clear();
+	for (const auto& metric : metrics) {
+		layouts[slot].names.push_back(metric->series());
+	}
+	return slot;
+}
+
+
+void BurstCapture::drop_oldest() {
+
+	auto header = word(1);
+	auto count = header & 0xffffffff;
+	--layouts[header >> 32].records;
+
+	head = (head + 2 + count) % ring.size();
+	used -= 2 + count;
+	--records;
+}
+
+
+void BurstCapture::record(const std::vector<std::unique_ptr<Metric>>& metrics) {
+
+	auto time = now_ns();
+
+	values.resize(metrics.size());
+	for (std::size_t i = 0; i != metrics.size(); ++i) {
+		values[i] = metrics[i]->get_value();
+	}
+
+	std::size_t size = 2 + values.size();
+	std::size_t layout = current;
+	if (size > ring.size()) {
+
+		if (!too_large_warned) {
+			std::cerr << "Burst capture: a batch of " << values.size() << " samples doesn't fit in 'memory', it isn't kept"
+				<< " nor written to the burst files (the stages still get the period means)" << std::endl;
+			too_large_warned = true;
+		}
+
+		// not a ring layout, but the means need to know whether the batch still has the same series
+		if (!same_layout(oversized, metrics)) {
+
+			oversized.names.clear();
+			for (const auto& metric : metrics) {
+				oversized.names.push_back(metric->series());
+			}
+			summed_layout = SIZE_MAX;
+		}
+		layout = OVERSIZED;
+	}
+	else {
+
+		current = find_layout(metrics);
+		while (ring.size() - used < size) {
+			drop_oldest();
+		}
+
+		std::size_t tail = (head + used) % ring.size();
+		auto put = [&](std::uint64_t value) {
+			ring[tail] = value;
+			tail = tail + 1 == ring.size() ? 0 : tail + 1;
+		};
+
+		put(static_cast<std::uint64_t>(time));
+		put(static_cast<std::uint64_t>(current) << 32 | values.size());
+		for (double value : values) {
+			put(bits(value));
+		}
+		used += size;
+		++records;
+		++layouts[current].records;
+		layout = current;
+	}
+
+	// the sums start over when the layout changes, the samples of another layout can't be matched up
+	if (layout != summed_layout) {
+
+		sums.assign(values.size(), 0);
+		counts.assign(values.size(), 0);
+		summed_layout = layout;
+	}
+	for (std::size_t i = 0; i != values.size(); ++i) {
+		if (!std::isnan(values[i])) {
+			sums[i] += values[i];
+			++counts[i];
+		}
+	}
+
+	if (file.is_open()) {
+
+		if (current != SIZE_MAX && size <= ring.size()) {
+			write(time, current, values);
+		}
+		if (time >= until) {
+			std::cout << "Burst capture finished" << std::endl;
+			file.close();
+		}
+	}
+
+	poll_triggers();
+}
+
+
+void BurstCapture::take_means(std::vector<std::unique_ptr<Metric>>& metrics) {
+
+	for (std::size_t i = 0; i != metrics.size() && i != sums.size(); ++i) {
+		if (counts[i] != 0) {
+			metrics[i]->set_value(sums[i] / counts[i]);
+		}
+	}
+	std::fill(sums.begin(), sums.end(), 0);
+	std::fill(counts.begin(), counts.end(), 0);
+}
+
+
+void BurstCapture::check_events(const std::vector<std::unique_ptr<Metric>>& events) {
+
+	for (const auto& event : events) {
+
+		auto alert = dynamic_cast<const AlertEvent*>(event.get());
+		if (!alert || !alert->firing) continue;
+
+		bool matches = std::any_of(options.alerts.begin(), options.alerts.end(), [&](const std::string& pattern) {
+			return fnmatch(pattern.c_str(), alert->name.c_str(), 0) == 0;
+		});
+		if (matches) {
+			trigger("alert " + alert->name);
+		}
+	}
+}
+
+
+void BurstCapture::poll_triggers() {
+
+	if (signalled) {
+		signalled = 0;
+		trigger("SIGUSR1");
+	}
+
+	if (socket_fd < 0) {
+		return;
+	}
+
+	char buffer[256];
+	while (true) {
+
+		auto length = ::recv(socket_fd, buffer, sizeof(buffer) - 1, 0);
+		if (length < 0) {
+			break; // EAGAIN: nothing more this tick
+		}
+
+		std::string command(buffer, length);
+		while (!command.empty() && (command.back() == '\n' || command.back() == '\r')) {
+			command.pop_back();
+		}
+
+		if (command == "burst" || command.rfind("burst ", 0) == 0) {
+			trigger(command.size() > 6 ? "socket: " + command.substr(6) : "socket");
+		}
+		else {
+			std::cerr << "Control socket: unknown command '" << command << "', expected \"burst [reason]\"" << std::endl;
+		}
+	}
+}
+
+
+void BurstCapture::trigger(const std::string& reason) {
+
+	auto time = now_ns();
+	auto after = std::chrono::duration_cast<std::chrono::nanoseconds>(options.after).count();
+
+	if (file.is_open()) {
+
+		// a trigger during a capture extends it rather than starting another file
+		until = std::max(until, time + after);
+		file << json{ { "trigger", reason }, { "time", timestamp(time) } }.dump() << "\n";
+		return;
+	}
+
+	auto path = options.path + "-" + timestamp(time, "%Y%m%d-%H%M%S") + ".jsonl";
+	file.open(path);
+	if (!file) {
+		std::cerr << "Burst capture: cannot open " << path << ", the trigger (" << reason << ") is ignored" << std::endl;
+		return;
+	}
+	std::cout << "Burst capture (" << reason << ") to " << path << std::endl;
+
+	until = time + after;
+	written_layout = SIZE_MAX;
+	file << json{ { "trigger", reason }, { "time", timestamp(time) } }.dump() << "\n";
+
+	// the ring, from the first record that is recent enough
+	auto since = time - std::chrono::duration_cast<std::chrono::nanoseconds>(options.before).count();
+	std::size_t offset = 0;
+	for (std::size_t k = 0; k != records; ++k) {
+
+		auto record_time = static_cast<std::int64_t>(word(offset));
+		auto header = word(offset + 1);
+		auto count = header & 0xffffffff;
+
+		if (record_time >= since) {
+
+			values.resize(count);
+			for (std::size_t i = 0; i != count; ++i) {
+				values[i] = from_bits(word(offset + 2 + i));
+			}
+			write(record_time, header >> 32, values);
+		}
+		offset += 2 + count;
+	}
+	file.flush();
+}
+
+
+void BurstCapture::write(std::int64_t time, std::size_t layout, const std::vector<double>& values) {
+
+	if (layout != written_layout) {
+		file << json{ { "series", layouts[layout].names } }.dump() << "\n";
+		written_layout = layout;
+	}
+
+	file << "{\"time\":\"" << timestamp(time) << "\",\"values\":[";
+	char number[32];
+	for (std::size_t i = 0; i != values.size(); ++i) {
+
+		if (std::isfinite(values[i])) {
+			std::snprintf(number, sizeof(number), "%.10g", values[i]);
+			file << (i ? "," : "") << number;
+		}
+		else {
+			file << (i ? "," : "") << "null";
+		}
+	}
+	file << "]}\n";
+}
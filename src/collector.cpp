@@ -0,0 +1,75 @@
+#include "collector.hpp"
+#include <stdexcept>
+
+
+std::map<std::string, CollectorRegistry::Factory>& CollectorRegistry::factories() {
+
+	// a function-local static, so the registrars of other translation units never see it uninitialized
+	static std::map<std::string, Factory> registry;
+	return registry;
+}
+
+
+void CollectorRegistry::add(const std::string& type, Factory factory) {
+
+	if (!factories().emplace(type, std::move(factory)).second) {
+		throw std::logic_error("Collector '" + type + "' is registered twice");
+	}
+}
+
+
+std::unique_ptr<Collector> CollectorRegistry::create(const std::string& type) {
+
+	auto it = factories().find(type);
+	if (it == factories().end()) {
+		throw std::runtime_error("Unknown metric type: " + type);
+	}
+	auto collector = it->second();
+	collector->type = type;
+	return collector;
+}
+
+
+namespace collector_config {
+
+	void validate_string_array(const json& metric, const char* field, const std::string& error) {
+
+		if (!metric.contains(field) || !metric[field].is_array()) {
+			throw std::runtime_error(error);
+		}
+
+		for (const auto& item : metric[field]) {
+			if (!item.is_string()) {
+				throw std::runtime_error(error);
+			}
+		}
+	}
+
+	std::vector<std::string> strings(const json& metric, const char* field, const std::string& error, std::vector<std::string> fallback) {
+
+		if (!metric.contains(field)) {
+			return fallback;
+		}
+		validate_string_array(metric, field, error);
+		return metric[field].get<std::vector<std::string>>();
+	}
+
+	std::vector<int> ints(const json& metric, const char* field, const std::string& error) {
+
+		if (!metric.contains(field)) {
+			return {};
+		}
+
+		if (!metric[field].is_array()) {
+			throw std::runtime_error(error);
+		}
+
+		for (const auto& item : metric[field]) {
+			if (!item.is_number_integer()) {
+				throw std::runtime_error(error);
+			}
+		}
+		return metric[field].get<std::vector<int>>();
+	}
+
+}
@@ -0,0 +1,172 @@
+#include "collector.hpp"
+#include "numa_stats.hpp"
+#include <stdexcept>
+
+
+namespace {
+
+	// "node<N>" or "socket<N>"
+	bool is_cpu_group(const json& id) {
+
+		if (!id.is_string()) {
+			return false;
+		}
+
+		const auto& name = id.get_ref<const std::string&>();
+		for (std::string prefix : { "node", "socket" }) {
+
+			if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0 &&
+				std::all_of(name.begin() + prefix.size(), name.end(), [](char c) { return c >= '0' && c <= '9'; }))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+}
+
+
+// the load of single cpus and of NUMA nodes or sockets, from /proc/stat. A cpu that goes offline has no sample
+// until it is back online for two ticks, and doesn't count in its group meanwhile
+struct CpuCollector : Collector {
+
+	void configure(const json& metric) override {
+
+		if (!metric.contains("ids") || !metric["ids"].is_array()) {
+			throw std::runtime_error("CPU metric must have an 'ids' array");
+		}
+
+		for (const auto& id : metric["ids"]) {
+
+			if (id.is_number_integer()) {
+				ids.push_back({id.get<int>(), {}, nullptr, nullptr});
+			}
+			else if (is_cpu_group(id)) {
+				ids.push_back({-1, id.get<std::string>(), nullptr, nullptr});
+			}
+			else {
+				throw std::runtime_error("CPU metric 'ids' must contain cpu numbers or \"node<N>\"/\"socket<N>\" groups");
+			}
+		}
+	}
+
+	void prepare(CollectorContext& context) override {
+
+		snapshot = &context.snapshot;
+		prev_times = snapshot->cpu_times();
+
+		bool has_groups = std::any_of(ids.begin(), ids.end(), [](const Id& id) { return id.cpu < 0; });
+		if (has_groups) {
+			topology = CpuTopology::read();
+		}
+
+		for (auto& id : ids) {
+
+			if (id.cpu < 0) {
+				id.group = topology.find(id.group_name, &id.grouping);
+				if (!id.group) {
+					throw std::invalid_argument("cpu-id '" + id.group_name + "' in configuration file is invalid");
+				}
+			}
+			else if (!online(prev_times, id.cpu)) {
+				throw std::invalid_argument("cpu-id '" + std::to_string(id.cpu) + "' in configuration file is invalid or the cpu is offline");
+			}
+		}
+	}
+
+	void collect(SampleBatch& batch) override {
+
+		// shared with the other cpu entries of the tick, the deltas are against this instance's own prev_times
+		const auto& curr_times = snapshot->cpu_times();
+
+		// the per-cpu stats of a grouping, gathered so that every node (socket) is one contiguous range
+		const CpuGrouping* gathered = nullptr;
+		reported.clear();
+
+		for (std::size_t index = 0; index != ids.size(); ++index) {
+
+			const auto& id = ids[index];
+			if (id.cpu < 0) {
+
+				if (id.grouping != gathered) {
+					gather(*id.grouping, curr_times);
+					gathered = id.grouping;
+				}
+
+				std::uint64_t total_diff = 0, active_diff = 0;
+				bool any = false;
+				for (std::size_t i = id.group->begin; i != id.group->end; ++i) {
+
+					if (!grouped_curr[i].present) continue;
+					total_diff += grouped_curr[i].total() - grouped_prev[i].total();
+					active_diff += grouped_curr[i].active() - grouped_prev[i].active();
+					any = true;
+				}
+
+				if (any) {
+					batch.add<CpuGroupLoad>(id.group->name, load(total_diff, active_diff));
+					reported.push_back(index);
+				}
+			}
+			else if (online(curr_times, id.cpu) && online(prev_times, id.cpu)) {
+
+				auto total_diff = curr_times[id.cpu].total() - prev_times[id.cpu].total();
+				auto active_diff = curr_times[id.cpu].active() - prev_times[id.cpu].active();
+
+				batch.add<CpuLoad>(id.cpu, load(total_diff, active_diff));
+				reported.push_back(index);
+			}
+		}
+		batch.layout_changed = reported_keys.changed(reported, [](std::size_t index) { return index; });
+
+		prev_times = curr_times; // only allocates when a cpu with a higher id has come online
+	}
+
+private:
+
+	struct Id {
+		int cpu; // -1 for a group
+		std::string group_name;
+		const CpuGrouping* grouping;
+		const CpuGrouping::Group* group;
+	};
+
+	static bool online(const std::vector<CpuStats>& times, int cpu) {
+		return static_cast<std::size_t>(cpu) < times.size() && times[cpu].present;
+	}
+
+	static double load(std::uint64_t total_diff, std::uint64_t active_diff) {
+		return (total_diff > 0) ? (static_cast<double>(active_diff) / total_diff) * 100.0 : 0.0;
+	}
+
+	void gather(const CpuGrouping& grouping, const std::vector<CpuStats>& curr_times) {
+
+		grouped_curr.clear();
+		grouped_prev.clear();
+		for (int cpu : grouping.cpus) {
+
+			// a cpu offline on either tick doesn't count, its entries aren't `present`
+			if (online(curr_times, cpu) && online(prev_times, cpu)) {
+				grouped_curr.push_back(curr_times[cpu]);
+				grouped_prev.push_back(prev_times[cpu]);
+			}
+			else {
+				grouped_curr.push_back(CpuStats{});
+				grouped_prev.push_back(CpuStats{});
+			}
+		}
+	}
+
+private:
+
+	std::vector<Id> ids;
+	CpuTopology topology; // read once, only if there are groups among the ids
+	ProcSnapshot* snapshot = nullptr;
+	std::vector<CpuStats> prev_times;
+	std::vector<CpuStats> grouped_curr, grouped_prev;
+	std::vector<std::size_t> reported; // the ids entries with a sample this tick
+	SeriesKeys<std::size_t> reported_keys;
+};
+
+REGISTER_COLLECTOR("cpu", CpuCollector);
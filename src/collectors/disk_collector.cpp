@@ -0,0 +1,50 @@
+#include "collector.hpp"
+#include "disk_stats.hpp"
+#include <optional>
+
+
+struct DiskCollector : Collector {
+
+	void configure(const json& metric) override {
+
+		collector_config::validate_string_array(metric, "devices", "Disk metric must have a 'devices' array of glob patterns");
+		devices = metric["devices"].get<std::vector<std::string>>();
+
+		static const std::vector<std::pair<std::string, double DiskRates::*>> known = {
+			{ "read_iops", &DiskRates::read_iops },
+			{ "write_iops", &DiskRates::write_iops },
+			{ "read_throughput", &DiskRates::read_throughput },
+			{ "write_throughput", &DiskRates::write_throughput },
+			{ "read_latency", &DiskRates::read_latency },
+			{ "write_latency", &DiskRates::write_latency },
+			{ "util", &DiskRates::util }
+		};
+		specs = collector_config::select_specs(metric, known, "disk", "Disk metric 'spec' must be an array of strings");
+	}
+
+	void prepare(CollectorContext& context) override {
+		reader.emplace(devices, context.snapshot.file("/proc/diskstats"));
+	}
+
+	void collect(SampleBatch& batch) override {
+
+		reader->sample(rates);
+		batch.layout_changed = keys.changed(rates, [](const DiskRates& rate) -> const std::string& { return rate.device; });
+
+		for (const auto& device : rates) {
+			for (const auto& [name, field] : specs) {
+				batch.add<DiskMetric>(device.device, name, device.*field);
+			}
+		}
+	}
+
+private:
+
+	std::vector<std::string> devices;
+	std::vector<std::pair<std::string, double DiskRates::*>> specs;
+	std::optional<DiskStatsReader> reader;
+	std::vector<DiskRates> rates;
+	SeriesKeys<std::string> keys;
+};
+
+REGISTER_COLLECTOR("disk", DiskCollector);
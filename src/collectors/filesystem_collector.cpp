@@ -0,0 +1,82 @@
+#include "collector.hpp"
+#include "fs_stats.hpp"
+#include <optional>
+
+
+struct FilesystemCollector : Collector {
+
+	// statvfs calls that run in parallel; a hung call holds its worker, so the pool gets as many
+	// extra threads and the other collectors never wait for a dead NFS server
+	static constexpr std::size_t LANES = 4;
+
+	void configure(const json& metric) override {
+
+		mounts = collector_config::strings(metric, "mounts", "Filesystem metric 'mounts' must be an array of glob patterns", {"*"});
+
+		// the filesystems that hold data, so the pseudo ones (proc, sysfs, cgroup, ...) aren't reported by default
+		fstypes = collector_config::strings(metric, "fstypes", "Filesystem metric 'fstypes' must be an array of glob patterns", {
+			"ext[234]", "xfs", "btrfs", "zfs", "f2fs", "jfs", "reiserfs", "vfat", "exfat", "ntfs*",
+			"nfs", "nfs4", "cifs", "smb3", "ceph", "glusterfs", "fuse.*", "overlay", "tmpfs"
+		});
+
+		static const std::vector<std::pair<std::string, double FsUsage::*>> known = {
+			{ "size", &FsUsage::size },
+			{ "avail", &FsUsage::avail },
+			{ "used", &FsUsage::used },
+			{ "inodes_avail", &FsUsage::inodes_avail },
+			{ "inodes_used", &FsUsage::inodes_used }
+		};
+		specs = collector_config::select_specs(metric, known, "filesystem", "Filesystem metric 'spec' must be an array of strings");
+
+		if (metric.contains("timeout_ms") && (!metric["timeout_ms"].is_number_integer() || metric["timeout_ms"] <= 0)) {
+			throw std::runtime_error("Filesystem metric 'timeout_ms' must be a positive integer");
+		}
+		timeout = std::chrono::milliseconds(metric.value("timeout_ms", 1000));
+	}
+
+	void prepare(CollectorContext&) override {
+		reader.emplace(mounts, fstypes, timeout, LANES);
+	}
+
+	std::size_t own_workers() const override {
+		return LANES;
+	}
+
+	void start(StaticThreadPool& pool) override {
+		reader->submit(pool);
+	}
+
+	void collect(SampleBatch& batch) override {
+
+		reader->collect(usages);
+
+		// a mount that doesn't respond reports "timeout" instead of its specs
+		batch.layout_changed = mount_keys.changed(usages, [](const FsUsage& usage) -> const std::string& { return usage.mount; })
+			| responding_keys.changed(usages, [](const FsUsage& usage) { return usage.responding; });
+
+		for (const auto& fs : usages) {
+
+			if (!fs.responding) {
+				batch.add<FilesystemMetric>(fs.mount, "timeout", 1.0);
+				continue;
+			}
+
+			for (const auto& [name, field] : specs) {
+				batch.add<FilesystemMetric>(fs.mount, name, fs.*field);
+			}
+		}
+	}
+
+private:
+
+	std::vector<std::string> mounts;
+	std::vector<std::string> fstypes;
+	std::vector<std::pair<std::string, double FsUsage::*>> specs;
+	std::chrono::milliseconds timeout{1000};
+	std::optional<FsStatsReader> reader;
+	std::vector<FsUsage> usages;
+	SeriesKeys<std::string> mount_keys;
+	SeriesKeys<bool> responding_keys;
+};
+
+REGISTER_COLLECTOR("filesystem", FilesystemCollector);
@@ -0,0 +1,88 @@
+#include "collector.hpp"
+#include "irq_stats.hpp"
+#include <optional>
+
+
+// "interrupts" (/proc/interrupts) and "softirqs" (/proc/softirqs) share the reader and the options
+struct IrqCollector : Collector {
+
+	void configure(const json& metric) override {
+
+		type = metric["type"].get<std::string>();
+
+		irqs = collector_config::strings(metric, "irqs", "Interrupts metric 'irqs' must be an array of glob patterns", {"*"});
+
+		if (metric.contains("ids") && !metric["ids"].is_array()) {
+			throw std::runtime_error("Interrupts metric 'ids' must be an array");
+		}
+		ids = collector_config::ints(metric, "ids", "Interrupts metric 'ids' must be an array");
+		has_ids = metric.contains("ids");
+
+		if (metric.contains("per_irq") && !metric["per_irq"].is_boolean()) {
+			throw std::runtime_error("Interrupts metric 'per_irq' must be a boolean");
+		}
+		per_irq = metric.value("per_irq", type == "softirqs"); // there are only ~10 softirqs, but hundreds of irqs
+	}
+
+	void prepare(CollectorContext& context) override {
+		reader.emplace(context.snapshot.file(type == "interrupts" ? "/proc/interrupts" : "/proc/softirqs", 64 * 1024), irqs);
+	}
+
+	void collect(SampleBatch& batch) override {
+
+		const auto& rates = reader->sample();
+		const std::size_t cpus = rates.cpus.size();
+
+		// the matrix only has the online cpus, so the configured ids are mapped onto the columns
+		columns.clear();
+		if (has_ids) {
+
+			for (int id : ids) {
+
+				auto it = std::find(rates.cpus.begin(), rates.cpus.end(), id);
+				if (it == rates.cpus.end()) {
+					throw std::invalid_argument("cpu-id '" + std::to_string(id) + "' in configuration file is invalid");
+				}
+				columns.push_back(static_cast<std::size_t>(it - rates.cpus.begin()));
+			}
+		}
+		else {
+			for (std::size_t column = 0; column != cpus; ++column) {
+				columns.push_back(column);
+			}
+		}
+
+		batch.layout_changed = cpu_keys.changed(columns, [&](std::size_t column) { return rates.cpus[column]; })
+			| (per_irq && irq_keys.changed(rates.irqs, [](const std::string& irq) -> const std::string& { return irq; }));
+
+		for (auto column : columns) {
+			batch.add<IrqMetric>(type, "total", rates.cpus[column], rates.totals[column]);
+		}
+
+		if (per_irq) {
+			for (std::size_t irq = 0; irq != rates.irqs.size(); ++irq) {
+				for (auto column : columns) {
+					batch.add<IrqMetric>(type, rates.irqs[irq], rates.cpus[column], rates.rates[irq * cpus + column]);
+				}
+			}
+		}
+	}
+
+private:
+
+	std::string type;
+	std::vector<std::string> irqs;
+	std::vector<int> ids;
+	bool has_ids = false;
+	bool per_irq = false;
+	std::optional<IrqStatsReader> reader;
+	std::vector<std::size_t> columns;
+	SeriesKeys<int> cpu_keys;
+	SeriesKeys<std::string> irq_keys;
+};
+
+REGISTER_COLLECTOR("interrupts", IrqCollector);
+
+namespace {
+	const CollectorRegistrar<IrqCollector> softirqs_registrar("softirqs");
+}
@@ -0,0 +1,44 @@
+#include "collector.hpp"
+#include <stdexcept>
+
+
+// used and free memory of the host from /proc/meminfo
+struct MemoryCollector : Collector {
+
+	enum class Spec { used, free };
+
+	void configure(const json& metric) override {
+
+		if (!metric.contains("spec") || !metric["spec"].is_array()) {
+			throw std::runtime_error("Memory metric must have a 'spec' array");
+		}
+
+		static const std::vector<std::pair<std::string, Spec>> known = { { "used", Spec::used }, { "free", Spec::free } };
+		specs = collector_config::select_specs(metric, known, "memory", "Memory metric 'spec' must be an array of strings");
+	}
+
+	void prepare(CollectorContext& context) override {
+
+		snapshot = &context.snapshot;
+		snapshot->mem_info(); // opens the file and checks the fields at startup
+	}
+
+	void collect(SampleBatch& batch) override {
+
+		const auto& meminfo = snapshot->mem_info();
+		double mem_total = meminfo.total_kb / (1024.0 * 1024);
+		double mem_free = meminfo.free_kb / (1024.0 * 1024);
+		double mem_available = meminfo.available_kb / (1024.0 * 1024);
+
+		for (const auto& [name, spec] : specs) {
+			batch.add<MemoryMetric>(name, spec == Spec::used ? mem_total - mem_available : mem_free);
+		}
+	}
+
+private:
+
+	std::vector<std::pair<std::string, Spec>> specs;
+	ProcSnapshot* snapshot = nullptr;
+};
+
+REGISTER_COLLECTOR("memory", MemoryCollector);
@@ -0,0 +1,59 @@
+#include "collector.hpp"
+#include "net_stats.hpp"
+#include <optional>
+
+
+struct NetworkCollector : Collector {
+
+	void configure(const json& metric) override {
+
+		collector_config::validate_string_array(metric, "interfaces", "Network metric must have an 'interfaces' array of glob patterns");
+		interfaces = metric["interfaces"].get<std::vector<std::string>>();
+
+		static const std::vector<std::pair<std::string, double NetRates::*>> known = {
+			{ "rx_bytes", &NetRates::rx_bytes },
+			{ "rx_packets", &NetRates::rx_packets },
+			{ "rx_errors", &NetRates::rx_errors },
+			{ "rx_drops", &NetRates::rx_drops },
+			{ "tx_bytes", &NetRates::tx_bytes },
+			{ "tx_packets", &NetRates::tx_packets },
+			{ "tx_errors", &NetRates::tx_errors },
+			{ "tx_drops", &NetRates::tx_drops }
+		};
+		specs = collector_config::select_specs(metric, known, "network", "Network metric 'spec' must be an array of strings");
+
+		if (metric.contains("source") && (!metric["source"].is_string() ||
+			(metric["source"] != "netlink" && metric["source"] != "procfs" && metric["source"] != "sysfs")))
+		{
+			throw std::runtime_error("Network metric 'source' must be one of \"netlink\", \"procfs\" or \"sysfs\"");
+		}
+		source = NetStatsReader::parse_source(metric.value("source", "netlink"));
+	}
+
+	void prepare(CollectorContext& context) override {
+		reader.emplace(interfaces, source, context.snapshot);
+	}
+
+	void collect(SampleBatch& batch) override {
+
+		reader->sample(rates);
+		batch.layout_changed = keys.changed(rates, [](const NetRates& rate) -> const std::string& { return rate.interface; });
+
+		for (const auto& iface : rates) {
+			for (const auto& [name, field] : specs) {
+				batch.add<NetworkMetric>(iface.interface, name, iface.*field);
+			}
+		}
+	}
+
+private:
+
+	std::vector<std::string> interfaces;
+	std::vector<std::pair<std::string, double NetRates::*>> specs;
+	NetSource source = NetSource::netlink;
+	std::optional<NetStatsReader> reader;
+	std::vector<NetRates> rates;
+	SeriesKeys<std::string> keys;
+};
+
+REGISTER_COLLECTOR("network", NetworkCollector);
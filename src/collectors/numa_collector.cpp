@@ -0,0 +1,48 @@
+#include "collector.hpp"
+#include "numa_stats.hpp"
+#include <optional>
+
+
+struct NumaCollector : Collector {
+
+	void configure(const json& metric) override {
+
+		nodes = collector_config::ints(metric, "nodes", "Numa metric 'nodes' must be an array");
+
+		static const std::vector<std::pair<std::string, double NumaNodeStats::*>> known = {
+			{ "total", &NumaNodeStats::total },
+			{ "free", &NumaNodeStats::free },
+			{ "used", &NumaNodeStats::used },
+			{ "numa_hit", &NumaNodeStats::numa_hit },
+			{ "numa_miss", &NumaNodeStats::numa_miss },
+			{ "numa_foreign", &NumaNodeStats::numa_foreign },
+			{ "local_node", &NumaNodeStats::local_node },
+			{ "other_node", &NumaNodeStats::other_node }
+		};
+		specs = collector_config::select_specs(metric, known, "numa", "Numa metric 'spec' must be an array of strings");
+	}
+
+	void prepare(CollectorContext&) override {
+		reader.emplace(nodes);
+	}
+
+	void collect(SampleBatch& batch) override {
+
+		reader->sample(stats);
+
+		for (const auto& node : stats) {
+			for (const auto& [name, field] : specs) {
+				batch.add<NumaMetric>(node.node, name, node.*field);
+			}
+		}
+	}
+
+private:
+
+	std::vector<int> nodes;
+	std::vector<std::pair<std::string, double NumaNodeStats::*>> specs;
+	std::optional<NumaStatsReader> reader;
+	std::vector<NumaNodeStats> stats;
+};
+
+REGISTER_COLLECTOR("numa", NumaCollector);
@@ -0,0 +1,89 @@
+#include "collector.hpp"
+#include "perf_stats.hpp"
+#include <optional>
+
+
+struct PerfCollector : Collector {
+
+	void configure(const json& metric) override {
+
+		if (!metric.contains("ids") || !metric["ids"].is_array()) {
+			throw std::runtime_error("Perf metric must have an 'ids' array");
+		}
+		ids = collector_config::ints(metric, "ids", "Perf metric must have an 'ids' array");
+
+		std::vector<std::pair<std::string, double PerfRates::*>> known = hardware_specs();
+		known.insert(known.end(), software_specs().begin(), software_specs().end());
+
+		requested = collector_config::select_specs(metric, known, "perf", "Perf metric 'spec' must be an array of strings");
+		has_spec = metric.contains("spec");
+	}
+
+	void prepare(CollectorContext&) override {
+
+		reader.emplace(ids);
+
+		// without a PMU only the software events are available, the requested hardware specs are skipped
+		const auto& available = reader->hardware() ? hardware_specs() : software_specs();
+		if (!has_spec) {
+			specs = available;
+			return;
+		}
+
+		for (const auto& spec : requested) {
+
+			bool is_available = std::any_of(available.begin(), available.end(), [&](const auto& entry) {
+				return entry.first == spec.first;
+			});
+			if (is_available) {
+				specs.push_back(spec);
+			}
+		}
+	}
+
+	void collect(SampleBatch& batch) override {
+
+		reader->sample(rates);
+
+		for (const auto& cpu : rates) {
+			for (const auto& [name, field] : specs) {
+				batch.add<PerfMetric>(cpu.cpu, name, cpu.*field);
+			}
+		}
+	}
+
+private:
+
+	using Specs = std::vector<std::pair<std::string, double PerfRates::*>>;
+
+	static const Specs& hardware_specs() {
+
+		static const Specs specs = {
+			{ "ipc", &PerfRates::ipc },
+			{ "cache_miss_rate", &PerfRates::cache_miss_rate },
+			{ "branch_miss_rate", &PerfRates::branch_miss_rate }
+		};
+		return specs;
+	}
+
+	static const Specs& software_specs() {
+
+		static const Specs specs = {
+			{ "context_switches", &PerfRates::context_switches },
+			{ "cpu_migrations", &PerfRates::cpu_migrations },
+			{ "page_faults", &PerfRates::page_faults }
+		};
+		return specs;
+	}
+
+private:
+
+	std::vector<int> ids;
+	Specs requested;
+	bool has_spec = false;
+	Specs specs; // the requested ones that this machine supports
+	std::optional<PerfStatsReader> reader;
+	std::vector<PerfRates> rates;
+};
+
+REGISTER_COLLECTOR("perf", PerfCollector);
@@ -0,0 +1,186 @@
+#include "collector.hpp"
+#include "plugin_abi.h"
+#include "thread_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <dlfcn.h>
+#include <future>
+#include <iostream>
+
+
+// a collector living in a shared object that is loaded with dlopen and driven through the C ABI of plugin_abi.h;
+// every call runs as a separate pool task that the tick waits for only until the time budget is spent, so a slow
+// or failing plugin loses its samples for that tick, but never stalls or fails the other collectors
+struct PluginCollector : Collector {
+
+	void configure(const json& metric) override {
+
+		if (!metric.contains("path") || !metric["path"].is_string()) {
+			throw std::runtime_error("Plugin metric must have a 'path' field as a string");
+		}
+		path = metric["path"].get<std::string>();
+
+		if (metric.contains("config") && !metric["config"].is_object()) {
+			throw std::runtime_error("Plugin metric 'config' must be an object");
+		}
+		config = metric.value("config", json::object()).dump();
+
+		if (metric.contains("budget_ms") && (!metric["budget_ms"].is_number_integer() || metric["budget_ms"] <= 0)) {
+			throw std::runtime_error("Plugin metric 'budget_ms' must be a positive integer");
+		}
+		budget = std::chrono::milliseconds(metric.value("budget_ms", 200));
+
+		if (metric.contains("capacity") && (!metric["capacity"].is_number_integer() || metric["capacity"] <= 0)) {
+			throw std::runtime_error("Plugin metric 'capacity' must be a positive integer");
+		}
+		capacity = metric.value("capacity", 256);
+	}
+
+	void prepare(CollectorContext&) override {
+
+		auto library = std::make_shared<Library>();
+
+		library->handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+		if (!library->handle) {
+			throw std::runtime_error("Failed to load plugin " + path + ": " + dlerror());
+		}
+
+		auto entry = reinterpret_cast<sm_plugin_entry_fn>(dlsym(library->handle, SM_PLUGIN_ENTRY));
+		library->api = entry ? entry() : nullptr;
+		if (!library->api) {
+			throw std::runtime_error("Plugin " + path + " doesn't export " SM_PLUGIN_ENTRY);
+		}
+
+		if (library->api->abi_version != SM_PLUGIN_ABI_VERSION) {
+			throw std::runtime_error("Plugin " + path + " is built for ABI version " + std::to_string(library->api->abi_version)
+				+ ", expected " + std::to_string(SM_PLUGIN_ABI_VERSION));
+		}
+
+		char error[256] = "";
+		library->state = library->api->init(config.c_str(), error, sizeof(error));
+		if (!library->state) {
+			throw std::runtime_error("Plugin " + path + " failed to initialize: " + error);
+		}
+
+		name = library->api->name ? library->api->name : path;
+
+		call = std::make_shared<Call>();
+		call->library = std::move(library);
+		call->samples.resize(capacity);
+	}
+
+	std::size_t own_workers() const override {
+		return 1;
+	}
+
+	void start(StaticThreadPool& pool) override {
+
+		pending = {};
+
+		// a call that overran its budget is still running, it isn't started a second time
+		if (call->busy.load(std::memory_order_acquire)) {
+			return;
+		}
+
+		call->busy.store(true, std::memory_order_relaxed);
+		pending = pool.submit([call = call] { call->run(); });
+		deadline = std::chrono::steady_clock::now() + budget;
+	}
+
+	void collect(SampleBatch& batch) override {
+
+		if (!pending.valid()) {
+			report("is still busy with the previous tick, skipped");
+			return;
+		}
+
+		if (pending.wait_until(deadline) != std::future_status::ready) {
+			report("exceeded its budget of " + std::to_string(budget.count()) + " ms, skipped");
+			pending = {};
+			return;
+		}
+		pending = {};
+
+		if (call->count < 0) {
+			report(std::string("failed: ") + call->error);
+			return;
+		}
+
+		for (int i = 0; i != call->count; ++i) {
+
+			auto& sample = call->samples[i];
+			sample.name[SM_SAMPLE_NAME_MAX - 1] = '\0'; // don't trust the plugin with the terminator
+			batch.add<PluginMetric>(name, sample.name, sample.value);
+		}
+		batch.layout_changed = keys.changed(call->samples.begin(), call->samples.begin() + call->count
+			, [](const sm_sample& sample) -> const char* { return sample.name; });
+		last_problem.clear();
+	}
+
+private:
+
+	// owns the library and the plugin state; destroyed only when the last call using it has returned
+	struct Library {
+
+		void* handle = nullptr;
+		const sm_plugin* api = nullptr;
+		void* state = nullptr;
+
+		~Library() {
+
+			if (state) api->destroy(state);
+			if (handle) dlclose(handle);
+		}
+	};
+
+	// shared with the pool task, so a call that overran its budget writes into memory that is still alive
+	struct Call {
+
+		std::shared_ptr<Library> library;
+		std::vector<sm_sample> samples;
+		int count = 0;
+		char error[256] = "";
+		std::atomic_bool busy{false};
+
+		void run() {
+
+			error[0] = '\0';
+			try {
+				count = library->api->collect(library->state, samples.data(), samples.size(), error, sizeof(error));
+				if (count > static_cast<int>(samples.size())) {
+					count = -1;
+					std::snprintf(error, sizeof(error), "reported more samples than the buffer holds");
+				}
+			}
+			catch (...) {
+				count = -1; // an exception crossing the C ABI is a bug of the plugin, but it shouldn't kill the monitor
+				std::snprintf(error, sizeof(error), "threw an exception");
+			}
+			busy.store(false, std::memory_order_release);
+		}
+	};
+
+	// a problem goes to stderr once, repeating it every tick until the plugin recovers would only flood the log
+	void report(const std::string& problem) {
+
+		if (problem != last_problem) {
+			std::cerr << "Plugin " << name << " " << problem << std::endl;
+			last_problem = problem;
+		}
+	}
+
+private:
+
+	std::string path;
+	std::string config; // serialized "config" object handed to init()
+	std::chrono::milliseconds budget{200};
+	std::size_t capacity = 256;
+	std::string name;
+	std::shared_ptr<Call> call;
+	std::future<void> pending;
+	std::chrono::steady_clock::time_point deadline;
+	std::string last_problem;
+	SeriesKeys<std::string> keys; // of the last batch the plugin returned
+};
+
+REGISTER_COLLECTOR("plugin", PluginCollector);
@@ -0,0 +1,49 @@
+#include "collector.hpp"
+#include "sched_stats.hpp"
+#include <optional>
+
+
+struct SchedlatCollector : Collector {
+
+	void configure(const json& metric) override {
+
+		ids = collector_config::ints(metric, "ids", "Schedlat metric 'ids' must be an array");
+		pids = collector_config::ints(metric, "pids", "Schedlat metric 'pids' must be an array");
+
+		if (!metric.contains("ids") && !metric.contains("pids")) {
+			throw std::runtime_error("Schedlat metric must have an 'ids' or a 'pids' array");
+		}
+
+		static const std::vector<std::pair<std::string, double SchedLatency::*>> known = {
+			{ "delay", &SchedLatency::delay }, { "avg_wait", &SchedLatency::avg_wait }
+		};
+		specs = collector_config::select_specs(metric, known, "schedlat", "Schedlat metric 'spec' must be an array of strings");
+	}
+
+	void prepare(CollectorContext& context) override {
+		reader.emplace(ids, pids, context.snapshot);
+	}
+
+	void collect(SampleBatch& batch) override {
+
+		reader->sample(latencies);
+		batch.layout_changed = keys.changed(latencies, [](const SchedLatency& latency) { return std::make_pair(latency.is_pid, latency.id); });
+
+		for (const auto& latency : latencies) {
+			for (const auto& [name, field] : specs) {
+				batch.add<SchedLatencyMetric>(latency.is_pid, latency.id, name, latency.*field);
+			}
+		}
+	}
+
+private:
+
+	std::vector<int> ids;
+	std::vector<int> pids;
+	std::vector<std::pair<std::string, double SchedLatency::*>> specs;
+	std::optional<SchedStatsReader> reader;
+	std::vector<SchedLatency> latencies;
+	SeriesKeys<std::pair<bool, int>> keys;
+};
+
+REGISTER_COLLECTOR("schedlat", SchedlatCollector);
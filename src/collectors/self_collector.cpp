@@ -0,0 +1,135 @@
+#include "collector.hpp"
+#include <chrono>
+#include <cmath>
+#include <fnmatch.h>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+
+// the monitor's own latencies: the distribution of every selected step (collect.<type>.<index>,
+// output.<type>.<index> or the whole "collect") over the last "window" seconds (60 by default), merged from the
+// per-thread histograms. A step runs once a tick, so a shorter window holds too few samples for percentiles;
+// the values are recomputed when a window ends and repeated until the next one, 0 makes it every tick.
+// "suppressed" is the percentage of the samples an output's deadband dropped over the window, only reported
+// for the outputs that have one
+struct SelfCollector : Collector {
+
+	enum class Stat { p50, p90, p99, max, count, suppressed };
+
+	void configure(const json& metric) override {
+
+		patterns = collector_config::strings(metric, "steps", "Self metric 'steps' must be an array of names or glob patterns", { "*" });
+
+		static const std::vector<std::pair<std::string, Stat>> known = {
+			{ "p50", Stat::p50 }, { "p90", Stat::p90 }, { "p99", Stat::p99 }, { "max", Stat::max }, { "count", Stat::count }
+			, { "suppressed", Stat::suppressed }
+		};
+		specs = collector_config::select_specs(metric, known, "self", "Self metric 'spec' must be an array of strings");
+
+		if (metric.contains("window") && (!metric["window"].is_number() || metric["window"].get<double>() < 0)) {
+			throw std::runtime_error("Self metric 'window' must be a non-negative number of seconds");
+		}
+		window = std::chrono::milliseconds(std::llround(metric.value("window", 60.0) * 1000));
+	}
+
+	void prepare(CollectorContext& context) override {
+
+		self = &context.self;
+
+		const auto& names = self->steps();
+		for (std::size_t id = 0; id != names.size(); ++id) {
+
+			bool selected = std::any_of(patterns.begin(), patterns.end(), [&](const std::string& pattern) {
+				return fnmatch(pattern.c_str(), names[id].c_str(), 0) == 0;
+			});
+			if (selected) {
+				steps.push_back({ id, std::make_unique<HdrHistogram>(), std::make_unique<HdrHistogram>() });
+			}
+		}
+
+		if (steps.empty()) {
+			throw std::runtime_error("None of the monitor's steps match the 'steps' of the self metric");
+		}
+	}
+
+	void collect(SampleBatch& batch) override {
+
+		// the first tick closes a window too, so that there is something to report until the first full one
+		auto now = std::chrono::steady_clock::now();
+		if (!window_start || now - *window_start >= window) {
+
+			window_start = now;
+			for (auto& step : steps) {
+				end_window(step);
+			}
+		}
+
+		for (const auto& step : steps) {
+
+			const auto& name = self->steps()[step.id];
+			for (const auto& [spec, stat] : specs) {
+
+				if (stat == Stat::suppressed) {
+
+					if (self->filters(step.id)) {
+						batch.add<SelfMetric>(name, spec, step.suppressed);
+					}
+					continue;
+				}
+				batch.add<SelfMetric>(name, spec, value(*step.last, stat));
+			}
+		}
+	}
+
+private:
+
+	struct Step {
+		std::size_t id;
+		std::unique_ptr<HdrHistogram> start; // cumulative at the start of the window
+		std::unique_ptr<HdrHistogram> last; // the distribution of the last window
+		SelfStats::Filtered start_filtered{};
+		double suppressed = 0; // percent, over the last window
+	};
+
+	void end_window(Step& step) {
+
+		// the histograms only grow, the window's distribution is the difference from the cumulative one at its start
+		self->merge(step.id, current);
+		step.last->copy_from(current);
+		step.last->subtract(*step.start);
+		step.start->copy_from(current);
+
+		// the counters only grow as well
+		auto filtered = self->filtered(step.id);
+		auto total = filtered.total - step.start_filtered.total;
+		auto suppressed = filtered.suppressed - step.start_filtered.suppressed;
+		step.start_filtered = filtered;
+		step.suppressed = total ? 100.0 * suppressed / total : 0.0;
+	}
+
+	static double value(const HdrHistogram& histogram, Stat stat) {
+
+		switch (stat) {
+			case Stat::p50: return static_cast<double>(histogram.value_at_quantile(0.5));
+			case Stat::p90: return static_cast<double>(histogram.value_at_quantile(0.9));
+			case Stat::p99: return static_cast<double>(histogram.value_at_quantile(0.99));
+			case Stat::max: return static_cast<double>(histogram.max());
+			case Stat::count: return static_cast<double>(histogram.count());
+			case Stat::suppressed: break; // not a latency, see collect()
+		}
+		return 0;
+	}
+
+private:
+
+	std::vector<std::string> patterns;
+	std::vector<std::pair<std::string, Stat>> specs;
+	SelfStats* self = nullptr;
+	std::chrono::milliseconds window{ 60000 };
+	std::optional<std::chrono::steady_clock::time_point> window_start;
+	std::vector<Step> steps;
+	HdrHistogram current; // scratch, reused for every step
+};
+
+REGISTER_COLLECTOR("self", SelfCollector);
@@ -0,0 +1,64 @@
+#include "collector.hpp"
+#include "socket_stats.hpp"
+#include <optional>
+
+
+struct SocketCollector : Collector {
+
+	enum class Spec { states, listeners, counters };
+
+	void configure(const json& metric) override {
+
+		static const std::vector<std::pair<std::string, Spec>> known = {
+			{ "states", Spec::states }, { "listeners", Spec::listeners }, { "counters", Spec::counters }
+		};
+		specs = collector_config::select_specs(metric, known, "sockets", "Sockets metric 'spec' must be an array of strings");
+
+		counters = collector_config::strings(metric, "counters", "Sockets metric 'counters' must be an array of 'Section:Field' strings", {
+			"Tcp:RetransSegs", "TcpExt:TCPLostRetransmit", "TcpExt:ListenOverflows", "TcpExt:ListenDrops"
+		});
+	}
+
+	void prepare(CollectorContext& context) override {
+		reader.emplace(counters, context.snapshot);
+	}
+
+	void collect(SampleBatch& batch) override {
+
+		reader->sample(sample);
+
+		for (const auto& [name, spec] : specs) {
+
+			if (spec == Spec::states) {
+				for (std::size_t state = 1; state != SocketSample::STATES_COUNT; ++state) {
+					batch.add<SocketMetric>("state", SocketSample::state_name(state), sample.states[state]);
+				}
+			}
+			else if (spec == Spec::listeners) {
+
+				batch.layout_changed = keys.changed(sample.listeners, [](const ListenerQueue& listener) -> const std::string& {
+					return listener.address;
+				});
+				for (const auto& listener : sample.listeners) {
+					batch.add<SocketMetric>("accept_queue", listener.address, listener.accept_queue);
+					batch.add<SocketMetric>("backlog", listener.address, listener.backlog);
+				}
+			}
+			else {
+				for (const auto& counter : sample.counters) {
+					batch.add<SocketMetric>("counter", counter.name, counter.value);
+				}
+			}
+		}
+	}
+
+private:
+
+	std::vector<std::pair<std::string, Spec>> specs;
+	std::vector<std::string> counters;
+	std::optional<SocketStatsReader> reader;
+	SocketSample sample;
+	SeriesKeys<std::string> keys;
+};
+
+REGISTER_COLLECTOR("sockets", SocketCollector);
@@ -0,0 +1,65 @@
+#include "collector.hpp"
+#include "thermal_stats.hpp"
+#include <optional>
+
+
+struct ThermalCollector : Collector {
+
+	enum class Spec { freq, core_throttle, package_throttle, temp };
+
+	void configure(const json& metric) override {
+
+		ids = collector_config::ints(metric, "ids", "Thermal metric 'ids' must be an array");
+		sensors = collector_config::strings(metric, "sensors", "Thermal metric 'sensors' must be an array of glob patterns", {"*"});
+
+		static const std::vector<std::pair<std::string, Spec>> known = {
+			{ "freq", Spec::freq },
+			{ "core_throttle", Spec::core_throttle },
+			{ "package_throttle", Spec::package_throttle },
+			{ "temp", Spec::temp }
+		};
+		specs = collector_config::select_specs(metric, known, "thermal", "Thermal metric 'spec' must be an array of strings");
+	}
+
+	void prepare(CollectorContext&) override {
+		reader.emplace(ids, sensors);
+	}
+
+	void collect(SampleBatch& batch) override {
+
+		const auto& sample = reader->sample();
+
+		for (const auto& cpu : sample.cpus) {
+
+			auto source = "cpu" + std::to_string(cpu.cpu);
+			for (const auto& [name, spec] : specs) {
+
+				if (spec == Spec::freq && cpu.has_freq) {
+					batch.add<ThermalMetric>(source, name, cpu.freq);
+				}
+				else if (spec == Spec::core_throttle && cpu.has_throttle) {
+					batch.add<ThermalMetric>(source, name, cpu.core_throttle);
+				}
+				else if (spec == Spec::package_throttle && cpu.has_package_throttle) {
+					batch.add<ThermalMetric>(source, name, cpu.package_throttle);
+				}
+			}
+		}
+
+		bool has_temp = std::any_of(specs.begin(), specs.end(), [](const auto& spec) { return spec.second == Spec::temp; });
+		if (has_temp) {
+			for (const auto& sensor : sample.sensors) {
+				batch.add<ThermalMetric>(sensor.sensor, "temp", sensor.temp);
+			}
+		}
+	}
+
+private:
+
+	std::vector<int> ids;
+	std::vector<std::string> sensors;
+	std::vector<std::pair<std::string, Spec>> specs;
+	std::optional<ThermalStatsReader> reader;
+};
+
+REGISTER_COLLECTOR("thermal", ThermalCollector);
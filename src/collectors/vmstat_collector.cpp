@@ -0,0 +1,37 @@
+#include "collector.hpp"
+#include "vm_stats.hpp"
+#include <optional>
+
+
+struct VmstatCollector : Collector {
+
+	void configure(const json& metric) override {
+
+		fields = collector_config::strings(metric, "fields", "Vmstat metric 'fields' must be an array of names or glob patterns", {
+			"pgfault", "pgmajfault", "pswpin", "pswpout", "pgscan_*", "pgsteal_*", "oom_kill"
+		});
+	}
+
+	void prepare(CollectorContext& context) override {
+		reader.emplace(fields, context.snapshot.file("/proc/vmstat"));
+	}
+
+	void collect(SampleBatch& batch) override {
+
+		reader->sample(rates);
+
+		for (const auto& rate : rates) {
+			batch.add<VmstatMetric>(rate.field, rate.value, rate.is_rate);
+		}
+		batch.layout_changed = fields_reported.changed(rates, [](const VmRate& rate) -> const std::string& { return rate.field; });
+	}
+
+private:
+
+	std::vector<std::string> fields;
+	std::optional<VmStatsReader> reader;
+	std::vector<VmRate> rates;
+	SeriesKeys<std::string> fields_reported;
+};
+
+REGISTER_COLLECTOR("vmstat", VmstatCollector);
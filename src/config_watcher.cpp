@@ -0,0 +1,80 @@
+#include "config_watcher.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+
+namespace {
+
+	volatile std::sig_atomic_t hangup = 0;
+
+	void on_hangup(int) {
+		hangup = 1;
+	}
+
+}
+
+
+ConfigWatcher::ConfigWatcher(const std::string& path) {
+
+	struct sigaction action{};
+	action.sa_handler = on_hangup;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	sigaction(SIGHUP, &action, nullptr);
+
+	auto slash = path.rfind('/');
+	std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+	name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0 || inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+
+		std::cerr << "Cannot watch " << directory << " (" << std::strerror(errno) << "), the config is only re-read on SIGHUP" << std::endl;
+		if (fd >= 0) {
+			::close(fd);
+			fd = -1;
+		}
+	}
+}
+
+
+ConfigWatcher::~ConfigWatcher() {
+
+	if (fd >= 0) {
+		::close(fd);
+	}
+}
+
+
+bool ConfigWatcher::changed() {
+
+	bool result = hangup != 0;
+	hangup = 0;
+
+	if (fd < 0) {
+		return result;
+	}
+
+	alignas(inotify_event) char buffer[4096];
+	while (true) {
+
+		auto length = ::read(fd, buffer, sizeof(buffer));
+		if (length <= 0) {
+			break; // EAGAIN: nothing more this tick
+		}
+
+		for (ssize_t offset = 0; offset < length; ) {
+
+			auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			if (event->len != 0 && name == event->name) {
+				result = true;
+			}
+			offset += sizeof(inotify_event) + event->len;
+		}
+	}
+	return result;
+}
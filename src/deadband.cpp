@@ -0,0 +1,153 @@
+#include "deadband.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace {
+
+	std::optional<double> epsilon_field(const json& deadband, const char* field) {
+
+		if (!deadband.contains(field)) {
+			return std::nullopt;
+		}
+		if (!deadband[field].is_number() || deadband[field].get<double>() < 0) {
+			throw std::runtime_error("Deadband '" + std::string(field) + "' must be a non-negative number");
+		}
+		return deadband[field].get<double>();
+	}
+
+}
+
+
+DeadbandOptions DeadbandOptions::parse(const json& deadband) {
+
+	if (!deadband.is_object()) {
+		throw std::runtime_error("'deadband' must be an object with 'absolute', 'relative' and/or 'heartbeat'");
+	}
+
+	DeadbandOptions options;
+	options.absolute = epsilon_field(deadband, "absolute");
+	options.relative = epsilon_field(deadband, "relative");
+
+	if (deadband.contains("heartbeat")) {
+
+		if (!deadband["heartbeat"].is_number() || deadband["heartbeat"].get<double>() < 0) {
+			throw std::runtime_error("Deadband 'heartbeat' must be a non-negative number of seconds");
+		}
+		options.heartbeat = std::chrono::milliseconds(std::llround(deadband["heartbeat"].get<double>() * 1000));
+	}
+
+	return options;
+}
+
+
+DeadbandFilter::DeadbandFilter(const DeadbandOptions& options)
+	: options(options)
+{}
+
+
+std::size_t DeadbandFilter::find_series(const std::string& name) {
+
+	auto it = index.find(name);
+	if (it != index.end()) {
+		return it->second;
+	}
+
+	names.push_back(name);
+	emitted.push_back(0);
+	emitted_at.push_back(NEVER);
+	seen_at.push_back(NEVER);
+	index.emplace(name, names.size() - 1);
+	return names.size() - 1;
+}
+
+
+bool DeadbandFilter::moved(double last, double value) const {
+
+	if (std::isnan(last) || std::isnan(value)) {
+		return std::isnan(last) != std::isnan(value);
+	}
+
+	double delta = std::fabs(value - last);
+	if (!options.absolute && !options.relative) {
+		return delta > 0;
+	}
+	return (options.absolute && delta > *options.absolute) || (options.relative && delta > *options.relative * std::fabs(last));
+}
+
+
+void DeadbandFilter::forget(std::int64_t time) {
+
+	std::vector<std::size_t> moved_to(names.size(), SIZE_MAX);
+	std::size_t kept = 0;
+
+	for (std::size_t i = 0; i != names.size(); ++i) {
+
+		if (seen_at[i] < time) {
+			index.erase(names[i]);
+			continue;
+		}
+		if (kept != i) {
+			names[kept] = std::move(names[i]);
+			emitted[kept] = emitted[i];
+			emitted_at[kept] = emitted_at[i];
+			seen_at[kept] = seen_at[i];
+			index[names[kept]] = kept;
+		}
+		moved_to[i] = kept++;
+	}
+
+	names.resize(kept);
+	emitted.resize(kept);
+	emitted_at.resize(kept);
+	seen_at.resize(kept);
+
+	for (auto& position : positions) {
+		position = position == SIZE_MAX ? SIZE_MAX : moved_to[position];
+	}
+}
+
+
+std::vector<const Metric*> DeadbandFilter::filter(const std::vector<std::unique_ptr<Metric>>& metrics, std::chrono::steady_clock::time_point now) {
+
+	std::vector<const Metric*> selected;
+	if (metrics.empty()) {
+		return selected; // an output of events only, keeps the cache of the last full batch
+	}
+
+	positions.resize(metrics.size(), SIZE_MAX);
+	std::int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+	std::int64_t heartbeat = std::chrono::duration_cast<std::chrono::nanoseconds>(options.heartbeat).count();
+	std::int64_t horizon = heartbeat > 0 ? heartbeat : std::chrono::duration_cast<std::chrono::nanoseconds>(FORGET_WITHOUT_HEARTBEAT).count();
+
+	if (next_sweep == NEVER) {
+		next_sweep = time + horizon;
+	}
+	else if (time >= next_sweep) {
+		forget(time - horizon);
+		next_sweep = time + horizon;
+	}
+
+	for (std::size_t i = 0; i != metrics.size(); ++i) {
+
+		// a string built and compared per sample, the lookup only when the layout has changed
+		auto name = metrics[i]->series();
+		if (positions[i] == SIZE_MAX || names[positions[i]] != name) {
+			positions[i] = find_series(name);
+		}
+		auto slot = positions[i];
+		seen_at[slot] = time;
+
+		double value = metrics[i]->get_value();
+		bool due = emitted_at[slot] == NEVER || (heartbeat > 0 && time - emitted_at[slot] >= heartbeat);
+		if (due || moved(emitted[slot], value)) {
+
+			emitted[slot] = value;
+			emitted_at[slot] = time;
+			selected.push_back(metrics[i].get());
+		}
+	}
+
+	return selected;
+}
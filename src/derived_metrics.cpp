@@ -0,0 +1,471 @@
+#include "derived_metrics.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+
+namespace {
+
+	constexpr double MISSING = std::numeric_limits<double>::quiet_NaN();
+
+	constexpr long MAX_RANGE = 4096; // series in one [a..b]
+
+	bool is_name_start(char c) {
+		return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+	}
+
+	bool is_name_char(char c) {
+		return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.';
+	}
+
+
+	// recursive descent straight into postfix code:
+	//   expr := term (('+' | '-') term)*
+	//   term := unary (('*' | '/') unary)*
+	//   unary := '-' unary | primary
+	//   primary := number | '(' expr ')' | function '(' argument (',' argument)* ')' | series
+	//   argument := series '[' int '..' int ']' ('.' name)? | expr
+	struct Compiler {
+
+		using Op = DerivedExpression::Op;
+
+		Compiler(const std::string& text, DerivedExpression& out)
+			: text(text)
+			, out(out)
+		{}
+
+		void compile() {
+
+			expr();
+			skip_spaces();
+			if (pos != text.size()) {
+				fail("unexpected '" + std::string(1, text[pos]) + "'");
+			}
+		}
+
+	private:
+
+		void expr() {
+
+			term();
+			for (;;) {
+				if (accept('+')) { term(); emit(Op::add); }
+				else if (accept('-')) { term(); emit(Op::sub); }
+				else return;
+			}
+		}
+
+		void term() {
+
+			unary();
+			for (;;) {
+				if (accept('*')) { unary(); emit(Op::mul); }
+				else if (accept('/')) { unary(); emit(Op::div); }
+				else return;
+			}
+		}
+
+		void unary() {
+
+			if (accept('-')) {
+				unary();
+				emit(Op::neg);
+				return;
+			}
+			primary();
+		}
+
+		void primary() {
+
+			skip_spaces();
+			if (pos == text.size()) {
+				fail("unexpected end of the expression");
+			}
+
+			char c = text[pos];
+			if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+				number();
+			}
+			else if (accept('(')) {
+				expr();
+				expect(')');
+			}
+			else if (c == '\'') {
+				load(quoted());
+			}
+			else if (is_name_start(c)) {
+
+				auto name = bare_name();
+				skip_spaces();
+				if (pos != text.size() && text[pos] == '(') {
+					function(name);
+				}
+				else if (pos != text.size() && text[pos] == '[') {
+					fail("a range of series is only allowed as an argument of sum, avg, min or max");
+				}
+				else {
+					load(name);
+				}
+			}
+			else {
+				fail("unexpected '" + std::string(1, c) + "'");
+			}
+		}
+
+		void function(const std::string& name) {
+
+			static const std::unordered_map<std::string, Op> variadic = {
+				{ "sum", Op::sum }, { "avg", Op::avg }, { "min", Op::min }, { "max", Op::max }
+			};
+
+			expect('(');
+
+			auto it = variadic.find(name);
+			if (it != variadic.end()) {
+
+				std::uint32_t count = 0;
+				do {
+					count += argument();
+				} while (accept(','));
+				expect(')');
+
+				emit(it->second, count);
+				return;
+			}
+
+			if (name == "rate" || name == "abs") {
+
+				expr();
+				expect(')');
+				if (name == "rate") {
+					emit(Op::rate, out.rates++);
+				}
+				else {
+					emit(Op::abs);
+				}
+				return;
+			}
+
+			fail("unknown function '" + name + "'");
+		}
+
+		// the number of values the argument pushes
+		std::uint32_t argument() {
+
+			skip_spaces();
+			auto start = pos;
+			if (pos == text.size() || !is_name_start(text[pos])) {
+				expr();
+				return 1;
+			}
+
+			auto prefix = bare_name();
+			if (pos == text.size() || text[pos] != '[') {
+				pos = start; // an ordinary expression that starts with a series or a function
+				expr();
+				return 1;
+			}
+
+			++pos;
+			long first = integer();
+			if (text.compare(pos, 2, "..") != 0) {
+				fail("expected '..' in the range");
+			}
+			pos += 2;
+			long last = integer();
+			expect(']');
+
+			std::string suffix;
+			if (pos != text.size() && text[pos] == '.') {
+				++pos;
+				suffix = "." + bare_name();
+			}
+
+			if (last < first || last - first >= MAX_RANGE) {
+				fail("a range must be [first..last] with at most " + std::to_string(MAX_RANGE) + " series");
+			}
+			for (long i = first; i <= last; ++i) {
+				load(prefix + "." + std::to_string(i) + suffix);
+			}
+			return static_cast<std::uint32_t>(last - first + 1);
+		}
+
+		void number() {
+
+			const char* begin = text.c_str() + pos;
+			char* end = nullptr;
+			double value = std::strtod(begin, &end);
+			if (end == begin) {
+				fail("bad number");
+			}
+			pos += static_cast<std::size_t>(end - begin);
+			emit(Op::constant, 0, value);
+		}
+
+		long integer() {
+
+			const char* begin = text.c_str() + pos;
+			char* end = nullptr;
+			long value = std::strtol(begin, &end, 10);
+			if (end == begin) {
+				fail("expected an integer");
+			}
+			pos += static_cast<std::size_t>(end - begin);
+			return value;
+		}
+
+		std::string bare_name() {
+
+			if (pos == text.size() || !is_name_start(text[pos])) {
+				fail("expected a name");
+			}
+			auto start = pos;
+			while (pos != text.size() && is_name_char(text[pos])) {
+				++pos;
+			}
+			return text.substr(start, pos - start);
+		}
+
+		std::string quoted() {
+
+			auto end = text.find('\'', pos + 1);
+			if (end == std::string::npos) {
+				fail("unterminated quoted series name");
+			}
+			auto name = text.substr(pos + 1, end - pos - 1);
+			pos = end + 1;
+			if (name.empty()) {
+				fail("empty series name");
+			}
+			return name;
+		}
+
+		void load(const std::string& name) {
+
+			auto it = std::find(out.series.begin(), out.series.end(), name);
+			if (it == out.series.end()) {
+				out.series.push_back(name);
+				it = out.series.end() - 1;
+			}
+			emit(Op::load, static_cast<std::uint32_t>(it - out.series.begin()));
+		}
+
+		void emit(Op op, std::uint32_t arg = 0, double value = 0) {
+
+			out.code.push_back({ op, arg, value });
+
+			switch (op) {
+				case Op::constant:
+				case Op::load:
+					++depth;
+					break;
+				case Op::add: case Op::sub: case Op::mul: case Op::div:
+					--depth;
+					break;
+				case Op::sum: case Op::avg: case Op::min: case Op::max:
+					depth = depth - arg + 1;
+					break;
+				case Op::neg: case Op::abs: case Op::rate:
+					break;
+			}
+			out.stack_depth = std::max(out.stack_depth, depth);
+		}
+
+		void skip_spaces() {
+			while (pos != text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+				++pos;
+			}
+		}
+
+		bool accept(char c) {
+
+			skip_spaces();
+			if (pos != text.size() && text[pos] == c) {
+				++pos;
+				return true;
+			}
+			return false;
+		}
+
+		void expect(char c) {
+			if (!accept(c)) {
+				fail(std::string("expected '") + c + "'");
+			}
+		}
+
+		[[noreturn]] void fail(const std::string& what) const {
+			throw std::runtime_error("Derived metric '" + out.name + "': " + what + " at position " + std::to_string(pos + 1) + " of \"" + text + "\"");
+		}
+
+	private:
+
+		const std::string& text;
+		DerivedExpression& out;
+		std::size_t pos = 0;
+		std::size_t depth = 0;
+	};
+
+}
+
+
+DerivedExpression DerivedExpression::compile(const json& metric) {
+
+	if (!metric.contains("name") || !metric["name"].is_string() || metric["name"].get_ref<const std::string&>().empty()) {
+		throw std::runtime_error("Derived metric must have a 'name' as a non-empty string");
+	}
+	if (!metric.contains("expr") || !metric["expr"].is_string()) {
+		throw std::runtime_error("Derived metric must have an 'expr' as a string");
+	}
+
+	DerivedExpression expression;
+	expression.name = metric["name"].get<std::string>();
+	expression.text = metric["expr"].get<std::string>();
+
+	Compiler(expression.text, expression).compile();
+	return expression;
+}
+
+
+DerivedMetrics::DerivedMetrics(std::vector<DerivedExpression> compiled)
+	: expressions(std::move(compiled))
+	, slots("Derived metrics")
+{
+	std::unordered_map<std::string, std::size_t> defined; // name -> the expression
+	for (std::size_t i = 0; i != expressions.size(); ++i) {
+		defined.emplace(expressions[i].name, i);
+	}
+
+	result_slots.assign(expressions.size(), SIZE_MAX);
+	std::size_t depth = 0;
+
+	for (std::size_t i = 0; i != expressions.size(); ++i) {
+
+		auto& expression = expressions[i];
+
+		// the expression's own numbering of its series and rates becomes the stage-wide one; a derived series can
+		// be used by the expressions after it and gets its value as soon as it's computed
+		for (auto& instruction : expression.code) {
+
+			if (instruction.op == DerivedExpression::Op::load) {
+
+				const auto& name = expression.series[instruction.arg];
+				auto it = defined.find(name);
+				if (it != defined.end() && it->second >= i) {
+					throw std::runtime_error("Derived metric '" + expression.name + "' uses '" + name + "', which must be defined before it");
+				}
+
+				auto slot = slots.add(name, it == defined.end());
+				if (it != defined.end()) {
+					result_slots[it->second] = slot;
+				}
+				instruction.arg = static_cast<std::uint32_t>(slot);
+			}
+			else if (instruction.op == DerivedExpression::Op::rate) {
+				instruction.arg += static_cast<std::uint32_t>(rates.size());
+			}
+		}
+
+		rates.resize(rates.size() + expression.rates);
+		depth = std::max(depth, expression.stack_depth);
+	}
+
+	stack.resize(depth);
+}
+
+
+void DerivedMetrics::evaluate(std::vector<std::unique_ptr<Metric>>& metrics, std::chrono::steady_clock::time_point now) {
+
+	slots.read(metrics);
+
+	for (std::size_t i = 0; i != expressions.size(); ++i) {
+
+		double value = run(expressions[i], now);
+		if (result_slots[i] != SIZE_MAX) {
+			slots[result_slots[i]] = value;
+		}
+		if (std::isfinite(value)) {
+			metrics.emplace_back(new DerivedMetric(expressions[i].name, value));
+		}
+	}
+}
+
+
+double DerivedMetrics::run(const DerivedExpression& expression, std::chrono::steady_clock::time_point now) {
+
+	using Op = DerivedExpression::Op;
+
+	double* top = stack.data() - 1; // the last pushed value
+
+	for (const auto& instruction : expression.code) {
+
+		switch (instruction.op) {
+
+			case Op::constant: *++top = instruction.value; break;
+			case Op::load: *++top = slots[instruction.arg]; break;
+
+			case Op::add: top[-1] += top[0]; --top; break;
+			case Op::sub: top[-1] -= top[0]; --top; break;
+			case Op::mul: top[-1] *= top[0]; --top; break;
+			case Op::div: top[-1] /= top[0]; --top; break;
+			case Op::neg: *top = -*top; break;
+			case Op::abs: *top = std::fabs(*top); break;
+
+			case Op::sum:
+			case Op::avg:
+			case Op::min:
+			case Op::max: {
+
+				// the missing series are skipped, NaN only if all of them are missing
+				double* args = top - instruction.arg + 1;
+				double sum = 0;
+				double min = std::numeric_limits<double>::infinity();
+				double max = -min;
+				std::uint32_t present = 0;
+
+				for (std::uint32_t k = 0; k != instruction.arg; ++k) {
+
+					double x = args[k];
+					if (std::isnan(x)) continue;
+					sum += x;
+					min = std::min(min, x);
+					max = std::max(max, x);
+					++present;
+				}
+
+				double result = MISSING;
+				if (present != 0) {
+					switch (instruction.op) {
+						case Op::sum: result = sum; break;
+						case Op::avg: result = sum / present; break;
+						case Op::min: result = min; break;
+						default: result = max; break;
+					}
+				}
+
+				top = args;
+				*top = result;
+				break;
+			}
+
+			case Op::rate: {
+
+				auto& state = rates[instruction.arg];
+				double value = *top;
+				double seconds = std::chrono::duration<double>(now - state.time).count();
+
+				*top = state.known && seconds > 0 ? (value - state.value) / seconds : MISSING;
+				if (!std::isnan(value)) {
+					state = { value, now, true };
+				}
+				break;
+			}
+		}
+	}
+
+	return *top;
+}
@@ -0,0 +1,156 @@
+#include "disk_stats.hpp"
+#include <fnmatch.h>
+#include <unordered_map>
+
+
+namespace {
+
+	constexpr double SECTOR_SIZE = 512.0; // /proc/diskstats always counts 512-byte sectors
+	constexpr double MB = 1024.0 * 1024.0;
+
+}
+
+
+DiskStatsReader::DiskStatsReader(std::vector<std::string> patterns, SharedProcFile& file)
+	: file(file)
+	, patterns(std::move(patterns))
+	, prev_time(std::chrono::steady_clock::now())
+{
+	rebuild(file.read());
+}
+
+
+bool DiskStatsReader::matches(const std::string& name) const {
+
+	for (const auto& pattern : patterns) {
+		if (fnmatch(pattern.c_str(), name.c_str(), 0) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool DiskStatsReader::parse_line(std::string_view line, std::string_view& name, DiskCounters& counters) {
+
+	using namespace proc_parse;
+
+	next_u64(line); // major
+	next_u64(line); // minor
+	name = next_token(line);
+	if (name.empty()) {
+		return false;
+	}
+
+	counters.reads = next_u64(line);
+	next_u64(line); // reads merged
+	counters.sectors_read = next_u64(line);
+	counters.ms_reading = next_u64(line);
+	counters.writes = next_u64(line);
+	next_u64(line); // writes merged
+	counters.sectors_written = next_u64(line);
+	counters.ms_writing = next_u64(line);
+	next_u64(line); // I/Os currently in progress
+	counters.ms_doing_io = next_u64(line);
+
+	return true;
+}
+
+
+void DiskStatsReader::rebuild(std::string_view text) {
+
+	std::unordered_map<std::string_view, std::size_t> old_slots;
+	for (std::size_t i = 0; i != devices.size(); ++i) {
+		old_slots.emplace(devices[i].name, i);
+	}
+
+	std::vector<Device> new_devices;
+	std::string_view line;
+	while (proc_parse::next_line(text, line)) {
+
+		std::string_view name;
+		DiskCounters counters{};
+		if (!parse_line(line, name, counters)) continue;
+
+		Device device{std::string(name), false, false, {}};
+		device.selected = matches(device.name);
+
+		auto it = old_slots.find(name);
+		if (it != old_slots.end()) {
+			device.has_prev = devices[it->second].has_prev;
+			device.prev = devices[it->second].prev;
+		}
+		new_devices.push_back(std::move(device));
+	}
+
+	devices = std::move(new_devices);
+}
+
+
+void DiskStatsReader::sample(std::vector<DiskRates>& out) {
+
+	out.clear();
+
+	auto text = file.read();
+	auto now = std::chrono::steady_clock::now();
+	double elapsed_ms = std::chrono::duration<double, std::milli>(now - prev_time).count();
+	prev_time = now;
+
+	// the table is only rebuilt when a device has appeared, disappeared or moved
+	bool layout_changed = false;
+	{
+		std::string_view rest = text, line, name;
+		std::size_t slot = 0;
+		DiskCounters counters;
+		while (proc_parse::next_line(rest, line)) {
+			if (!parse_line(line, name, counters)) continue;
+			if (slot >= devices.size() || devices[slot].name != name) {
+				layout_changed = true;
+				break;
+			}
+			++slot;
+		}
+		layout_changed = layout_changed || slot != devices.size();
+	}
+
+	if (layout_changed) {
+		rebuild(text);
+	}
+
+	std::string_view line, name;
+	std::size_t slot = 0;
+	while (proc_parse::next_line(text, line)) {
+
+		DiskCounters curr;
+		if (!parse_line(line, name, curr)) continue;
+
+		auto& device = devices[slot++];
+		if (!device.selected) {
+			device.prev = curr;
+			device.has_prev = true;
+			continue;
+		}
+
+		const DiskCounters& prev = device.has_prev ? device.prev : curr;
+
+		auto reads = curr.reads - prev.reads;
+		auto writes = curr.writes - prev.writes;
+		double seconds = elapsed_ms / 1000.0;
+
+		DiskRates rates;
+		rates.device = device.name;
+		rates.read_iops = (seconds > 0) ? reads / seconds : 0.0;
+		rates.write_iops = (seconds > 0) ? writes / seconds : 0.0;
+		rates.read_throughput = (seconds > 0) ? (curr.sectors_read - prev.sectors_read) * SECTOR_SIZE / MB / seconds : 0.0;
+		rates.write_throughput = (seconds > 0) ? (curr.sectors_written - prev.sectors_written) * SECTOR_SIZE / MB / seconds : 0.0;
+		rates.read_latency = (reads > 0) ? static_cast<double>(curr.ms_reading - prev.ms_reading) / reads : 0.0;
+		rates.write_latency = (writes > 0) ? static_cast<double>(curr.ms_writing - prev.ms_writing) / writes : 0.0;
+		rates.util = (elapsed_ms > 0) ? (curr.ms_doing_io - prev.ms_doing_io) / elapsed_ms * 100.0 : 0.0;
+		if (rates.util > 100.0) rates.util = 100.0;
+
+		out.push_back(std::move(rates));
+
+		device.prev = curr;
+		device.has_prev = true;
+	}
+}
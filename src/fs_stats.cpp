@@ -0,0 +1,212 @@
+#include "fs_stats.hpp"
+#include <algorithm>
+#include <fnmatch.h>
+#include <poll.h>
+#include <sys/statvfs.h>
+#include <unordered_set>
+
+
+void FsStatsReader::Probe::run(std::uint64_t current_tick) {
+
+	struct statvfs st;
+	if (::statvfs(mount.c_str(), &st) == 0) {
+
+		error = 0;
+		block_size = st.f_frsize ? st.f_frsize : st.f_bsize;
+		blocks = st.f_blocks;
+		blocks_avail = st.f_bavail;
+		blocks_free = st.f_bfree;
+		files = st.f_files;
+		files_free = st.f_ffree;
+	}
+	else {
+		error = errno;
+	}
+
+	tick.store(current_tick, std::memory_order_release);
+	queued.store(false, std::memory_order_release);
+}
+
+
+bool FsStatsReader::Queue::pop(std::shared_ptr<Probe>& probe, std::uint64_t& current_tick) {
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (probes.empty()) {
+		return false;
+	}
+	probe = std::move(probes.front());
+	probes.pop_front();
+	current_tick = tick;
+	return true;
+}
+
+
+FsStatsReader::FsStatsReader(std::vector<std::string> mount_patterns, std::vector<std::string> fstype_patterns
+	, std::chrono::milliseconds timeout, std::size_t lanes, const std::string& path)
+	: mountinfo(path, 16 * 1024)
+	, mount_patterns(std::move(mount_patterns))
+	, fstype_patterns(std::move(fstype_patterns))
+	, timeout(timeout)
+	, queue(std::make_shared<Queue>())
+	, pending(lanes)
+{
+	for (std::size_t i = 0; i != lanes; ++i) {
+		this->lanes.push_back(std::make_shared<Lane>());
+	}
+	parse(mountinfo.read());
+}
+
+
+bool FsStatsReader::matches(const std::vector<std::string>& patterns, const std::string& value) {
+
+	return std::any_of(patterns.begin(), patterns.end(), [&](const std::string& pattern) {
+		return fnmatch(pattern.c_str(), value.c_str(), 0) == 0;
+	});
+}
+
+
+std::string FsStatsReader::unescape(std::string_view field) {
+
+	std::string result;
+	result.reserve(field.size());
+
+	for (std::size_t i = 0; i < field.size(); ++i) {
+
+		if (field[i] == '\\' && i + 3 < field.size()) {
+
+			int code = (field[i + 1] - '0') * 64 + (field[i + 2] - '0') * 8 + (field[i + 3] - '0');
+			result.push_back(static_cast<char>(code));
+			i += 3;
+		}
+		else {
+			result.push_back(field[i]);
+		}
+	}
+	return result;
+}
+
+
+void FsStatsReader::parse(std::string_view text) {
+
+	std::vector<std::shared_ptr<Probe>> selected;
+	std::unordered_set<std::string_view> devices;
+	std::unordered_set<std::string> mounts;
+
+	// "36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw,errors=continue"
+	std::string_view line;
+	while (proc_parse::next_line(text, line)) {
+
+		proc_parse::next_token(line); // mount id
+		proc_parse::next_token(line); // parent id
+		auto device = proc_parse::next_token(line); // major:minor
+		proc_parse::next_token(line); // root of the mount within the filesystem
+		auto mount = unescape(proc_parse::next_token(line));
+
+		// optional fields run until the " - " separator
+		for (auto token = proc_parse::next_token(line); !token.empty() && token != "-"; token = proc_parse::next_token(line));
+		std::string fstype(proc_parse::next_token(line));
+
+		if (!matches(mount_patterns, mount) || !matches(fstype_patterns, fstype)) continue;
+
+		// bind mounts report the same numbers as the filesystem itself, so it's queried at its first mount point only;
+		// a mount point that is mounted over is reported once too, statvfs only sees the topmost mount anyway
+		if (!devices.insert(device).second || !mounts.insert(mount).second) continue;
+
+		// the state (and a possibly hung call) of the mounts that are still there is kept
+		auto it = std::find_if(probes.begin(), probes.end(), [&](const auto& probe) { return probe->mount == mount; });
+		if (it != probes.end()) {
+			selected.push_back(*it);
+		}
+		else {
+			auto probe = std::make_shared<Probe>();
+			probe->mount = std::move(mount);
+			selected.push_back(std::move(probe));
+		}
+	}
+
+	probes.swap(selected);
+}
+
+
+void FsStatsReader::submit(StaticThreadPool& pool) {
+
+	// the kernel raises POLLPRI (with POLLERR) once per change of the mount namespace and clears it on this poll
+	pollfd pfd{mountinfo.get_fd(), POLLPRI, 0};
+	if (::poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLPRI | POLLERR))) {
+		parse(mountinfo.read());
+	}
+
+	++tick;
+	deadline = std::chrono::steady_clock::now() + timeout;
+
+	// a probe that is still waiting in the queue or in a call isn't queried a second time
+	{
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		queue->tick = tick;
+		for (const auto& probe : probes) {
+
+			if (probe->queued.load(std::memory_order_acquire)) continue;
+
+			probe->queued.store(true, std::memory_order_relaxed);
+			queue->probes.push_back(probe);
+		}
+		if (queue->probes.empty()) {
+			return;
+		}
+	}
+
+	// the lanes that are stuck stay as they are, everything is reported as not responding if all of them are
+	for (std::size_t i = 0; i != lanes.size(); ++i) {
+
+		auto& lane = lanes[i];
+		if (lane->busy.load(std::memory_order_acquire)) continue;
+
+		lane->busy.store(true, std::memory_order_relaxed);
+		pending[i] = pool.submit([lane, queue = queue] {
+
+			std::shared_ptr<Probe> probe;
+			std::uint64_t current_tick;
+			while (queue->pop(probe, current_tick)) {
+				probe->run(current_tick);
+			}
+			lane->busy.store(false, std::memory_order_release);
+		});
+	}
+}
+
+
+void FsStatsReader::collect(std::vector<FsUsage>& out) {
+
+	out.clear();
+
+	for (auto& lane : pending) {
+		if (lane.valid()) {
+			lane.wait_until(deadline);
+			lane = {};
+		}
+	}
+
+	constexpr double GB = 1024.0 * 1024.0 * 1024.0;
+
+	for (const auto& probe : probes) {
+
+		bool responding = probe->tick.load(std::memory_order_acquire) == tick;
+		if (responding && probe->error != 0) continue; // unmounted meanwhile or not permitted, nothing to report
+
+		FsUsage usage{probe->mount, responding, 0, 0, 0, 0, 0};
+		if (responding) {
+
+			usage.size = probe->blocks * probe->block_size / GB;
+			usage.avail = probe->blocks_avail * probe->block_size / GB;
+
+			// like df: the used share of what non-root users can get, the reserved blocks are not counted in
+			auto used = probe->blocks - probe->blocks_free;
+			auto usable = used + probe->blocks_avail;
+			usage.used = usable ? 100.0 * used / usable : 0.0;
+
+			usage.inodes_avail = static_cast<double>(probe->files_free);
+			usage.inodes_used = probe->files ? 100.0 * (probe->files - probe->files_free) / probe->files : 0.0;
+		}
+		out.push_back(std::move(usage));
+	}
+}
@@ -0,0 +1,151 @@
+#include "hdr_histogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+	// two significant digits need 2 * 10^2 -> 256 sub-buckets per power of two; the lower half of every bucket
+	// but the first one overlaps the previous bucket, so each of them only stores its upper 128 sub-buckets
+	constexpr unsigned SUB_BUCKET_COUNT_MAGNITUDE = 8;
+	constexpr std::uint64_t SUB_BUCKET_COUNT = 1ull << SUB_BUCKET_COUNT_MAGNITUDE;
+	constexpr unsigned SUB_BUCKET_HALF_COUNT_MAGNITUDE = SUB_BUCKET_COUNT_MAGNITUDE - 1;
+	constexpr std::uint64_t SUB_BUCKET_HALF_COUNT = SUB_BUCKET_COUNT / 2;
+	constexpr std::uint64_t SUB_BUCKET_MASK = SUB_BUCKET_COUNT - 1;
+
+	constexpr std::size_t bucket_count() {
+
+		std::size_t buckets = 1;
+		for (std::uint64_t untrackable = SUB_BUCKET_COUNT; untrackable <= HdrHistogram::HIGHEST; untrackable <<= 1) {
+			++buckets;
+		}
+		return buckets;
+	}
+
+	constexpr std::size_t COUNTS_SIZE = (bucket_count() + 1) * SUB_BUCKET_HALF_COUNT;
+
+}
+
+
+HdrHistogram::HdrHistogram()
+	: counts(new std::atomic<std::uint64_t>[COUNTS_SIZE])
+{
+	reset();
+}
+
+
+std::size_t HdrHistogram::index_of(std::uint64_t value) {
+
+	int pow2_ceiling = 64 - __builtin_clzll(value | SUB_BUCKET_MASK);
+	int bucket = pow2_ceiling - static_cast<int>(SUB_BUCKET_HALF_COUNT_MAGNITUDE + 1);
+	auto sub_bucket = value >> bucket;
+
+	return ((static_cast<std::size_t>(bucket) + 1) << SUB_BUCKET_HALF_COUNT_MAGNITUDE) + (sub_bucket - SUB_BUCKET_HALF_COUNT);
+}
+
+
+std::uint64_t HdrHistogram::value_at_index(std::size_t index) {
+
+	int bucket = static_cast<int>(index >> SUB_BUCKET_HALF_COUNT_MAGNITUDE) - 1;
+	std::uint64_t sub_bucket = (index & (SUB_BUCKET_HALF_COUNT - 1)) + SUB_BUCKET_HALF_COUNT;
+	if (bucket < 0) {
+		sub_bucket -= SUB_BUCKET_HALF_COUNT;
+		bucket = 0;
+	}
+	return sub_bucket << bucket;
+}
+
+
+std::uint64_t HdrHistogram::highest_equivalent(std::uint64_t value) {
+
+	int pow2_ceiling = 64 - __builtin_clzll(value | SUB_BUCKET_MASK);
+	int bucket = pow2_ceiling - static_cast<int>(SUB_BUCKET_HALF_COUNT_MAGNITUDE + 1);
+	std::uint64_t range = 1ull << bucket; // the values that share the sub-bucket
+	return (value & ~(range - 1)) + range - 1;
+}
+
+
+void HdrHistogram::record(std::uint64_t us) {
+
+	auto& counter = counts[index_of(std::min(us, HIGHEST))];
+
+	// the only writer, so a load and a store are enough and cheaper than a locked fetch_add
+	counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	total.store(total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+
+void HdrHistogram::add(const HdrHistogram& other) {
+
+	for (std::size_t i = 0; i != COUNTS_SIZE; ++i) {
+		counts[i].store(counts[i].load(std::memory_order_relaxed) + other.counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+	total.store(total.load(std::memory_order_relaxed) + other.count(), std::memory_order_relaxed);
+}
+
+
+void HdrHistogram::subtract(const HdrHistogram& other) {
+
+	std::uint64_t sum = 0;
+	for (std::size_t i = 0; i != COUNTS_SIZE; ++i) {
+
+		auto mine = counts[i].load(std::memory_order_relaxed);
+		auto theirs = other.counts[i].load(std::memory_order_relaxed);
+		auto diff = mine >= theirs ? mine - theirs : 0;
+
+		counts[i].store(diff, std::memory_order_relaxed);
+		sum += diff;
+	}
+	// the sum, not the difference of the totals, since the counters and the total of a live histogram are
+	// read at slightly different moments
+	total.store(sum, std::memory_order_relaxed);
+}
+
+
+void HdrHistogram::copy_from(const HdrHistogram& other) {
+
+	for (std::size_t i = 0; i != COUNTS_SIZE; ++i) {
+		counts[i].store(other.counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+	total.store(other.count(), std::memory_order_relaxed);
+}
+
+
+void HdrHistogram::reset() {
+
+	for (std::size_t i = 0; i != COUNTS_SIZE; ++i) {
+		counts[i].store(0, std::memory_order_relaxed);
+	}
+	total.store(0, std::memory_order_relaxed);
+}
+
+
+std::uint64_t HdrHistogram::value_at_quantile(double q) const {
+
+	auto n = count();
+	if (n == 0) {
+		return 0;
+	}
+
+	auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * n)));
+	std::uint64_t seen = 0;
+	for (std::size_t i = 0; i != COUNTS_SIZE; ++i) {
+
+		seen += counts[i].load(std::memory_order_relaxed);
+		if (seen >= rank) {
+			return highest_equivalent(value_at_index(i));
+		}
+	}
+	return max();
+}
+
+
+std::uint64_t HdrHistogram::max() const {
+
+	for (std::size_t i = COUNTS_SIZE; i-- != 0; ) {
+		if (counts[i].load(std::memory_order_relaxed) != 0) {
+			return highest_equivalent(value_at_index(i));
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,254 @@
+#include "irq_stats.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fnmatch.h>
+#include <stdexcept>
+
+
+namespace {
+
+	const char* skip_line(const char* pos, const char* end) {
+
+		auto* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+		return newline ? newline + 1 : end;
+	}
+
+	// "  LOC:   123 ..." -> "LOC", the line is left right after the colon
+	std::string_view take_label(std::string_view& line) {
+
+		proc_parse::skip_spaces(line);
+		auto colon = line.find(':');
+		if (colon == std::string_view::npos) {
+			return {};
+		}
+		auto label = line.substr(0, colon);
+		line.remove_prefix(colon + 1);
+		return label;
+	}
+
+}
+
+
+IrqStatsReader::IrqStatsReader(SharedProcFile& file, std::vector<std::string> patterns)
+	: file(file)
+	, patterns(std::move(patterns))
+	, prev_time(std::chrono::steady_clock::now())
+{
+	rebuild(file.read());
+}
+
+
+bool IrqStatsReader::matches(std::string_view label, std::string_view description) const {
+
+	std::string label_str(label);
+	std::string description_str(description);
+
+	for (const auto& pattern : patterns) {
+		if (fnmatch(pattern.c_str(), label_str.c_str(), 0) == 0 ||
+			(!description_str.empty() && fnmatch(pattern.c_str(), description_str.c_str(), 0) == 0))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+std::size_t IrqStatsReader::count_cpus(std::string_view header, std::vector<int>* ids) {
+
+	std::size_t count = 0;
+	for (auto token = proc_parse::next_token(header); !token.empty(); token = proc_parse::next_token(header)) {
+
+		if (ids) {
+			token.remove_prefix(3); // "CPU"
+			ids->push_back(static_cast<int>(proc_parse::next_u64(token)));
+		}
+		++count;
+	}
+	return count;
+}
+
+
+bool IrqStatsReader::parse_fixed_width(std::string_view& line, std::uint64_t* row, std::size_t cpus) {
+
+	// right after the colon both files print every counter as " %10u", so the row is a sequence of
+	// 11-byte cells that are converted 8 digits at a time (SWAR) without data-dependent branches
+	constexpr std::size_t CELL = 11;
+	if (line.size() < cpus * CELL) {
+		return false;
+	}
+
+	const char* cells = line.data();
+	std::uint64_t bad = 0;
+
+	for (std::size_t cpu = 0; cpu != cpus; ++cpu) {
+
+		const char* cell = cells + cpu * CELL;
+
+		std::uint64_t low;
+		std::memcpy(&low, cell + 3, sizeof(low)); // the last 8 digits
+
+		// digits and padding spaces both have 0x2 or 0x3 in the high nibble, anything else isn't our layout
+		bad |= ((low & 0xF0F0F0F0F0F0F0F0ull) | 0x1010101010101010ull) ^ 0x3030303030303030ull;
+		bad |= static_cast<std::uint64_t>(cell[0] != ' ');
+
+		// '0'..'9' -> 0..9 and ' ' -> 0, then pairs, quads and the whole 8 digits are combined
+		low &= 0x0F0F0F0F0F0F0F0Full;
+		low = (low * 10 + (low >> 8)) & 0x00FF00FF00FF00FFull;
+		low = (low * 100 + (low >> 16)) & 0x0000FFFF0000FFFFull;
+		low = (low * 10000 + (low >> 32)) & 0x00000000FFFFFFFFull;
+
+		std::uint64_t high = (cell[1] & 0x0F) * 10 + (cell[2] & 0x0F);
+		row[cpu] = high * 100000000ull + low;
+	}
+
+	if (bad) {
+		return false;
+	}
+	line.remove_prefix(cpus * CELL);
+	return true;
+}
+
+
+void IrqStatsReader::parse_counters(std::string_view& line, std::uint64_t* row, std::size_t cpus) {
+
+	if (parse_fixed_width(line, row, cpus)) {
+		return;
+	}
+
+	const char* pos = line.data();
+	const char* end = pos + line.size();
+
+	std::size_t cpu = 0;
+	for (; cpu != cpus; ++cpu) {
+
+		while (pos != end && *pos == ' ') ++pos;
+		if (pos == end || *pos < '0' || *pos > '9') break;
+
+		std::uint64_t value = 0;
+		while (pos != end && *pos >= '0' && *pos <= '9') {
+			value = value * 10 + static_cast<std::uint64_t>(*pos - '0');
+			++pos;
+		}
+		row[cpu] = value;
+	}
+	std::fill(row + cpu, row + cpus, 0);
+
+	line.remove_prefix(pos - line.data());
+}
+
+
+void IrqStatsReader::rebuild(std::string_view text) {
+
+	rows.clear();
+	result.cpus.clear();
+	result.irqs.clear();
+	has_prev = false;
+
+	std::string_view line;
+	if (!proc_parse::next_line(text, line)) {
+		throw std::runtime_error("Unexpected empty " + file.get_path());
+	}
+
+	std::size_t cpus = count_cpus(line, &result.cpus);
+	std::vector<std::uint64_t> scratch(cpus);
+
+	std::size_t line_no = 1;
+	while (proc_parse::next_line(text, line)) {
+
+		auto label = take_label(line);
+		if (!label.empty()) {
+
+			parse_counters(line, scratch.data(), cpus);
+			proc_parse::skip_spaces(line);
+
+			if (matches(label, line)) {
+				rows.push_back({line_no, std::string(label)});
+				result.irqs.emplace_back(label);
+			}
+		}
+		++line_no;
+	}
+	lines = line_no;
+
+	curr.assign(rows.size() * cpus, 0);
+	prev.assign(rows.size() * cpus, 0);
+	result.rates.assign(rows.size() * cpus, 0.0);
+	result.totals.assign(cpus, 0.0);
+}
+
+
+bool IrqStatsReader::parse(std::string_view text) {
+
+	const std::size_t cpus = result.cpus.size();
+	const char* pos = text.data();
+	const char* end = pos + text.size();
+
+	std::string_view header(pos, skip_line(pos, end) - pos);
+	if (count_cpus(header, nullptr) != cpus) {
+		return false;
+	}
+
+	std::size_t line_no = 0;
+	for (std::size_t r = 0; r != rows.size(); ++r) {
+
+		while (line_no < rows[r].line && pos != end) {
+			pos = skip_line(pos, end);
+			++line_no;
+		}
+
+		// a changed label means that an irq has appeared or gone
+		std::string_view line(pos, skip_line(pos, end) - pos);
+		if (take_label(line) != rows[r].label) {
+			return false;
+		}
+		parse_counters(line, curr.data() + r * cpus, cpus);
+	}
+
+	while (pos != end) {
+		pos = skip_line(pos, end);
+		++line_no;
+	}
+	return line_no == lines;
+}
+
+
+const IrqRates& IrqStatsReader::sample() {
+
+	auto text = file.read();
+	auto now = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(now - prev_time).count();
+	prev_time = now;
+
+	if (!parse(text)) {
+		rebuild(text);
+		parse(text);
+	}
+
+	const std::size_t cpus = result.cpus.size();
+
+	// flat loops over contiguous rows, which the compiler vectorizes across the cpu columns
+	const double scale = (has_prev && seconds > 0) ? 1.0 / seconds : 0.0;
+	const std::uint64_t* c = curr.data();
+	const std::uint64_t* p = prev.data();
+	double* rates = result.rates.data();
+
+	for (std::size_t i = 0, n = curr.size(); i != n; ++i) {
+		rates[i] = (c[i] >= p[i]) ? static_cast<double>(c[i] - p[i]) * scale : 0.0;
+	}
+
+	double* totals = result.totals.data();
+	std::fill(totals, totals + cpus, 0.0);
+	for (std::size_t r = 0; r != rows.size(); ++r) {
+
+		const double* row = rates + r * cpus;
+		for (std::size_t cpu = 0; cpu != cpus; ++cpu) {
+			totals[cpu] += row[cpu];
+		}
+	}
+
+	curr.swap(prev);
+	has_prev = true;
+
+	return result;
+}
@@ -0,0 +1,477 @@
+#include "net_stats.hpp"
+#include <algorithm>
+#include <dirent.h>
+#include <cstring>
+#include <fnmatch.h>
+#include <iostream>
+#include <linux/if_link.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <stdexcept>
+#include <unordered_map>
+
+
+namespace {
+
+	const char* const SYSFS_NET = "/sys/class/net";
+
+	// file names under /sys/class/net/<if>/statistics in the order of the NetCounters fields
+	const char* const SYSFS_COUNTERS[] = {
+		"rx_bytes", "rx_packets", "rx_errors", "rx_dropped",
+		"tx_bytes", "tx_packets", "tx_errors", "tx_dropped"
+	};
+
+	constexpr std::size_t COUNTERS_COUNT = sizeof(SYSFS_COUNTERS) / sizeof(SYSFS_COUNTERS[0]);
+
+	std::uint64_t& counter_at(NetCounters& counters, std::size_t i) {
+
+		std::uint64_t* fields[] = {
+			&counters.rx_bytes, &counters.rx_packets, &counters.rx_errors, &counters.rx_drops,
+			&counters.tx_bytes, &counters.tx_packets, &counters.tx_errors, &counters.tx_drops
+		};
+		return *fields[i];
+	}
+
+	bool is_hidden(const char* name) {
+		return name[0] == '.';
+	}
+
+}
+
+
+NetStatsReader::NetStatsReader(std::vector<std::string> patterns, NetSource source, ProcSnapshot& snapshot)
+	: source(source)
+	, patterns(std::move(patterns))
+	, prev_time(std::chrono::steady_clock::now())
+{
+	if (source == NetSource::netlink) {
+
+		try {
+			netlink = std::make_unique<NetlinkSocket>(NETLINK_ROUTE);
+
+			// a kernel without RTM_GETSTATS (before 4.7) opens the socket fine and fails the dump, which would
+			// then fail every tick; the probe is a real first sample, the next tick reports the rates since it
+			std::vector<NetRates> probe;
+			sample_netlink(0, probe);
+			if (netlink_count == 0) {
+				throw std::runtime_error("RTM_GETSTATS returned no IFLA_STATS_LINK_64 statistics");
+			}
+		}
+		catch (const std::exception& ex) {
+
+			std::cerr << "Netlink is unavailable (" << ex.what() << "), falling back to /proc/net/dev" << std::endl;
+			this->source = NetSource::procfs;
+			netlink.reset();
+			interfaces.clear();
+			prev.clear();
+			has_prev.clear();
+			curr.clear();
+			seen.clear();
+		}
+	}
+
+	if (this->source == NetSource::procfs) {
+		open_procfs(snapshot);
+	}
+	else if (this->source == NetSource::sysfs) {
+		rebuild(list_sysfs_interfaces());
+	}
+}
+
+
+void NetStatsReader::open_procfs(ProcSnapshot& snapshot) {
+
+	proc_net_dev = &snapshot.file("/proc/net/dev");
+
+	std::vector<std::string> names;
+	std::string_view text = proc_net_dev->read(), line, name;
+	NetCounters counters;
+	while (proc_parse::next_line(text, line)) {
+		if (parse_line(line, name, counters)) {
+			names.emplace_back(name);
+		}
+	}
+	rebuild(names);
+}
+
+
+NetSource NetStatsReader::parse_source(const std::string& name) {
+
+	if (name == "netlink") return NetSource::netlink;
+	if (name == "procfs") return NetSource::procfs;
+	if (name == "sysfs") return NetSource::sysfs;
+	throw std::runtime_error("Unknown network source: " + name);
+}
+
+
+bool NetStatsReader::matches(const std::string& name) const {
+
+	for (const auto& pattern : patterns) {
+		if (fnmatch(pattern.c_str(), name.c_str(), 0) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool NetStatsReader::parse_line(std::string_view line, std::string_view& name, NetCounters& counters) {
+
+	using namespace proc_parse;
+
+	auto colon = line.find(':');
+	if (colon == std::string_view::npos) {
+		return false; // one of the two header lines
+	}
+
+	name = line.substr(0, colon);
+	skip_spaces(name);
+	line.remove_prefix(colon + 1);
+
+	counters.rx_bytes = next_u64(line);
+	counters.rx_packets = next_u64(line);
+	counters.rx_errors = next_u64(line);
+	counters.rx_drops = next_u64(line);
+	next_u64(line); // fifo
+	next_u64(line); // frame
+	next_u64(line); // compressed
+	next_u64(line); // multicast
+	counters.tx_bytes = next_u64(line);
+	counters.tx_packets = next_u64(line);
+	counters.tx_errors = next_u64(line);
+	counters.tx_drops = next_u64(line);
+
+	return true;
+}
+
+
+std::vector<std::string> NetStatsReader::list_sysfs_interfaces() const {
+
+	std::vector<std::string> names;
+
+	DIR* dir = opendir(SYSFS_NET);
+	if (!dir) {
+		throw std::runtime_error(std::string("Failed to open ") + SYSFS_NET);
+	}
+	while (dirent* entry = readdir(dir)) {
+		if (!is_hidden(entry->d_name)) {
+			names.emplace_back(entry->d_name);
+		}
+	}
+	closedir(dir);
+
+	return names;
+}
+
+
+bool NetStatsReader::sysfs_layout_changed() const {
+
+	DIR* dir = opendir(SYSFS_NET);
+	if (!dir) {
+		throw std::runtime_error(std::string("Failed to open ") + SYSFS_NET);
+	}
+
+	std::size_t slot = 0;
+	bool changed = false;
+	while (dirent* entry = readdir(dir)) {
+
+		if (is_hidden(entry->d_name)) continue;
+		if (slot >= interfaces.size() || interfaces[slot].name != entry->d_name) {
+			changed = true;
+			break;
+		}
+		++slot;
+	}
+	closedir(dir);
+
+	return changed || slot != interfaces.size();
+}
+
+
+void NetStatsReader::rebuild(const std::vector<std::string>& names) {
+
+	std::unordered_map<std::string, unsigned> old_indexes;
+	for (const auto& iface : interfaces) {
+		old_indexes.emplace(iface.name, iface.ifindex);
+	}
+
+	sysfs_batch.clear();
+	interfaces.clear();
+	std::vector<char> keep(has_prev.size(), 0);
+
+	for (const auto& name : names) {
+
+		Interface iface{name, if_nametoindex(name.c_str()), matches(name), {}};
+		if (iface.ifindex == 0) continue; // the interface has gone in the meantime
+
+		if (source == NetSource::sysfs && iface.selected) {
+
+			std::string dir = std::string(SYSFS_NET) + "/" + name + "/statistics/";
+			iface.first_slot = sysfs_batch.size();
+			for (const char* counter : SYSFS_COUNTERS) {
+				iface.counters.emplace_back(dir + counter, 32);
+				sysfs_batch.add(iface.counters.back());
+			}
+		}
+
+		if (iface.ifindex >= prev.size()) {
+			prev.resize(iface.ifindex + 1);
+			has_prev.resize(iface.ifindex + 1, 0);
+			keep.resize(iface.ifindex + 1, 0);
+		}
+
+		// an ifindex may be reused by a new interface, then its old counters mustn't be used for the delta
+		auto it = old_indexes.find(iface.name);
+		keep[iface.ifindex] = (it != old_indexes.end() && it->second == iface.ifindex);
+
+		interfaces.push_back(std::move(iface));
+	}
+
+	for (std::size_t i = 0; i != has_prev.size(); ++i) {
+		has_prev[i] = has_prev[i] && keep[i];
+	}
+}
+
+
+void NetStatsReader::push_rates(const Interface& iface, const NetCounters& curr, double seconds, std::vector<NetRates>& out) {
+
+	const NetCounters& last = has_prev[iface.ifindex] ? prev[iface.ifindex] : curr;
+
+	auto rate = [seconds](std::uint64_t now, std::uint64_t before) {
+		return (seconds > 0 && now >= before) ? (now - before) / seconds : 0.0;
+	};
+
+	NetRates rates;
+	rates.interface = iface.name;
+	rates.rx_bytes = rate(curr.rx_bytes, last.rx_bytes);
+	rates.rx_packets = rate(curr.rx_packets, last.rx_packets);
+	rates.rx_errors = rate(curr.rx_errors, last.rx_errors);
+	rates.rx_drops = rate(curr.rx_drops, last.rx_drops);
+	rates.tx_bytes = rate(curr.tx_bytes, last.tx_bytes);
+	rates.tx_packets = rate(curr.tx_packets, last.tx_packets);
+	rates.tx_errors = rate(curr.tx_errors, last.tx_errors);
+	rates.tx_drops = rate(curr.tx_drops, last.tx_drops);
+	out.push_back(std::move(rates));
+
+	prev[iface.ifindex] = curr;
+	has_prev[iface.ifindex] = 1;
+}
+
+
+void NetStatsReader::sample_procfs(double seconds, std::vector<NetRates>& out) {
+
+	auto text = proc_net_dev->read();
+
+	bool layout_changed = false;
+	{
+		std::string_view rest = text, line, name;
+		std::size_t slot = 0;
+		NetCounters counters;
+		while (proc_parse::next_line(rest, line)) {
+			if (!parse_line(line, name, counters)) continue;
+			if (slot >= interfaces.size() || interfaces[slot].name != name) {
+				layout_changed = true;
+				break;
+			}
+			++slot;
+		}
+		layout_changed = layout_changed || slot != interfaces.size();
+	}
+
+	if (layout_changed) {
+
+		std::vector<std::string> names;
+		std::string_view rest = text, line, name;
+		NetCounters counters;
+		while (proc_parse::next_line(rest, line)) {
+			if (parse_line(line, name, counters)) {
+				names.emplace_back(name);
+			}
+		}
+		rebuild(names);
+	}
+
+	std::string_view line, name;
+	std::size_t slot = 0;
+	while (proc_parse::next_line(text, line) && slot < interfaces.size()) {
+
+		NetCounters curr;
+		if (!parse_line(line, name, curr)) continue;
+
+		const auto& iface = interfaces[slot];
+		if (iface.name != name) continue; // vanished between the read and if_nametoindex
+		++slot;
+
+		if (iface.selected) {
+			push_rates(iface, curr, seconds, out);
+		}
+	}
+}
+
+
+void NetStatsReader::sample_sysfs(double seconds, std::vector<NetRates>& out) {
+
+	if (sysfs_layout_changed()) {
+		rebuild(list_sysfs_interfaces());
+	}
+
+	sysfs_batch.read_all();
+
+	for (auto& iface : interfaces) {
+
+		if (!iface.selected) continue;
+
+		NetCounters curr;
+		for (std::size_t i = 0; i != COUNTERS_COUNT; ++i) {
+			auto text = sysfs_batch.get(iface.first_slot + i);
+			counter_at(curr, i) = proc_parse::next_u64(text);
+		}
+		push_rates(iface, curr, seconds, out);
+	}
+}
+
+
+void NetStatsReader::refresh_netlink_names() {
+
+	// only names are needed here, the kernel is asked not to serialize the statistics
+	struct {
+		nlmsghdr header;
+		ifinfomsg body;
+		char ext_mask[RTA_SPACE(sizeof(std::uint32_t))];
+	} request{};
+
+	request.header.nlmsg_len = sizeof(request);
+	request.header.nlmsg_type = RTM_GETLINK;
+	request.body.ifi_family = AF_UNSPEC;
+
+	auto* attr = reinterpret_cast<rtattr*>(request.ext_mask);
+	attr->rta_type = IFLA_EXT_MASK;
+	attr->rta_len = RTA_LENGTH(sizeof(std::uint32_t));
+	std::uint32_t mask = RTEXT_FILTER_SKIP_STATS;
+	std::memcpy(RTA_DATA(attr), &mask, sizeof(mask));
+
+	netlink->dump(&request.header, [&](const nlmsghdr* nh) {
+
+		if (nh->nlmsg_type != RTM_NEWLINK) return;
+
+		auto* info = static_cast<const ifinfomsg*>(NLMSG_DATA(nh));
+		if (info->ifi_index <= 0) return;
+
+		int len = IFLA_PAYLOAD(nh);
+		for (auto* attr = IFLA_RTA(info); RTA_OK(attr, len); attr = RTA_NEXT(attr, len)) {
+
+			if (attr->rta_type != IFLA_IFNAME) continue;
+
+			auto ifindex = static_cast<unsigned>(info->ifi_index);
+			reserve_ifindex(ifindex);
+
+			auto& iface = interfaces[ifindex];
+			const char* name = static_cast<const char*>(RTA_DATA(attr));
+			if (iface.ifindex != ifindex || iface.name != name) {
+				iface.name = name;
+				iface.ifindex = ifindex;
+				iface.selected = matches(iface.name);
+				has_prev[ifindex] = 0;
+			}
+			break;
+		}
+	});
+}
+
+
+void NetStatsReader::reserve_ifindex(unsigned ifindex) {
+
+	if (ifindex >= interfaces.size()) {
+		interfaces.resize(ifindex + 1);
+		prev.resize(ifindex + 1);
+		has_prev.resize(ifindex + 1, 0);
+		curr.resize(ifindex + 1);
+		seen.resize(ifindex + 1, 0);
+	}
+}
+
+
+void NetStatsReader::sample_netlink(double seconds, std::vector<NetRates>& out) {
+
+	struct {
+		nlmsghdr header;
+		if_stats_msg body;
+	} request{};
+
+	request.header.nlmsg_len = sizeof(request);
+	request.header.nlmsg_type = RTM_GETSTATS;
+	request.body.family = AF_UNSPEC;
+	request.body.filter_mask = IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_64);
+
+	std::fill(seen.begin(), seen.end(), 0);
+	std::size_t count = 0;
+	bool names_stale = false;
+
+	netlink->dump(&request.header, [&](const nlmsghdr* nh) {
+
+		if (nh->nlmsg_type != RTM_NEWSTATS) return;
+
+		auto* info = static_cast<const if_stats_msg*>(NLMSG_DATA(nh));
+		if (info->ifindex == 0) return;
+
+		auto* attr = reinterpret_cast<const rtattr*>(reinterpret_cast<const char*>(info) + NLMSG_ALIGN(sizeof(*info)));
+		int len = static_cast<int>(nh->nlmsg_len) - NLMSG_LENGTH(NLMSG_ALIGN(sizeof(*info)));
+
+		for (; RTA_OK(attr, len); attr = RTA_NEXT(attr, len)) {
+
+			if (attr->rta_type != IFLA_STATS_LINK_64 || RTA_PAYLOAD(attr) < sizeof(rtnl_link_stats64)) continue;
+
+			rtnl_link_stats64 link;
+			std::memcpy(&link, RTA_DATA(attr), sizeof(link)); // attributes are only 4-byte aligned
+
+			auto ifindex = info->ifindex;
+			reserve_ifindex(ifindex);
+
+			// the same sums the kernel prints in /proc/net/dev, so all sources report equal values
+			auto& counters = curr[ifindex];
+			counters.rx_bytes = link.rx_bytes;
+			counters.rx_packets = link.rx_packets;
+			counters.rx_errors = link.rx_errors;
+			counters.rx_drops = link.rx_dropped + link.rx_missed_errors;
+			counters.tx_bytes = link.tx_bytes;
+			counters.tx_packets = link.tx_packets;
+			counters.tx_errors = link.tx_errors;
+			counters.tx_drops = link.tx_dropped;
+
+			seen[ifindex] = 1;
+			++count;
+			names_stale = names_stale || interfaces[ifindex].ifindex != ifindex;
+			break;
+		}
+	});
+
+	// names are only dumped again when an interface has appeared or disappeared
+	if (names_stale || count != netlink_count) {
+		refresh_netlink_names();
+		netlink_count = count;
+	}
+
+	for (unsigned ifindex = 0; ifindex != seen.size(); ++ifindex) {
+
+		const auto& iface = interfaces[ifindex];
+		if (seen[ifindex] && iface.ifindex == ifindex && iface.selected) {
+			push_rates(iface, curr[ifindex], seconds, out);
+		}
+	}
+}
+
+
+void NetStatsReader::sample(std::vector<NetRates>& out) {
+
+	out.clear();
+
+	auto now = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(now - prev_time).count();
+	prev_time = now;
+
+	switch (source) {
+		case NetSource::netlink: sample_netlink(seconds, out); break;
+		case NetSource::procfs: sample_procfs(seconds, out); break;
+		case NetSource::sysfs: sample_sysfs(seconds, out); break;
+	}
+}
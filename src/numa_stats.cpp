@@ -0,0 +1,211 @@
+#include "numa_stats.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+
+
+namespace {
+
+	// the small sysfs attributes are read once, there is no point in keeping their fds
+	std::string read_attribute(const std::filesystem::path& path) {
+
+		std::ifstream file(path);
+		std::string value;
+		std::getline(file, value);
+		return value;
+	}
+
+	// ids of the entries named "<prefix><N>" in a sysfs directory, sorted
+	std::vector<int> list_ids(const std::filesystem::path& dir, std::string_view prefix) {
+
+		std::vector<int> ids;
+		std::error_code ec;
+
+		for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+
+			auto name = entry.path().filename().string();
+			if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) continue;
+			if (!std::all_of(name.begin() + prefix.size(), name.end(), [](char c) { return c >= '0' && c <= '9'; })) continue;
+
+			ids.push_back(std::stoi(name.substr(prefix.size())));
+		}
+		std::sort(ids.begin(), ids.end());
+		return ids;
+	}
+
+	CpuGrouping make_grouping(const std::map<int, std::vector<int>>& members, const std::string& prefix) {
+
+		CpuGrouping grouping;
+		for (const auto& [id, cpus] : members) {
+
+			std::size_t begin = grouping.cpus.size();
+			grouping.cpus.insert(grouping.cpus.end(), cpus.begin(), cpus.end());
+			grouping.groups.push_back({prefix + std::to_string(id), begin, grouping.cpus.size()});
+		}
+		return grouping;
+	}
+
+}
+
+
+const CpuGrouping::Group* CpuGrouping::find(std::string_view name) const {
+
+	for (const auto& group : groups) {
+		if (group.name == name) return &group;
+	}
+	return nullptr;
+}
+
+
+std::vector<int> CpuTopology::parse_cpulist(std::string_view list) {
+
+	std::vector<int> cpus;
+	while (!list.empty() && list.front() >= '0' && list.front() <= '9') {
+
+		int first = static_cast<int>(proc_parse::next_u64(list));
+		int last = first;
+		if (!list.empty() && list.front() == '-') {
+			list.remove_prefix(1);
+			last = static_cast<int>(proc_parse::next_u64(list));
+		}
+
+		for (int cpu = first; cpu <= last; ++cpu) {
+			cpus.push_back(cpu);
+		}
+
+		if (!list.empty() && list.front() == ',') {
+			list.remove_prefix(1);
+		}
+	}
+	return cpus;
+}
+
+
+CpuTopology CpuTopology::read(const std::string& root) {
+
+	namespace fs = std::filesystem;
+
+	const fs::path cpu_dir = fs::path(root) / "cpu";
+	const fs::path node_dir = fs::path(root) / "node";
+
+	std::vector<int> online;
+	for (int cpu : list_ids(cpu_dir, "cpu")) {
+
+		// cpu0 usually can't be taken offline and has no "online" attribute
+		auto state = read_attribute(cpu_dir / ("cpu" + std::to_string(cpu)) / "online");
+		if (state != "0") {
+			online.push_back(cpu);
+		}
+	}
+
+	std::map<int, std::vector<int>> node_members;
+	for (int node : list_ids(node_dir, "node")) {
+
+		auto cpus = parse_cpulist(read_attribute(node_dir / ("node" + std::to_string(node)) / "cpulist"));
+		if (!cpus.empty()) {
+			node_members[node] = std::move(cpus); // memory-only nodes have no cpus to group
+		}
+	}
+	if (node_members.empty()) {
+		node_members[0] = online;
+	}
+
+	std::map<int, std::vector<int>> socket_members;
+	for (int cpu : online) {
+
+		auto package = read_attribute(cpu_dir / ("cpu" + std::to_string(cpu)) / "topology" / "physical_package_id");
+		socket_members[package.empty() ? 0 : std::stoi(package)].push_back(cpu);
+	}
+
+	CpuTopology topology;
+	topology.nodes = make_grouping(node_members, "node");
+	topology.sockets = make_grouping(socket_members, "socket");
+	return topology;
+}
+
+
+const CpuGrouping::Group* CpuTopology::find(std::string_view name, const CpuGrouping** grouping) const {
+
+	if (auto* group = nodes.find(name)) {
+		*grouping = &nodes;
+		return group;
+	}
+	if (auto* group = sockets.find(name)) {
+		*grouping = &sockets;
+		return group;
+	}
+	return nullptr;
+}
+
+
+NumaStatsReader::NumaStatsReader(std::vector<int> ids, const std::string& root)
+	: prev_time(std::chrono::steady_clock::now())
+{
+	if (ids.empty()) {
+
+		ids = list_ids(root, "node");
+		if (ids.empty()) {
+			throw std::runtime_error("No NUMA nodes found in " + root);
+		}
+	}
+
+	for (int id : ids) {
+
+		auto dir = root + "/node" + std::to_string(id);
+		nodes.push_back({id, ProcFile(dir + "/meminfo"), ProcFile(dir + "/numastat", 256), {}});
+	}
+}
+
+
+void NumaStatsReader::sample(std::vector<NumaNodeStats>& out) {
+
+	out.clear();
+
+	auto now = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(now - prev_time).count();
+	prev_time = now;
+
+	constexpr double KB_PER_GB = 1024.0 * 1024.0;
+
+	for (auto& node : nodes) {
+
+		NumaNodeStats stats{node.id, 0, 0, 0, 0, 0, 0, 0, 0};
+
+		// "Node 0 MemTotal:        4685560 kB", the three lines we need come first
+		auto text = node.meminfo.read();
+		std::string_view line;
+		for (int i = 0; i != 3 && proc_parse::next_line(text, line); ++i) {
+
+			proc_parse::next_token(line); // Node
+			proc_parse::next_token(line); // <id>
+			auto key = proc_parse::next_token(line);
+			double gb = proc_parse::next_u64(line) / KB_PER_GB;
+
+			if (key == "MemTotal:") stats.total = gb;
+			else if (key == "MemFree:") stats.free = gb;
+			else if (key == "MemUsed:") stats.used = gb;
+		}
+
+		// "numa_hit 10524163\nnuma_miss 0\n...", interleave_hit (the 4th line) isn't reported
+		std::uint64_t curr[5] = {};
+		text = node.numastat.read();
+		for (int i = 0, slot = 0; i != 6 && proc_parse::next_line(text, line); ++i) {
+
+			proc_parse::next_token(line);
+			auto value = proc_parse::next_u64(line);
+			if (i != 3) curr[slot++] = value;
+		}
+
+		double* rates[5] = { &stats.numa_hit, &stats.numa_miss, &stats.numa_foreign, &stats.local_node, &stats.other_node };
+		for (int i = 0; i != 5; ++i) {
+			*rates[i] = (has_prev && seconds > 0 && curr[i] >= node.prev[i]) ? (curr[i] - node.prev[i]) / seconds : 0.0;
+			node.prev[i] = curr[i];
+		}
+
+		out.push_back(stats);
+	}
+
+	has_prev = true;
+}
@@ -0,0 +1,238 @@
+#include "perf_stats.hpp"
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <stdexcept>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+namespace {
+
+	int perf_event_open(perf_event_attr& attr, int cpu, int group_fd) {
+
+		return static_cast<int>(::syscall(SYS_perf_event_open, &attr, -1, cpu, group_fd, PERF_FLAG_FD_CLOEXEC));
+	}
+
+	// errors meaning "this event doesn't exist here" rather than "you may not use it"
+	bool is_unsupported(int err) {
+		return err == ENOENT || err == EOPNOTSUPP || err == ENODEV || err == EINVAL;
+	}
+
+	// group indexes and event positions inside the groups
+	enum HardwareGroup { CORE_GROUP, BRANCH_GROUP };
+	enum CoreEvent { CYCLES, INSTRUCTIONS, CACHE_REFERENCES, CACHE_MISSES };
+	enum BranchEvent { BRANCHES, BRANCH_MISSES };
+	enum SoftwareEvent { TASK_CLOCK, CONTEXT_SWITCHES, CPU_MIGRATIONS, PAGE_FAULTS };
+
+}
+
+
+PerfGroup::PerfGroup(PerfGroup&& other) noexcept
+	: has_prev(other.has_prev)
+	, fds(other.fds)
+	, size(other.size)
+	, prev(other.prev)
+	, curr(other.curr)
+{
+	other.fds.fill(-1);
+	other.size = 0;
+}
+
+
+PerfGroup& PerfGroup::operator=(PerfGroup&& other) noexcept {
+
+	if (&other != this) {
+		close();
+		has_prev = other.has_prev;
+		fds = other.fds;
+		size = other.size;
+		prev = other.prev;
+		curr = other.curr;
+		other.fds.fill(-1);
+		other.size = 0;
+	}
+	return *this;
+}
+
+
+PerfGroup::~PerfGroup() {
+	close();
+}
+
+
+void PerfGroup::close() {
+
+	for (auto& fd : fds) {
+		if (fd >= 0) {
+			::close(fd);
+			fd = -1;
+		}
+	}
+	size = 0;
+}
+
+
+int PerfGroup::add(std::uint32_t type, std::uint64_t config, int cpu) {
+
+	if (size == MAX_EVENTS) {
+		throw std::logic_error("Too many events in a perf group");
+	}
+
+	perf_event_attr attr{};
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	int fd = perf_event_open(attr, cpu, size == 0 ? -1 : fds[0]);
+	if (fd < 0) {
+		return errno;
+	}
+
+	fds[size++] = fd;
+	return 0;
+}
+
+
+void PerfGroup::read() {
+
+	prev = curr;
+
+	auto bytes = static_cast<ssize_t>((3 + size) * sizeof(std::uint64_t));
+	if (::read(fds[0], curr.data(), bytes) != bytes) {
+		throw std::runtime_error(std::string("Failed to read a perf group: ") + std::strerror(errno));
+	}
+}
+
+
+std::uint64_t PerfGroup::delta(std::size_t event) const {
+	return curr[3 + event] - prev[3 + event];
+}
+
+
+PerfStatsReader::PerfStatsReader(const std::vector<int>& cpu_ids) {
+
+	long configured = ::sysconf(_SC_NPROCESSORS_CONF);
+	for (int id : cpu_ids) {
+		if (id < 0 || id >= configured) {
+			throw std::invalid_argument("cpu-id '" + std::to_string(id) + "' in configuration file is invalid");
+		}
+	}
+
+	for (int id : cpu_ids) {
+
+		CpuGroups cpu{id, {}};
+		if (is_hardware && !open_hardware(id, cpu.groups)) {
+
+			// no PMU (a VM or an unsupported cpu): every cpu switches to the software events
+			is_hardware = false;
+			for (auto& opened : cpus) {
+				opened.groups.clear();
+				open_software(opened.cpu, opened.groups);
+			}
+		}
+		if (!is_hardware) {
+			open_software(id, cpu.groups);
+		}
+		cpus.push_back(std::move(cpu));
+	}
+}
+
+
+bool PerfStatsReader::open_hardware(int cpu, std::vector<PerfGroup>& groups) {
+
+	// cycles and instructions must be in one group for IPC, references and misses - for the miss rate;
+	// branches get their own group so that the first one fits into the 4 programmable counters
+	const std::uint64_t events[2][4] = {
+		{ PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES },
+		{ PERF_COUNT_HW_BRANCH_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES }
+	};
+	const std::size_t sizes[2] = { 4, 2 };
+
+	groups.clear();
+	for (std::size_t g = 0; g != 2; ++g) {
+
+		PerfGroup group;
+		for (std::size_t e = 0; e != sizes[g]; ++e) {
+
+			int err = group.add(PERF_TYPE_HARDWARE, events[g][e], cpu);
+			if (err == 0) continue;
+
+			if (is_unsupported(err)) {
+				groups.clear();
+				return false;
+			}
+			throw std::runtime_error("perf_event_open failed on cpu " + std::to_string(cpu) + ": " + std::strerror(err)
+				+ " (see kernel.perf_event_paranoid)");
+		}
+		groups.push_back(std::move(group));
+	}
+
+	return true;
+}
+
+
+void PerfStatsReader::open_software(int cpu, std::vector<PerfGroup>& groups) {
+
+	const std::uint64_t events[] = {
+		PERF_COUNT_SW_TASK_CLOCK, PERF_COUNT_SW_CONTEXT_SWITCHES, PERF_COUNT_SW_CPU_MIGRATIONS, PERF_COUNT_SW_PAGE_FAULTS
+	};
+
+	PerfGroup group;
+	for (auto event : events) {
+
+		int err = group.add(PERF_TYPE_SOFTWARE, event, cpu);
+		if (err != 0) {
+			throw std::runtime_error("perf_event_open failed on cpu " + std::to_string(cpu) + ": " + std::strerror(err)
+				+ " (see kernel.perf_event_paranoid)");
+		}
+	}
+	groups.push_back(std::move(group));
+}
+
+
+void PerfStatsReader::sample(std::vector<PerfRates>& out) {
+
+	out.clear();
+
+	for (auto& cpu : cpus) {
+
+		PerfRates rates{cpu.cpu, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+		for (auto& group : cpu.groups) {
+			group.read();
+		}
+
+		auto ratio = [](std::uint64_t part, std::uint64_t whole, double scale) {
+			return whole > 0 ? static_cast<double>(part) / whole * scale : 0.0;
+		};
+
+		// members of a group are multiplexed together, so ratios inside a group need no scaling
+		if (is_hardware && cpu.groups[CORE_GROUP].has_prev) {
+
+			const auto& core = cpu.groups[CORE_GROUP];
+			const auto& branch = cpu.groups[BRANCH_GROUP];
+
+			rates.ipc = ratio(core.delta(INSTRUCTIONS), core.delta(CYCLES), 1.0);
+			rates.cache_miss_rate = ratio(core.delta(CACHE_MISSES), core.delta(CACHE_REFERENCES), 100.0);
+			rates.branch_miss_rate = ratio(branch.delta(BRANCH_MISSES), branch.delta(BRANCHES), 100.0);
+		}
+		else if (!is_hardware && cpu.groups[0].has_prev) {
+
+			// task-clock of a cpu-wide event ticks in nanoseconds of the interval, so it is the time base of the rates
+			const auto& software = cpu.groups[0];
+
+			rates.context_switches = ratio(software.delta(CONTEXT_SWITCHES), software.delta(TASK_CLOCK), 1e9);
+			rates.cpu_migrations = ratio(software.delta(CPU_MIGRATIONS), software.delta(TASK_CLOCK), 1e9);
+			rates.page_faults = ratio(software.delta(PAGE_FAULTS), software.delta(TASK_CLOCK), 1e9);
+		}
+
+		for (auto& group : cpu.groups) {
+			group.has_prev = true;
+		}
+
+		out.push_back(rates);
+	}
+}
@@ -0,0 +1,118 @@
+#include "proc_snapshot.hpp"
+#include <stdexcept>
+
+
+SharedProcFile::SharedProcFile(const std::string& path, std::size_t initial_capacity, const std::atomic<std::uint64_t>& tick)
+	: file(path, initial_capacity)
+	, tick(tick)
+{}
+
+
+std::string_view SharedProcFile::read() {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto current = tick.load(std::memory_order_acquire);
+	if (read_tick != current) {
+		text = file.read();
+		read_tick = current;
+	}
+	return text;
+}
+
+
+SharedProcFile& ProcSnapshot::file(const std::string& path, std::size_t initial_capacity) {
+
+	std::lock_guard<std::mutex> lock(files_mutex);
+
+	auto& entry = files[path];
+	if (!entry) {
+		entry = std::make_unique<SharedProcFile>(path, initial_capacity, tick);
+	}
+	return *entry;
+}
+
+
+template<typename T, typename Parse>
+const T& ProcSnapshot::parsed(SharedProcFile& source, std::uint64_t& parsed_tick, T& value, Parse&& parse) {
+
+	auto text = source.read();
+
+	std::lock_guard<std::mutex> lock(parse_mutex);
+
+	auto current = tick.load(std::memory_order_acquire);
+	if (parsed_tick != current) {
+		parse(text, value);
+		parsed_tick = current;
+	}
+	return value;
+}
+
+
+const std::vector<CpuStats>& ProcSnapshot::cpu_times() {
+
+	return parsed(file(root + "/stat"), cpu_times_tick, times, [](std::string_view text, std::vector<CpuStats>& times) {
+
+		// the entries stay where they are, a tick doesn't allocate unless a cpu with a higher id comes online
+		for (auto& stats : times) {
+			stats.present = false;
+		}
+
+		bool any = false;
+		proc_parse::for_each_cpu_line(text, [&](int cpu, std::string_view fields) {
+
+			using proc_parse::next_u64;
+
+			if (static_cast<std::size_t>(cpu) >= times.size()) {
+				times.resize(cpu + 1);
+			}
+
+			auto& stats = times[cpu];
+			stats.user = next_u64(fields);
+			stats.nice = next_u64(fields);
+			stats.system = next_u64(fields);
+			stats.idle = next_u64(fields);
+			stats.iowait = next_u64(fields);
+			stats.irq = next_u64(fields);
+			stats.softirq = next_u64(fields);
+			stats.steal = next_u64(fields);
+			stats.present = true;
+			any = true;
+		});
+
+		if (!any) {
+			throw std::runtime_error("Failed to read cpu statistics from /proc/stat");
+		}
+	});
+}
+
+
+const MemInfo& ProcSnapshot::mem_info() {
+
+	return parsed(file(root + "/meminfo"), mem_info_tick, meminfo, [](std::string_view text, MemInfo& info) {
+
+		info = MemInfo{};
+
+		// the three fields are the first lines of the file
+		std::string_view line;
+		for (int i = 0; i != 3 && proc_parse::next_line(text, line); ++i) {
+
+			auto key = proc_parse::next_token(line);
+			auto value = proc_parse::next_u64(line);
+
+			if (key == "MemTotal:") {
+				info.total_kb = value;
+			}
+			else if (key == "MemFree:") {
+				info.free_kb = value;
+			}
+			else if (key == "MemAvailable:") {
+				info.available_kb = value;
+			}
+		}
+
+		if (info.total_kb == 0 || info.available_kb == 0) {
+			throw std::runtime_error("Failed to read required fields from /proc/meminfo");
+		}
+	});
+}
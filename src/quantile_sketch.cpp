@@ -0,0 +1,153 @@
+#include "quantile_sketch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+
+QuantileSketch::QuantileSketch(double accuracy)
+	: gamma((1 + accuracy) / (1 - accuracy))
+	, log_gamma(std::log(gamma))
+	, min_value(1e-9)
+{}
+
+
+int QuantileSketch::key(double value) const {
+	return static_cast<int>(std::ceil(std::log(value) / log_gamma));
+}
+
+
+double QuantileSketch::value_of(int key) const {
+	return 2 * std::exp(key * log_gamma) / (gamma + 1);
+}
+
+
+void QuantileSketch::Store::add(int key, std::uint64_t n) {
+
+	if (counts.empty()) {
+		counts.push_back(0); // the capacity left from the previous window is reused
+		offset = key;
+	}
+	else if (key < offset) {
+
+		// a key below the lowest one widens the store downwards, unless it is full: then it joins the lowest bucket
+		std::size_t grow = std::min<std::size_t>(offset - key, MAX_BINS - counts.size());
+		counts.insert(counts.begin(), grow, 0);
+		offset -= static_cast<int>(grow);
+		key = std::max(key, offset);
+	}
+	else if (key >= offset + static_cast<int>(counts.size())) {
+
+		std::size_t needed = static_cast<std::size_t>(key - offset) + 1;
+		if (needed > MAX_BINS) {
+
+			// the window slides up, the buckets that fall out of it are collapsed into its new lowest bucket
+			std::size_t shift = needed - MAX_BINS;
+			if (shift >= counts.size()) {
+
+				std::uint64_t sum = std::accumulate(counts.begin(), counts.end(), std::uint64_t{0});
+				counts.assign(1, static_cast<std::uint32_t>(sum));
+			}
+			else {
+
+				std::uint64_t sum = std::accumulate(counts.begin(), counts.begin() + shift, std::uint64_t{0});
+				counts[shift] += static_cast<std::uint32_t>(sum);
+				counts.erase(counts.begin(), counts.begin() + shift);
+			}
+			offset = key - static_cast<int>(MAX_BINS) + 1;
+			needed = MAX_BINS;
+		}
+		counts.resize(needed, 0);
+	}
+
+	counts[key - offset] += static_cast<std::uint32_t>(n);
+}
+
+
+void QuantileSketch::add(double value) {
+
+	// a missing sample, it would fail both range tests below and be counted as a zero
+	if (std::isnan(value)) {
+		return;
+	}
+
+	if (value >= min_value) {
+		positive.add(key(value), 1);
+	}
+	else if (value <= -min_value) {
+		negative.add(key(-value), 1);
+	}
+	else {
+		++zeros;
+	}
+
+	max_value = (total == 0) ? value : std::max(max_value, value);
+	++total;
+}
+
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+
+	if (other.total == 0) {
+		return;
+	}
+
+	for (std::size_t i = 0; i != other.positive.counts.size(); ++i) {
+		if (other.positive.counts[i]) positive.add(other.positive.offset + static_cast<int>(i), other.positive.counts[i]);
+	}
+	for (std::size_t i = 0; i != other.negative.counts.size(); ++i) {
+		if (other.negative.counts[i]) negative.add(other.negative.offset + static_cast<int>(i), other.negative.counts[i]);
+	}
+	zeros += other.zeros;
+
+	max_value = (total == 0) ? other.max_value : std::max(max_value, other.max_value);
+	total += other.total;
+}
+
+
+double QuantileSketch::quantile(double q) const {
+
+	if (total == 0) {
+		return 0;
+	}
+	if (q >= 1) {
+		return max_value;
+	}
+
+	// the value of rank q * (n - 1) in the sorted order: the negative values from the largest magnitude,
+	// then the zeros, then the positive values
+	auto rank = static_cast<std::uint64_t>(std::max(q, 0.0) * (total - 1));
+	std::uint64_t seen = 0;
+
+	for (std::size_t i = negative.counts.size(); i-- != 0; ) {
+
+		seen += negative.counts[i];
+		if (seen > rank) {
+			return std::min(-value_of(negative.offset + static_cast<int>(i)), max_value);
+		}
+	}
+
+	seen += zeros;
+	if (seen > rank) {
+		return std::min(0.0, max_value);
+	}
+
+	for (std::size_t i = 0; i != positive.counts.size(); ++i) {
+
+		seen += positive.counts[i];
+		if (seen > rank) {
+			return std::min(value_of(positive.offset + static_cast<int>(i)), max_value);
+		}
+	}
+
+	return max_value;
+}
+
+
+void QuantileSketch::clear() {
+
+	positive.clear();
+	negative.clear();
+	zeros = 0;
+	total = 0;
+	max_value = 0;
+}
@@ -0,0 +1,104 @@
+#include "sched_stats.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+
+SchedStatsReader::SchedStatsReader(const std::vector<int>& cpus, const std::vector<int>& pids, ProcSnapshot& snapshot)
+	: cpus(cpus)
+	, prev_time(std::chrono::steady_clock::now())
+{
+	if (!cpus.empty()) {
+
+		try {
+			schedstat = &snapshot.file("/proc/schedstat");
+		}
+		catch (const std::exception& ex) {
+			throw std::runtime_error(std::string(ex.what()) + " (is the kernel built with CONFIG_SCHEDSTATS?)");
+		}
+
+		int max_cpu = -1;
+		proc_parse::for_each_cpu_line(schedstat->read(), [&](int cpu, std::string_view) {
+			max_cpu = std::max(max_cpu, cpu);
+		});
+
+		for (int id : cpus) {
+			if (id < 0 || id > max_cpu) {
+				throw std::invalid_argument("cpu-id '" + std::to_string(id) + "' in configuration file is invalid");
+			}
+		}
+		cpu_prev.assign(max_cpu + 1, Counters{0, 0, false});
+	}
+
+	for (int pid : pids) {
+		tasks.push_back({pid, ProcFile("/proc/" + std::to_string(pid) + "/schedstat", 64), Counters{0, 0, false}});
+	}
+}
+
+
+void SchedStatsReader::push(bool is_pid, int id, std::uint64_t wait_ns, std::uint64_t timeslices
+	, Counters& prev, double seconds, std::vector<SchedLatency>& out)
+{
+	SchedLatency latency{is_pid, id, 0.0, 0.0};
+
+	if (prev.has_prev && wait_ns >= prev.wait_ns) {
+
+		auto waited = wait_ns - prev.wait_ns;
+		auto slices = timeslices - prev.timeslices;
+
+		latency.delay = (seconds > 0) ? waited / 1e6 / seconds : 0.0;
+		latency.avg_wait = (slices > 0) ? static_cast<double>(waited) / slices / 1e3 : 0.0;
+	}
+	out.push_back(latency);
+
+	prev = Counters{wait_ns, timeslices, true};
+}
+
+
+void SchedStatsReader::sample(std::vector<SchedLatency>& out) {
+
+	out.clear();
+
+	auto now = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(now - prev_time).count();
+	prev_time = now;
+
+	if (!cpus.empty()) {
+
+		// "cpuN <6 legacy fields> <running ns> <waiting ns> <timeslices>", the domain lines are skipped
+		proc_parse::for_each_cpu_line(schedstat->read(), [&](int cpu, std::string_view fields) {
+
+			if (std::find(cpus.begin(), cpus.end(), cpu) == cpus.end()) return;
+			if (cpu >= static_cast<int>(cpu_prev.size())) return; // a hotplugged cpu that wasn't configured
+
+			for (int i = 0; i != 7; ++i) {
+				proc_parse::next_u64(fields);
+			}
+			auto wait_ns = proc_parse::next_u64(fields);
+			auto timeslices = proc_parse::next_u64(fields);
+
+			push(false, cpu, wait_ns, timeslices, cpu_prev[cpu], seconds, out);
+		});
+	}
+
+	for (auto& task : tasks) {
+
+		if (!task.file.is_open()) continue;
+
+		std::string_view fields;
+		try {
+			fields = task.file.read();
+		}
+		catch (const std::exception&) {
+			task.file.close(); // the process has exited, the fd of a dead task won't come back to life
+			continue;
+		}
+
+		// "<running ns> <waiting ns> <timeslices>"
+		proc_parse::next_u64(fields);
+		auto wait_ns = proc_parse::next_u64(fields);
+		auto timeslices = proc_parse::next_u64(fields);
+
+		push(true, task.pid, wait_ns, timeslices, task.prev, seconds, out);
+	}
+}
@@ -0,0 +1,58 @@
+#include "self_stats.hpp"
+
+
+namespace {
+
+	std::atomic<std::uint64_t> next_id{ 1 };
+
+}
+
+
+SelfStats::SelfStats()
+	: id(next_id.fetch_add(1, std::memory_order_relaxed))
+{}
+
+
+std::size_t SelfStats::add_step(const std::string& name, bool filters) {
+
+	names.push_back(name);
+	filtering.push_back(filters);
+	counters.emplace_back();
+	return names.size() - 1;
+}
+
+
+SelfStats::Thread& SelfStats::local() {
+
+	// a thread records for one SelfStats at a time, so the cache is a single pointer per thread; the owner is
+	// told by its id rather than its address, as a reload replaces the stats and the new ones may reuse it
+	thread_local std::uint64_t owner = 0;
+	thread_local Thread* thread = nullptr;
+
+	if (owner != id) {
+
+		std::lock_guard<std::mutex> lock(threads_mutex);
+		threads.push_back(std::make_unique<Thread>(names.size()));
+		thread = threads.back().get();
+		owner = id;
+	}
+	return *thread;
+}
+
+
+void SelfStats::record(std::size_t step, std::chrono::steady_clock::duration elapsed) {
+
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+	local().histograms[step].record(us > 0 ? static_cast<std::uint64_t>(us) : 0);
+}
+
+
+void SelfStats::merge(std::size_t step, HdrHistogram& out) const {
+
+	out.reset();
+
+	std::lock_guard<std::mutex> lock(threads_mutex);
+	for (const auto& thread : threads) {
+		out.add(thread->histograms[step]);
+	}
+}
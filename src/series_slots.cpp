@@ -0,0 +1,145 @@
+#include "series_slots.hpp"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+
+SeriesSlots::SeriesSlots(const char* owner)
+	: owner(owner)
+{}
+
+
+std::size_t SeriesSlots::add(const std::string& name, bool batch) {
+
+	auto [it, inserted] = slot_of.emplace(name, names.size());
+	if (!inserted) {
+		from_batch[it->second] = from_batch[it->second] && batch;
+		return it->second;
+	}
+
+	names.push_back(name);
+	from_batch.push_back(batch);
+	values.push_back(std::numeric_limits<double>::quiet_NaN());
+	bindings.clear();
+	return names.size() - 1;
+}
+
+
+bool SeriesSlots::matches(Binding& binding, const std::vector<std::unique_ptr<Metric>>& metrics) const {
+
+	if (metrics.size() != binding.size) {
+		return false;
+	}
+
+	auto current_generation = generation.load(std::memory_order_relaxed);
+	bool verify = binding.verified != current_generation;
+	bool stale = false;
+
+	for (std::size_t slot = 0; slot != binding.positions.size(); ++slot) {
+
+		auto position = binding.positions[slot];
+		if (position == SIZE_MAX) {
+			stale = stale || (verify && from_batch[slot]); // a series that was missing may be there now
+			continue;
+		}
+
+		const auto& metric = *metrics[position];
+		if (typeid(metric) != *binding.types[slot]) {
+			return false;
+		}
+		stale = stale || (verify && metric.series() != names[slot]);
+	}
+
+	if (stale) {
+
+		// the layout this binding was made for is gone, it's the first to be replaced by the new one
+		binding.size = SIZE_MAX;
+		binding.used = 0;
+		return false;
+	}
+	binding.verified = current_generation;
+	return true;
+}
+
+
+SeriesSlots::Binding& SeriesSlots::bind(const std::vector<std::unique_ptr<Metric>>& metrics) {
+
+	std::unordered_map<std::string, std::size_t> index;
+	index.reserve(metrics.size());
+	for (std::size_t i = 0; i != metrics.size(); ++i) {
+		index.emplace(metrics[i]->series(), i);
+	}
+
+	// a new layout takes the place of the one unused for the longest time
+	if (bindings.size() < MAX_BINDINGS) {
+		bindings.emplace_back();
+		current = bindings.size() - 1;
+	}
+	else {
+		current = static_cast<std::size_t>(std::min_element(bindings.begin(), bindings.end(), [](const Binding& a, const Binding& b) {
+			return a.used < b.used;
+		}) - bindings.begin());
+	}
+
+	auto& binding = bindings[current];
+	binding.size = metrics.size();
+	binding.verified = generation.load(std::memory_order_relaxed);
+	binding.positions.assign(names.size(), SIZE_MAX);
+	binding.types.assign(names.size(), nullptr);
+
+	std::vector<std::string> missing;
+	for (std::size_t slot = 0; slot != names.size(); ++slot) {
+
+		if (!from_batch[slot]) continue;
+
+		auto it = index.find(names[slot]);
+		if (it == index.end()) {
+			missing.push_back(names[slot]);
+			continue;
+		}
+
+		binding.positions[slot] = it->second;
+		binding.types[slot] = &typeid(*metrics[it->second]);
+	}
+
+	// only for the first layout, where every collector is due; a range over all the possible cpus is expected to
+	// miss some of them
+	if (!missing.empty() && ticks == 0) {
+
+		std::cerr << owner << ": " << missing.size() << " of the referenced series are not collected, e.g. '"
+			<< missing.front() << "'; they are treated as missing" << std::endl;
+	}
+
+	return binding;
+}
+
+
+void SeriesSlots::read(const std::vector<std::unique_ptr<Metric>>& metrics) {
+
+	Binding* binding = nullptr;
+	if (current < bindings.size() && matches(bindings[current], metrics)) {
+		binding = &bindings[current];
+	}
+	for (std::size_t i = 0; !binding && i != bindings.size(); ++i) {
+		if (i != current && matches(bindings[i], metrics)) {
+			current = i;
+			binding = &bindings[i];
+		}
+	}
+	if (!binding) {
+		binding = &bind(metrics);
+	}
+
+	binding->used = ticks++;
+
+	for (std::size_t slot = 0; slot != values.size(); ++slot) {
+
+		auto position = binding->positions[slot];
+		if (position != SIZE_MAX) {
+			values[slot] = metrics[position]->get_value();
+		}
+		else if (from_batch[slot]) {
+			values[slot] = std::numeric_limits<double>::quiet_NaN();
+		}
+	}
+}
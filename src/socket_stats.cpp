@@ -0,0 +1,218 @@
+#include "socket_stats.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstring>
+#include <linux/inet_diag.h>
+#include <linux/sock_diag.h>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+
+
+namespace {
+
+	const char* const SNMP_FILES[] = { "/proc/net/snmp", "/proc/net/netstat" };
+
+}
+
+
+const char* SocketSample::state_name(std::size_t state) {
+
+	static const char* const names[STATES_COUNT] = {
+		"UNKNOWN", "ESTABLISHED", "SYN_SENT", "SYN_RECV", "FIN_WAIT1", "FIN_WAIT2", "TIME_WAIT",
+		"CLOSE", "CLOSE_WAIT", "LAST_ACK", "LISTEN", "CLOSING", "NEW_SYN_RECV"
+	};
+	return state < STATES_COUNT ? names[state] : "UNKNOWN";
+}
+
+
+SocketStatsReader::SocketStatsReader(const std::vector<std::string>& counters, ProcSnapshot& snapshot)
+	: sock_diag(NETLINK_SOCK_DIAG)
+	, prev_time(std::chrono::steady_clock::now())
+{
+	for (const auto& counter : counters) {
+		resolve_counter(counter, snapshot);
+	}
+
+	// a tick walks every file once, so the slots are kept in the order they appear in the files
+	std::sort(counter_slots.begin(), counter_slots.end(), [](const CounterSlot& a, const CounterSlot& b) {
+		return std::tie(a.file, a.line, a.column) < std::tie(b.file, b.line, b.column);
+	});
+	prev_counters.resize(counter_slots.size());
+}
+
+
+void SocketStatsReader::resolve_counter(const std::string& counter, ProcSnapshot& snapshot) {
+
+	for (const auto& slot : counter_slots) {
+		if (slot.name == counter) return;
+	}
+
+	auto colon = counter.find(':');
+	if (colon == std::string::npos) {
+		throw std::runtime_error("Socket counter must look like 'Section:Field': " + counter);
+	}
+	std::string_view section(counter.data(), colon + 1); // "Tcp:" as it is printed in the files
+	std::string_view field(counter.data() + colon + 1, counter.size() - colon - 1);
+
+	for (std::size_t file = 0; file != 2; ++file) {
+
+		if (!snmp_files[file]) {
+			snmp_files[file] = &snapshot.file(SNMP_FILES[file]);
+		}
+
+		std::string_view text = snmp_files[file]->read(), line;
+		std::size_t line_no = 0;
+		while (proc_parse::next_line(text, line)) {
+
+			// the header line of a section is followed by the line with its values
+			auto rest = line;
+			if (proc_parse::next_token(rest) == section) {
+
+				std::size_t column = 0;
+				for (auto name = proc_parse::next_token(rest); !name.empty(); name = proc_parse::next_token(rest), ++column) {
+
+					if (name == field) {
+						counter_slots.push_back({file, line_no + 1, column, counter});
+						return;
+					}
+				}
+				// both lines start with the section name, skip the values line
+				proc_parse::next_line(text, line);
+				++line_no;
+			}
+			++line_no;
+		}
+	}
+
+	throw std::runtime_error("Unknown socket counter: " + counter);
+}
+
+
+void SocketStatsReader::dump_family(int family, SocketSample& out) {
+
+	struct {
+		nlmsghdr header;
+		inet_diag_req_v2 body;
+	} request{};
+
+	request.header.nlmsg_len = sizeof(request);
+	request.header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+	request.body.sdiag_family = static_cast<std::uint8_t>(family);
+	request.body.sdiag_protocol = IPPROTO_TCP;
+	request.body.idiag_states = ~0u; // no extensions are requested, so every message stays minimal
+
+	sock_diag.dump(&request.header, [&](const nlmsghdr* nh) {
+
+		if (nh->nlmsg_type != SOCK_DIAG_BY_FAMILY) return;
+
+		auto* msg = static_cast<const inet_diag_msg*>(NLMSG_DATA(nh));
+		if (msg->idiag_state < SocketSample::STATES_COUNT) {
+			++out.states[msg->idiag_state];
+		}
+
+		if (msg->idiag_state != 10) return; // TCP_LISTEN
+
+		// for a listening socket rqueue is the current accept queue and wqueue is the backlog
+		Listener listener{};
+		listener.family = family;
+		std::memcpy(listener.address, msg->id.idiag_src, family == AF_INET ? 4 : 16);
+		listener.port = ntohs(msg->id.idiag_sport);
+
+		// the ports are mostly distinct, so a chain holds a single listener unless it binds several addresses
+		auto key = static_cast<std::uint32_t>(family) << 16 | listener.port;
+		auto head = listener_index.find(key);
+		std::size_t at = head == listener_index.end() ? SIZE_MAX : head->second;
+		while (at != SIZE_MAX && std::memcmp(listeners[at].address, listener.address, sizeof(listener.address)) != 0) {
+			at = listeners[at].next;
+		}
+
+		if (at == SIZE_MAX) {
+			at = listeners.size();
+			listener.next = head == listener_index.end() ? SIZE_MAX : head->second;
+			listener_index[key] = at;
+			listeners.push_back(listener);
+		}
+		listeners[at].accept_queue += msg->idiag_rqueue;
+		listeners[at].backlog += msg->idiag_wqueue;
+	});
+}
+
+
+std::string SocketStatsReader::format_address(const Listener& listener) {
+
+	char buffer[INET6_ADDRSTRLEN];
+	inet_ntop(listener.family, listener.address, buffer, sizeof(buffer));
+
+	if (listener.family == AF_INET6) {
+		return "[" + std::string(buffer) + "]:" + std::to_string(listener.port);
+	}
+	return std::string(buffer) + ":" + std::to_string(listener.port);
+}
+
+
+void SocketStatsReader::sample(SocketSample& out) {
+
+	out.states.fill(0);
+	out.listeners.clear();
+	out.counters.clear();
+	listeners.clear();
+	listener_index.clear();
+
+	dump_family(AF_INET, out);
+	dump_family(AF_INET6, out);
+
+	for (const auto& listener : listeners) {
+		out.listeners.push_back({format_address(listener)
+			, static_cast<double>(listener.accept_queue)
+			, static_cast<double>(listener.backlog)});
+	}
+
+	if (counter_slots.empty()) return;
+
+	auto now = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(now - prev_time).count();
+	prev_time = now;
+
+	std::size_t slot = 0;
+	for (std::size_t file = 0; file != 2 && slot != counter_slots.size(); ++file) {
+
+		if (counter_slots[slot].file != file) continue;
+
+		std::string_view text = snmp_files[file]->read(), line;
+		std::size_t line_no = 0;
+
+		while (slot != counter_slots.size() && counter_slots[slot].file == file && proc_parse::next_line(text, line)) {
+
+			if (line_no++ != counter_slots[slot].line) continue;
+
+			proc_parse::next_token(line); // section name
+			std::size_t column = 0;
+
+			while (slot != counter_slots.size() && counter_slots[slot].file == file && counter_slots[slot].line == line_no - 1) {
+
+				const auto& counter = counter_slots[slot];
+				for (; column < counter.column; ++column) {
+					proc_parse::next_token(line);
+				}
+
+				// a few fields (e.g. Tcp:MaxConn) are signed and may be -1
+				proc_parse::skip_spaces(line);
+				bool negative = !line.empty() && line[0] == '-';
+				if (negative) line.remove_prefix(1);
+				auto value = proc_parse::next_u64(line);
+				++column;
+
+				double rate = (has_prev && seconds > 0 && !negative && value >= prev_counters[slot])
+					? (value - prev_counters[slot]) / seconds : 0.0;
+				out.counters.push_back({counter.name, rate});
+
+				prev_counters[slot] = negative ? 0 : value;
+				++slot;
+			}
+		}
+	}
+
+	has_prev = true;
+}
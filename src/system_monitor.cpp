@@ -1,7 +1,11 @@
 #include "system_monitor.hpp"
 #include "config.hpp"
 #include "metrics.hpp"
+#include "series_slots.hpp"
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <future>
 #include <iterator>
 #include <stdexcept>
 #include <string>
@@ -11,208 +15,442 @@
 #include <iostream>
 
 
-SystemMonitor::SystemMonitor(const Config& config)
+namespace {
+
+	// "2.5s", "30s"
+	std::string resolution_string(std::chrono::milliseconds interval) {
+
+		std::ostringstream out;
+		out << interval.count() / 1000.0 << "s";
+		return out.str();
+	}
+
+	// the "derived" entries of the "metrics" array in their order; `data` is null before the first config
+	json derived_entries(const json& data) {
+
+		json entries = json::array();
+		if (data.contains("metrics")) {
+			for (const auto& metric : data["metrics"]) {
+				if (metric["type"] == "derived") {
+					entries.push_back(metric);
+				}
+			}
+		}
+		return entries;
+	}
+
+	// a top-level section, null if it's missing
+	json section(const json& data, const char* key) {
+		return data.contains(key) ? data[key] : json();
+	}
+
+	json setting(const json& data, const char* key) {
+		return data.contains("settings") ? section(data["settings"], key) : json();
+	}
+
+	// the path of the "log" output, empty if there's none
+	std::string log_output_path(const std::vector<json>& outputs) {
+
+		for (const auto& output : outputs) {
+			if (output["type"] == "log") {
+				return output["path"].get<std::string>();
+			}
+		}
+		return "";
+	}
+
+	// a thread per collector (up to the cores) and the collectors' own tasks, which wait in the pool for a worker;
+	// one at least, as hardware_concurrency() may be 0
+	std::size_t pool_size(const std::vector<std::unique_ptr<Collector>>& collectors) {
+
+		std::size_t size = std::min(collectors.size(), static_cast<std::size_t>(std::thread::hardware_concurrency()));
+		for (const auto& collector : collectors) {
+			size += collector->own_workers();
+		}
+		return std::max<std::size_t>(size, 1);
+	}
+
+}
+
+
+SystemMonitor::SystemMonitor(Config& config)
     : period(config.get_period())
-    , metrics_config(config.get_metrics())
-    , outputs(config.get_outputs())
-    , pool(std::min(metrics_config.size(), static_cast<std::size_t>(std::thread::hardware_concurrency())))
+    , config_path(config.get_path())
+    , watcher(config_path)
+    , pool(pool_size(config.get_collectors()))
 {
-	config.setup_logging(log_file);
+	apply(config);
 }
 
-SystemMonitor::~SystemMonitor() {
 
-	if (log_file.is_open()) {
-		
-		log_file.close(); //not really necessary, as file closes automatically in a ~std::ifstream() 
+
+void SystemMonitor::apply(Config& config) {
+
+	const auto& data = config.get_data();
+	bool first = applied.is_null();
+
+	auto next_period = config.get_period();
+	const auto& burst_options = config.get_burst();
+	// with a burst capture every collector is sampled at the capture's faster rate, see run()
+	auto next_collect_period = burst_options ? burst_options->rate : next_period;
+
+	// an unchanged entry keeps its running collector; the "self" ones are always rebuilt, as they point into
+	// the SelfStats that the new plan replaces
+	auto fresh = config.take_collectors();
+	const auto& entries = config.get_collector_configs();
+	std::vector<std::size_t> carried(entries.size(), SIZE_MAX); // the running collector kept for the entry
+	std::vector<bool> taken(collectors.size(), false);
+	for (std::size_t i = 0; i != entries.size(); ++i) {
+
+		if (fresh[i]->type == "self") continue;
+		for (std::size_t j = 0; j != collectors.size(); ++j) {
+
+			if (!taken[j] && collector_configs[j] == entries[i]) {
+				carried[i] = j;
+				taken[j] = true;
+				break;
+			}
+		}
 	}
-}
 
-void SystemMonitor::run() {
-	
-	std::cout << "Starting system monitor with period " << period << "s" << std::endl;
+	// every collector and output is timed, the steps are named after the config entries: collect.cpu.0, output.log.1
+	auto next_self = std::make_unique<SelfStats>();
+	auto next_collect_step = next_self->add_step("collect");
+	std::vector<std::size_t> next_collector_steps;
+	for (std::size_t i = 0; i != fresh.size(); ++i) {
+		next_collector_steps.push_back(next_self->add_step("collect." + fresh[i]->type + "." + std::to_string(i)));
+	}
+	std::size_t next_derived_step = 0;
+	if (!derived_entries(data).empty()) {
+		next_derived_step = next_self->add_step("derived");
+	}
+	std::size_t next_alerts_step = 0;
+	if (data.contains("alerts") && !data["alerts"].empty()) {
+		next_alerts_step = next_self->add_step("alerts");
+	}
+	std::size_t next_anomaly_step = 0;
+	if (config.get_anomaly()) {
+		next_anomaly_step = next_self->add_step("anomaly");
+	}
+	std::size_t next_burst_step = 0;
+	if (burst_options) {
+		next_burst_step = next_self->add_step("burst");
+	}
+	const auto& next_outputs = config.get_outputs();
+	const auto& deadband_options = config.get_deadbands();
+	std::vector<std::size_t> next_output_steps;
+	for (std::size_t i = 0; i != next_outputs.size(); ++i) {
+		next_output_steps.push_back(next_self->add_step("output." + next_outputs[i]["type"].get<std::string>() + "." + std::to_string(i)
+			, deadband_options[i].has_value()));
+	}
 
-	while(true) {
-		auto metrics = collect_metrics();
-		output_metrics(metrics);
-		std::this_thread::sleep_for(std::chrono::seconds(period));
+	CollectorContext context{ snapshot, *next_self };
+	for (std::size_t i = 0; i != fresh.size(); ++i) {
+		if (carried[i] == SIZE_MAX) {
+			fresh[i]->prepare(context);
+		}
 	}
 
-}
+	// the stages keep their state unless their own section changed
+	std::optional<DerivedMetrics> next_derived;
+	if (first || derived_entries(applied) != derived_entries(data)) {
+		next_derived.emplace(config.take_derived());
+	}
+	std::optional<Alerts> next_alerts;
+	if (first || section(applied, "alerts") != section(data, "alerts")) {
+		next_alerts.emplace(config.take_alerts());
+	}
+	// the season is counted in periods, so the baselines are rebuilt with a new period as well
+	bool new_anomaly = first || setting(applied, "anomaly") != setting(data, "anomaly") || next_period != period;
+	std::optional<AnomalyDetector> next_anomaly;
+	if (new_anomaly && config.get_anomaly()) {
+		next_anomaly.emplace(*config.get_anomaly());
+	}
+	bool new_aggregator = first || setting(applied, "aggregation") != setting(data, "aggregation");
+	std::optional<Aggregator> next_aggregator;
+	if (new_aggregator && config.get_aggregation_window().count() > 0) {
+		next_aggregator.emplace(config.get_aggregation_window(), config.get_aggregation_accuracy());
+	}
+	bool new_burst = first || setting(applied, "burst") != setting(data, "burst");
+	std::unique_ptr<BurstCapture> next_burst;
+	if (new_burst && burst_options) {
+		next_burst = std::make_unique<BurstCapture>(*burst_options);
+	}
 
+	// an unchanged output keeps its deadband state, the log file stays open unless its path changed
+	std::vector<std::optional<DeadbandFilter>> next_deadbands(next_outputs.size());
+	std::vector<std::size_t> carried_deadbands(next_outputs.size(), SIZE_MAX);
+	std::vector<bool> taken_deadbands(outputs.size(), false);
+	for (std::size_t i = 0; i != next_outputs.size(); ++i) {
 
-std::vector<CpuStats> SystemMonitor::get_cpu_times() const {
+		if (!deadband_options[i]) continue;
+		for (std::size_t j = 0; j != outputs.size(); ++j) {
 
-	std::ifstream proc_stat("/proc/stat");
-	if (!proc_stat) {
-		throw std::runtime_error("Failed to open the /proc/stat file to get cpu statistics");
+			if (!taken_deadbands[j] && deadbands[j] && outputs[j] == next_outputs[i]) {
+				carried_deadbands[i] = j;
+				taken_deadbands[j] = true;
+				break;
+			}
+		}
+		if (carried_deadbands[i] == SIZE_MAX) {
+			next_deadbands[i].emplace(*deadband_options[i]);
+		}
+	}
+	auto next_log_path = log_output_path(next_outputs);
+	std::ofstream next_log;
+	if (next_log_path != log_path) {
+		config.setup_logging(next_log);
 	}
-	std::vector<CpuStats> times;
-	std::string line;
 
-	while(std::getline(proc_stat, line)) {
-		
-		if (line.find("cpu") == 0) {
-
-			if (line[3] == ' ') continue;
-
-			std::istringstream iss(line);
-			std::string cpu; // this is just to skip cpuN
-			
-			CpuStats stats;
-			uint64_t user, nice
-				, system, idle
-				, iowait, irq
-				, softirq, steal;
-
-			iss >> cpu >> stats.user 
-				>> stats.nice >> stats.system 
-				>> stats.idle >> stats.iowait 
-				>> stats.irq >> stats.softirq 
-				>> stats.steal;
-
-			times.push_back(stats);
+	std::vector<std::unique_ptr<Collector>> next_collectors;
+	std::vector<CollectorSchedule> next_schedules;
+	next_collectors.reserve(fresh.size());
+	next_schedules.reserve(fresh.size());
+
+	// a config that needs more workers than are running (more collectors, or ones with their own tasks) would
+	// leave their tasks waiting behind each other; the pool never shrinks, the extra workers just idle
+	pool.grow(pool_size(fresh));
+
+	// the swap, nothing below throws
+	const auto& adaptive = config.get_adaptive();
+	std::size_t kept = 0;
+	tag_resolution = false;
+	for (std::size_t i = 0; i != fresh.size(); ++i) {
+
+		if (carried[i] != SIZE_MAX) {
+
+			next_collectors.push_back(std::move(collectors[carried[i]]));
+			if (next_collect_period == collect_period) {
+				next_schedules.push_back(schedules[carried[i]]);
+			}
+			else {
+				next_schedules.emplace_back(next_collect_period, adaptive[i]);
+			}
+			++kept;
 		}
 		else {
-			break;
+			next_collectors.push_back(std::move(fresh[i]));
+			next_schedules.emplace_back(next_collect_period, adaptive[i]);
 		}
+		tag_resolution = tag_resolution || adaptive[i].has_value();
+	}
+	for (std::size_t i = 0; i != next_deadbands.size(); ++i) {
+		if (carried_deadbands[i] != SIZE_MAX) {
+			next_deadbands[i] = std::move(deadbands[carried_deadbands[i]]);
+		}
+	}
 
+	// the dropped collectors (the "self" ones among them) go before the SelfStats they may point into
+	collectors = std::move(next_collectors);
+	schedules = std::move(next_schedules);
+	collector_configs = entries;
+	self = std::move(next_self);
+	collect_step = next_collect_step;
+	collector_steps = std::move(next_collector_steps);
+	derived_step = next_derived_step;
+	alerts_step = next_alerts_step;
+	anomaly_step = next_anomaly_step;
+	burst_step = next_burst_step;
+	output_steps = std::move(next_output_steps);
+
+	if (next_derived) {
+		derived = std::move(*next_derived);
+	}
+	if (next_alerts) {
+		alerts = std::move(*next_alerts);
+	}
+	if (new_anomaly) {
+		anomaly = std::move(next_anomaly);
+	}
+	if (new_aggregator) {
+		aggregator = std::move(next_aggregator);
+	}
+	if (new_burst) {
+		burst = std::move(next_burst);
+	}
+	pipeline_every = burst_options ? std::max<std::size_t>(1, std::llround(static_cast<double>(next_period.count()) / burst_options->rate.count())) : 1;
+	burst_ticks = 0;
+
+	outputs = next_outputs;
+	deadbands = std::move(next_deadbands);
+	if (next_log_path != log_path) {
+		log_file = std::move(next_log);
+		log_path = next_log_path;
 	}
 
-	return times;
+	if (!first) {
+		std::cout << "Reloaded " << config_path << ": " << kept << " of " << collectors.size() << " collectors kept their state" << std::endl;
+	}
+	period = next_period;
+	collect_period = next_collect_period;
+	applied = data;
 }
 
 
-std::vector<std::unique_ptr<Metric>> SystemMonitor::collect_cpu_metrics(const json& metric) const {
 
-	std::vector<int> ids = metric["ids"].get<std::vector<int>>();
-	static auto prev_times = get_cpu_times();
+void SystemMonitor::reload() {
 
-	auto curr_times = get_cpu_times();
-	std::vector<std::unique_ptr<Metric>> cpu_metrics;
+	try {
+		Config config(config_path);
+		apply(config);
+	}
+	catch (const std::exception& ex) {
+		std::cerr << "Failed to reload " << config_path << ", keeping the running config: " << ex.what() << std::endl;
+	}
+}
 
-	for(int id : ids) {
-		
-		if (id >= 0 && id < curr_times.size()) {
-			
-			auto total_diff = curr_times[id].total() - prev_times[id].total();
-			auto active_diff = curr_times[id].active() - prev_times[id].active();
+SystemMonitor::~SystemMonitor() {
 
-			double load = (total_diff > 0) ? (static_cast<double>(active_diff) / total_diff) * 100.0 : 0.0;
-			cpu_metrics.emplace_back(new CpuLoad(id, load));
-		}
-		else {
-			throw std::invalid_argument("cpu-id '" + std::to_string(id) + "' in configuration file is invalid"); //
-		}
+	if (log_file.is_open()) {
+		
+		log_file.close(); //not really necessary, as file closes automatically in a ~std::ifstream() 
 	}
+}
 
-	prev_times = std::move(curr_times);
+void SystemMonitor::run() {
+	
+	std::cout << "Starting system monitor with period " << period.count() / 1000.0 << "s" << std::endl;
 
-	return cpu_metrics;
-}
+	while(true) {
 
+		// the tick boundary: nothing of the running plan is in use
+		if (watcher.changed()) {
+			reload();
+		}
 
-void SystemMonitor::read_mem_info(double& mem_total, double& mem_free, double& mem_available) const {
+		auto now = std::chrono::steady_clock::now();
+		auto metrics = collect_metrics(now);
 
-	std::ifstream meminfo("/proc/meminfo");
-	if (!meminfo) {
-		throw std::runtime_error("Failed to open /proc/meminfo");
-	}
+		if (burst) {
 
-	std::string line;
-	std::uint64_t total_kb = 0, available_kb = 0, free_kb = 0;
+			{
+				ScopedTimer timer(*self, burst_step);
+				burst->record(metrics);
+			}
 
-	while(std::getline(meminfo, line)) {
+			// the batches in between only go to the ring, the stages get their means once a period
+			if (burst_ticks++ % pipeline_every != 0) {
+				sleep_until_due(now);
+				continue;
+			}
+			burst->take_means(metrics);
+		}
 
-		std::istringstream iss(line);
-		std::string key;
-		std::uint64_t value;
-		std::string unit;
+		now = std::chrono::steady_clock::now();
 
-		iss >> key >> value >> unit;
+		if (!derived.empty()) {
+			ScopedTimer timer(*self, derived_step);
+			derived.evaluate(metrics, now);
+		}
 
-		if (key == "MemTotal:") {
-			total_kb = value;
+		std::vector<std::unique_ptr<Metric>> events;
+		if (!alerts.empty()) {
+			ScopedTimer timer(*self, alerts_step);
+			events = alerts.evaluate(metrics, now);
 		}
-		else if (key == "MemFree:") {
-			free_kb = value;
+		if (anomaly) {
+			ScopedTimer timer(*self, anomaly_step);
+			auto anomalies = anomaly->evaluate(metrics, now);
+			events.insert(events.end(), std::make_move_iterator(anomalies.begin()), std::make_move_iterator(anomalies.end()));
 		}
-		else if (key == "MemAvailable:") {
-			available_kb = value;
+		if (burst && !events.empty()) {
+			burst->check_events(events);
+		}
+
+		if (aggregator) {
+
+			// the alert and anomaly events are written at once rather than at the end of the window
+			if (!events.empty()) {
+				output_metrics({}, events);
+			}
+
+			aggregator->add(metrics);
+
+			now = std::chrono::steady_clock::now();
+			if (aggregator->window_ended(now)) {
+				output_metrics(aggregator->flush(now), {});
+			}
 		}
 		else {
-			break;
+			output_metrics(metrics, events);
 		}
-	} 	
 
-	if (total_kb == 0 || available_kb == 0) {
-        throw std::runtime_error("Failed to read required fields from /proc/meminfo");
+		sleep_until_due(now);
 	}
 
-	mem_total = total_kb / (1024.0 * 1024);
-	mem_free = free_kb / (1024.0 * 1024);
-	mem_available = available_kb / (1024.0 * 1024);	
 }
 
 
 
-std::vector<std::unique_ptr<Metric>> SystemMonitor::collect_memory_metrics(const json& metric) const {
+void SystemMonitor::sleep_until_due(std::chrono::steady_clock::time_point now) const {
 
-	auto specs = metric["spec"].get<std::vector<std::string>>(); // extracting ["used", "free"]
-	double mem_total = 0.0, mem_free = 0.0, mem_available = 0.0;
+	// until the next collector is due: every period without adaptive sampling or a burst capture
+	auto next = now + period;
+	for (const auto& schedule : schedules) {
+		next = std::min(next, schedule.next_run());
+	}
+	std::this_thread::sleep_until(next);
+}
 
-	read_mem_info(mem_total, mem_free, mem_available);
 
-	std::vector<std::unique_ptr<Metric>> mem_metrics;
 
-	for(const auto& spec : specs) {
-		if (spec == "used") {
-			mem_metrics.emplace_back(new MemoryMetric(spec, mem_total - mem_available));
-		}
-		else if (spec == "free") {
-			mem_metrics.emplace_back(new MemoryMetric(spec, mem_free)); 
-		}
-	}
+std::vector<std::unique_ptr<Metric>> SystemMonitor::collect_metrics(std::chrono::steady_clock::time_point now) {
 
-	return mem_metrics;
-}
+	ScopedTimer timer(*self, collect_step);
 
+	std::vector<std::unique_ptr<Metric>> collected_metrics;
 
+	std::vector<std::future<SampleBatch>> future_batches;
+	std::vector<std::size_t> running; // parallel to future_batches
+	future_batches.reserve(collectors.size());
 
-std::vector<std::unique_ptr<Metric>> SystemMonitor::collect_metrics() const {
+	snapshot.next_tick();
 
-	std::vector<std::unique_ptr<Metric>> collected_metrics;
+	for (std::size_t i = 0; i != collectors.size(); ++i) {
 
-	std::vector<std::future<std::vector<std::unique_ptr<Metric>>>> future_metrics;
+		if (!schedules[i].due(now)) continue;
+		running.push_back(i);
 
-	for (const auto& metric : metrics_config) {
-		
-		if (metric["type"] == "cpu") {
-			
-			future_metrics.emplace_back(pool.submit(&SystemMonitor::collect_cpu_metrics, this, std::cref(metric)));
+		Collector* collector = collectors[i].get();
+		if (collector->own_workers() != 0) {
 
+			// the collector's own tasks go to the pool first, while waiting for them is deferred to this thread,
+			// so a worker never blocks on tasks that are queued behind it
+			collector->start(pool);
+			future_batches.emplace_back(std::async(std::launch::deferred, &SystemMonitor::run_collector, collector, self.get(), collector_steps[i]));
 		}
-		else if (metric["type"] == "memory") {
-
-			future_metrics.emplace_back(pool.submit(&SystemMonitor::collect_memory_metrics, this, std::cref(metric)));
+		else {
+			future_batches.emplace_back(pool.submit(&SystemMonitor::run_collector, collector, self.get(), collector_steps[i]));
 		}
 	}
 
 
-	for(auto& fm : future_metrics) {
+	for (std::size_t k = 0; k != future_batches.size(); ++k) {
 		
-		std::vector<std::unique_ptr<Metric>> some_metrics;
+		SampleBatch batch;
 		try {
-			some_metrics = fm.get();
+			batch = future_batches[k].get();
 		}
 		catch(const std::exception& ex) {
 
 			throw std::runtime_error("Failed to collect metrics : " + std::string(ex.what()));
 		} 
+
+		if (batch.layout_changed) {
+			SeriesSlots::series_changed();
+		}
+
+		auto& schedule = schedules[running[k]];
+		if (tag_resolution) {
+			for (auto& metric : batch.metrics) {
+				metric->resolution = schedule.interval();
+			}
+		}
+		schedule.update(batch.metrics, now);
 		
 		collected_metrics.insert(collected_metrics.end()
-			, std::make_move_iterator(some_metrics.begin())
-			, std::make_move_iterator(some_metrics.end())
+			, std::make_move_iterator(batch.metrics.begin())
+			, std::make_move_iterator(batch.metrics.end())
 			);
 	}
 
@@ -221,23 +459,63 @@ std::vector<std::unique_ptr<Metric>> SystemMonitor::collect_metrics() const {
 
 
 
-void SystemMonitor::output_metrics(const std::vector<std::unique_ptr<Metric>>& metrics) {
+SampleBatch SystemMonitor::run_collector(Collector* collector, SelfStats* self, std::size_t step) {
+
+	ScopedTimer timer(*self, step);
+
+	SampleBatch batch;
+	collector->collect(batch);
+	return batch;
+}
+
+
+
+void SystemMonitor::output_metrics(const std::vector<std::unique_ptr<Metric>>& metrics, const std::vector<std::unique_ptr<Metric>>& events) {
     
+    auto now = std::chrono::steady_clock::now();
     auto t = std::time(nullptr);
     auto tm = *std::localtime(&t);
     std::ostringstream oss;
     oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
     std::string timestamp = oss.str();
 
-    for (const auto& output : outputs) {
+    for (std::size_t i = 0; i != outputs.size(); ++i) {
+
+        const auto& output = outputs[i];
+        ScopedTimer timer(*self, output_steps[i]);
+
+        std::vector<const Metric*> selected;
+        if (deadbands[i]) {
+
+            selected = deadbands[i]->filter(metrics, now);
+            self->count_filtered(output_steps[i], metrics.size(), metrics.size() - selected.size());
+        }
+        else {
+
+            selected.reserve(metrics.size() + events.size());
+            for (const auto& metric : metrics) {
+                selected.push_back(metric.get());
+            }
+        }
+        for (const auto& event : events) {
+            selected.push_back(event.get());
+        }
+        if (selected.empty() && deadbands[i]) {
+            continue; // nothing has changed, not even an empty line
+        }
 
         if (output["type"] == "console") {
 
         	std::vector<std::string> console_strings;
-		    console_strings.reserve(metrics.size());
+		    console_strings.reserve(selected.size());
 		    
-		    for (const auto& metric : metrics) {
-		        console_strings.push_back(metric->to_string());
+		    for (const auto* metric : selected) {
+
+		        auto text = metric->to_string();
+		        if (metric->resolution.count() > 0) {
+		            text += " @" + resolution_string(metric->resolution);
+		        }
+		        console_strings.push_back(text);
 		    }
 		    std::string console_output = "Metrics at " + timestamp + ": " + join(console_strings, "; ");
 
@@ -252,8 +530,13 @@ void SystemMonitor::output_metrics(const std::vector<std::unique_ptr<Metric>>& m
             json log_entry;
             log_entry["timestamp"] = timestamp;
             log_entry["metrics"] = json::array();
-            for (const auto& metric : metrics) {
-                log_entry["metrics"].push_back(metric->to_json());
+            for (const auto* metric : selected) {
+
+                auto entry = metric->to_json();
+                if (metric->resolution.count() > 0) {
+                    entry["resolution"] = metric->resolution.count() / 1000.0; // seconds, like "settings.period"
+                }
+                log_entry["metrics"].push_back(std::move(entry));
             }
             log_file << log_entry.dump(2) << std::endl;
             log_file.flush();
@@ -0,0 +1,220 @@
+#include "thermal_stats.hpp"
+#include "numa_stats.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fnmatch.h>
+#include <fstream>
+#include <stdexcept>
+
+
+ThermalStatsReader::ThermalStatsReader(const std::vector<int>& cpus, std::vector<std::string> sensor_patterns, const std::string& root)
+	: patterns(std::move(sensor_patterns))
+	, prev_time(std::chrono::steady_clock::now())
+{
+	std::vector<int> ids = cpus;
+	if (ids.empty()) {
+
+		ids = CpuTopology::read(root + "/devices/system").sockets.cpus;
+		std::sort(ids.begin(), ids.end());
+	}
+
+	for (int cpu : ids) {
+
+		auto dir = root + "/devices/system/cpu/cpu" + std::to_string(cpu);
+		if (!std::filesystem::exists(dir)) {
+			throw std::invalid_argument("cpu-id '" + std::to_string(cpu) + "' in configuration file is invalid");
+		}
+
+		CpuFiles files;
+		bool has_freq = try_open(files.freq, dir + "/cpufreq/scaling_cur_freq");
+		bool has_throttle = try_open(files.core_throttle, dir + "/thermal_throttle/core_throttle_count");
+		bool has_package_throttle = try_open(files.package_throttle, dir + "/thermal_throttle/package_throttle_count");
+
+		cpu_files.push_back(std::move(files));
+		result.cpus.push_back({cpu, has_freq, has_throttle, has_package_throttle, 0, 0, 0});
+	}
+
+	if (!patterns.empty()) {
+		open_sensors(root);
+	}
+
+	bool has_cpu_data = std::any_of(result.cpus.begin(), result.cpus.end(), [](const CpuThermal& cpu) {
+		return cpu.has_freq || cpu.has_throttle || cpu.has_package_throttle;
+	});
+	if (!has_cpu_data && result.sensors.empty()) {
+		throw std::runtime_error("Neither cpufreq, thermal_throttle nor hwmon temperatures are available in " + root);
+	}
+
+	for (auto& files : cpu_files) {
+
+		if (files.freq.is_open()) files.freq_slot = batch.add(files.freq);
+		if (files.core_throttle.is_open()) files.core_slot = batch.add(files.core_throttle);
+		if (files.package_throttle.is_open()) files.package_slot = batch.add(files.package_throttle);
+	}
+	for (const auto& file : sensor_files) {
+		sensor_slots.push_back(batch.add(file));
+	}
+}
+
+
+bool ThermalStatsReader::try_open(ProcFile& file, const std::string& path) {
+
+	// an attribute can exist and still fail every read (a disconnected sensor returns EIO or ENODATA), which
+	// would fail the whole batch, so it's read once here
+	try {
+		file.open(path, 32);
+		file.read_attribute();
+		return true;
+	}
+	catch (const std::exception&) {
+		file.close();
+		return false;
+	}
+}
+
+
+std::uint64_t ThermalStatsReader::read_value(std::size_t slot) const {
+
+	auto text = batch.get(slot);
+	return proc_parse::next_u64(text);
+}
+
+
+void ThermalStatsReader::open_sensors(const std::string& root) {
+
+	namespace fs = std::filesystem;
+
+	std::error_code ec;
+	std::vector<fs::path> hwmons;
+	for (const auto& entry : fs::directory_iterator(root + "/class/hwmon", ec)) {
+		hwmons.push_back(entry.path());
+	}
+	std::sort(hwmons.begin(), hwmons.end());
+
+	for (const auto& hwmon : hwmons) {
+
+		std::string name;
+		std::ifstream(hwmon / "name") >> name;
+		if (name.empty()) {
+			name = hwmon.filename().string(); // "name" is mandatory, but not every driver has it
+		}
+
+		std::vector<std::string> inputs;
+		for (const auto& entry : fs::directory_iterator(hwmon, ec)) {
+
+			auto file = entry.path().filename().string();
+			if (file.compare(0, 4, "temp") == 0 && file.size() > 10 && file.compare(file.size() - 6, 6, "_input") == 0) {
+				inputs.push_back(file);
+			}
+		}
+
+		// temp2_input before temp10_input
+		std::sort(inputs.begin(), inputs.end(), [](const std::string& a, const std::string& b) {
+			return a.size() != b.size() ? a.size() < b.size() : a < b;
+		});
+
+		for (const auto& input : inputs) {
+
+			auto prefix = input.substr(0, input.size() - 6); // temp<N>
+
+			std::string label;
+			std::getline(std::ifstream(hwmon / (prefix + "_label")), label);
+			auto sensor = name + "/" + (label.empty() ? prefix : label);
+
+			bool selected = std::any_of(patterns.begin(), patterns.end(), [&](const std::string& pattern) {
+				return fnmatch(pattern.c_str(), sensor.c_str(), 0) == 0;
+			});
+
+			if (selected) {
+				add_sensor(sensor, (hwmon / input).string());
+			}
+		}
+	}
+
+	// thermal zones, named by their type: many of them (x86_pkg_temp, iwlwifi_1, ...) have no hwmon device
+	std::vector<fs::path> zones;
+	for (const auto& entry : fs::directory_iterator(root + "/class/thermal", ec)) {
+
+		auto file = entry.path().filename().string();
+		if (file.compare(0, 12, "thermal_zone") == 0) { // cooling_device<N> live there too
+			zones.push_back(entry.path());
+		}
+	}
+	std::sort(zones.begin(), zones.end(), [](const fs::path& a, const fs::path& b) {
+		return a.native().size() != b.native().size() ? a.native().size() < b.native().size() : a < b;
+	});
+
+	for (const auto& zone : zones) {
+
+		std::string type;
+		std::ifstream(zone / "type") >> type;
+		auto sensor = (type.empty() ? std::string("thermal") : type) + "/" + zone.filename().string().substr(8); // "zone<N>"
+
+		bool selected = std::any_of(patterns.begin(), patterns.end(), [&](const std::string& pattern) {
+			return fnmatch(pattern.c_str(), sensor.c_str(), 0) == 0;
+		});
+		if (selected) {
+			add_sensor(sensor, (zone / "temp").string());
+		}
+	}
+}
+
+
+void ThermalStatsReader::add_sensor(const std::string& sensor, const std::string& path) {
+
+	ProcFile file;
+	if (try_open(file, path)) {
+		sensor_files.push_back(std::move(file));
+		result.sensors.push_back({sensor, 0});
+	}
+}
+
+
+const ThermalSample& ThermalStatsReader::sample() {
+
+	auto now = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(now - prev_time).count();
+	prev_time = now;
+
+	const double scale = (has_prev && seconds > 0) ? 1.0 / seconds : 0.0;
+
+	batch.read_all();
+
+	for (std::size_t i = 0; i != cpu_files.size(); ++i) {
+
+		auto& files = cpu_files[i];
+		auto& cpu = result.cpus[i];
+
+		if (cpu.has_freq) {
+			cpu.freq = read_value(files.freq_slot) / 1000.0; // kHz
+		}
+
+		if (cpu.has_throttle) {
+
+			auto core = read_value(files.core_slot);
+			cpu.core_throttle = (core >= files.prev_core) ? (core - files.prev_core) * scale : 0.0;
+			files.prev_core = core;
+		}
+
+		if (cpu.has_package_throttle) {
+
+			auto package = read_value(files.package_slot);
+			cpu.package_throttle = (package >= files.prev_package) ? (package - files.prev_package) * scale : 0.0;
+			files.prev_package = package;
+		}
+	}
+
+	for (std::size_t i = 0; i != sensor_files.size(); ++i) {
+
+		// millidegrees, negative outdoors
+		auto text = batch.get(sensor_slots[i]);
+		bool negative = !text.empty() && text.front() == '-';
+		if (negative) text.remove_prefix(1);
+
+		double temp = proc_parse::next_u64(text) / 1000.0;
+		result.sensors[i].temp = negative ? -temp : temp;
+	}
+
+	has_prev = true;
+	return result;
+}
@@ -0,0 +1,120 @@
+#include "vm_stats.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fnmatch.h>
+#include <stdexcept>
+
+
+namespace {
+
+	// nr_* entries are current amounts (pages, tasks), except these two which count events
+	bool is_counter(const std::string& field) {
+		return field.compare(0, 3, "nr_") != 0 || field == "nr_dirtied" || field == "nr_written";
+	}
+
+}
+
+
+VmStatsReader::VmStatsReader(std::vector<std::string> patterns, SharedProcFile& file)
+	: file(file)
+	, patterns(std::move(patterns))
+	, prev_time(std::chrono::steady_clock::now())
+{
+	compile(file.read());
+
+	if (slots.empty()) {
+		throw std::runtime_error("None of the vmstat fields in configuration file exist in " + file.get_path());
+	}
+}
+
+
+void VmStatsReader::compile(std::string_view text) {
+
+	auto old = std::move(slots);
+	slots.clear();
+
+	std::string_view line;
+	std::size_t line_no = 0;
+	while (proc_parse::next_line(text, line)) {
+
+		std::string field(proc_parse::next_token(line));
+		for (const auto& pattern : patterns) {
+
+			if (fnmatch(pattern.c_str(), field.c_str(), 0) == 0) {
+
+				auto kept = std::find_if(old.begin(), old.end(), [&](const Slot& slot) { return slot.field == field; });
+				if (kept != old.end()) {
+					slots.push_back({line_no, field, kept->is_rate, kept->prev, kept->has_prev});
+				}
+				else {
+					slots.push_back({line_no, field, is_counter(field), 0, false});
+				}
+				break;
+			}
+		}
+		++line_no;
+	}
+}
+
+
+bool VmStatsReader::parse(std::string_view text) {
+
+	values.resize(slots.size());
+
+	const char* pos = text.data();
+	const char* end = text.data() + text.size();
+	std::size_t line_no = 0;
+
+	for (std::size_t i = 0; i != slots.size(); ++i) {
+
+		const auto& slot = slots[i];
+
+		// jump over the lines nobody asked for without looking at their content
+		while (line_no < slot.line && pos < end) {
+			auto* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+			pos = newline ? newline + 1 : end;
+			++line_no;
+		}
+
+		std::string_view line(pos, end - pos);
+		auto name = proc_parse::next_token(line);
+
+		if (name != slot.field) {
+			return false;
+		}
+		values[i] = proc_parse::next_u64(line);
+	}
+	return true;
+}
+
+
+void VmStatsReader::sample(std::vector<VmRate>& out) {
+
+	out.clear();
+
+	auto text = file.read();
+	auto now = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(now - prev_time).count();
+	prev_time = now;
+
+	// the layout only changes with the kernel (or a module), but let's not report a wrong field if it does
+	if (!parse(text)) {
+		compile(text);
+		parse(text);
+	}
+
+	for (std::size_t i = 0; i != slots.size(); ++i) {
+
+		auto& slot = slots[i];
+		auto value = values[i];
+		if (slot.is_rate) {
+			double rate = (slot.has_prev && seconds > 0 && value >= slot.prev) ? (value - slot.prev) / seconds : 0.0;
+			out.push_back({slot.field, rate, true});
+		}
+		else {
+			out.push_back({slot.field, static_cast<double>(value), false});
+		}
+		slot.prev = value;
+		slot.has_prev = true;
+	}
+}
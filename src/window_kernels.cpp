@@ -0,0 +1,255 @@
+#include "window_kernels.hpp"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WINDOW_KERNELS_X86
+#endif
+
+
+namespace {
+
+	// the reference: `x < acc` is false for a NaN, and a NaN doesn't pass `x == x`
+	inline void accumulate_scalar(const double* values, std::size_t n, double* min, double* max, double* sum, double* sumsq) {
+
+		for (std::size_t i = 0; i != n; ++i) {
+
+			double x = values[i];
+			min[i] = x < min[i] ? x : min[i];
+			max[i] = x > max[i] ? x : max[i];
+			if (x == x) {
+				sum[i] += x;
+				sumsq[i] += x * x;
+			}
+		}
+	}
+
+	// the same operations in the same order as update_avx2(), no FMA contraction (the compiler doesn't contract
+	// without an FMA target)
+	inline void update_scalar(const double* values, std::size_t n, const window_kernels::BaselineParams& p
+		, const window_kernels::BaselineColumns& c)
+	{
+		for (std::size_t i = 0; i != n; ++i) {
+
+			double x = values[i];
+			if (!(x == x)) {
+				c.score[i] = 0;
+				continue;
+			}
+
+			double level = c.level[i];
+			double trend = c.trend[i];
+			double season = c.season[i];
+			double var = c.var[i];
+			double seen = c.seen[i];
+			bool first = seen == 0;
+
+			double forecast = level + trend + season;
+			double d = x - forecast;
+			double v = var > p.min_var ? var : p.min_var;
+			bool flagged = seen >= p.warmup && d * d > p.k2 * v;
+
+			double new_level = first ? x : p.alpha * (x - season) + (1 - p.alpha) * (level + trend);
+			c.trend[i] = first ? 0 : p.beta * (new_level - level) + (1 - p.beta) * trend;
+			c.season[i] = first ? season : p.gamma * (x - new_level) + (1 - p.gamma) * season;
+			c.var[i] = first ? 0 : (1 - p.alpha) * (var + p.alpha * d * d);
+			c.level[i] = new_level;
+			c.seen[i] = seen + 1;
+			c.forecast[i] = forecast;
+			c.score[i] = flagged ? d / std::sqrt(v) : 0;
+		}
+	}
+
+#ifdef WINDOW_KERNELS_X86
+
+	// minpd(a, b) is a < b ? a : b, the same select as the scalar code (NaN -> b); the sums are computed for every
+	// lane and blended back only where the value is present, so a NaN lane keeps its old sum bit for bit
+	__attribute__((target("sse4.1")))
+	void accumulate_sse4(const double* values, std::size_t n, double* min, double* max, double* sum, double* sumsq) {
+
+		std::size_t i = 0;
+		for (; i + 2 <= n; i += 2) {
+
+			__m128d x = _mm_loadu_pd(values + i);
+			__m128d present = _mm_cmpord_pd(x, x);
+			__m128d s = _mm_loadu_pd(sum + i);
+			__m128d sq = _mm_loadu_pd(sumsq + i);
+
+			_mm_storeu_pd(min + i, _mm_min_pd(x, _mm_loadu_pd(min + i)));
+			_mm_storeu_pd(max + i, _mm_max_pd(x, _mm_loadu_pd(max + i)));
+			_mm_storeu_pd(sum + i, _mm_blendv_pd(s, _mm_add_pd(s, x), present));
+			_mm_storeu_pd(sumsq + i, _mm_blendv_pd(sq, _mm_add_pd(sq, _mm_mul_pd(x, x)), present));
+		}
+		accumulate_scalar(values + i, n - i, min + i, max + i, sum + i, sumsq + i);
+	}
+
+	// no FMA on purpose: x * x is rounded before the addition, like in the scalar code
+	__attribute__((target("avx2")))
+	void accumulate_avx2(const double* values, std::size_t n, double* min, double* max, double* sum, double* sumsq) {
+
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+
+			__m256d x = _mm256_loadu_pd(values + i);
+			__m256d present = _mm256_cmp_pd(x, x, _CMP_ORD_Q);
+			__m256d s = _mm256_loadu_pd(sum + i);
+			__m256d sq = _mm256_loadu_pd(sumsq + i);
+
+			_mm256_storeu_pd(min + i, _mm256_min_pd(x, _mm256_loadu_pd(min + i)));
+			_mm256_storeu_pd(max + i, _mm256_max_pd(x, _mm256_loadu_pd(max + i)));
+			_mm256_storeu_pd(sum + i, _mm256_blendv_pd(s, _mm256_add_pd(s, x), present));
+			_mm256_storeu_pd(sumsq + i, _mm256_blendv_pd(sq, _mm256_add_pd(sq, _mm256_mul_pd(x, x)), present));
+		}
+		// the scalar tail is inlined with VEX encoding; calling the SSE path from here would pay for the
+		// AVX-SSE transition on every column
+		accumulate_scalar(values + i, n - i, min + i, max + i, sum + i, sumsq + i);
+		_mm256_zeroupper();
+	}
+
+	// every lane computes all the branches of update_scalar() and blends the results; a missing value keeps the
+	// old state (and forecast) and gets a zero score
+	__attribute__((target("avx2")))
+	void update_avx2(const double* values, std::size_t n, const window_kernels::BaselineParams& p
+		, const window_kernels::BaselineColumns& c)
+	{
+		const __m256d zero = _mm256_setzero_pd();
+		const __m256d one = _mm256_set1_pd(1);
+		const __m256d alpha = _mm256_set1_pd(p.alpha);
+		const __m256d beta = _mm256_set1_pd(p.beta);
+		const __m256d gamma = _mm256_set1_pd(p.gamma);
+		const __m256d rest_alpha = _mm256_set1_pd(1 - p.alpha);
+		const __m256d rest_beta = _mm256_set1_pd(1 - p.beta);
+		const __m256d rest_gamma = _mm256_set1_pd(1 - p.gamma);
+		const __m256d k2 = _mm256_set1_pd(p.k2);
+		const __m256d min_var = _mm256_set1_pd(p.min_var);
+		const __m256d warmup = _mm256_set1_pd(p.warmup);
+
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+
+			__m256d x = _mm256_loadu_pd(values + i);
+			__m256d present = _mm256_cmp_pd(x, x, _CMP_ORD_Q);
+
+			__m256d level = _mm256_loadu_pd(c.level + i);
+			__m256d trend = _mm256_loadu_pd(c.trend + i);
+			__m256d season = _mm256_loadu_pd(c.season + i);
+			__m256d var = _mm256_loadu_pd(c.var + i);
+			__m256d seen = _mm256_loadu_pd(c.seen + i);
+			__m256d first = _mm256_cmp_pd(seen, zero, _CMP_EQ_OQ);
+
+			__m256d forecast = _mm256_add_pd(_mm256_add_pd(level, trend), season);
+			__m256d d = _mm256_sub_pd(x, forecast);
+			__m256d v = _mm256_max_pd(var, min_var);
+			__m256d flagged = _mm256_and_pd(_mm256_cmp_pd(seen, warmup, _CMP_GE_OQ)
+				, _mm256_cmp_pd(_mm256_mul_pd(d, d), _mm256_mul_pd(k2, v), _CMP_GT_OQ));
+
+			__m256d new_level = _mm256_blendv_pd(
+				_mm256_add_pd(_mm256_mul_pd(alpha, _mm256_sub_pd(x, season)), _mm256_mul_pd(rest_alpha, _mm256_add_pd(level, trend))), x, first);
+			__m256d new_trend = _mm256_blendv_pd(
+				_mm256_add_pd(_mm256_mul_pd(beta, _mm256_sub_pd(new_level, level)), _mm256_mul_pd(rest_beta, trend)), zero, first);
+			__m256d new_season = _mm256_blendv_pd(
+				_mm256_add_pd(_mm256_mul_pd(gamma, _mm256_sub_pd(x, new_level)), _mm256_mul_pd(rest_gamma, season)), season, first);
+			__m256d new_var = _mm256_blendv_pd(
+				_mm256_mul_pd(rest_alpha, _mm256_add_pd(var, _mm256_mul_pd(_mm256_mul_pd(alpha, d), d))), zero, first);
+			__m256d score = _mm256_and_pd(_mm256_div_pd(d, _mm256_sqrt_pd(v)), _mm256_and_pd(flagged, present));
+
+			_mm256_storeu_pd(c.level + i, _mm256_blendv_pd(level, new_level, present));
+			_mm256_storeu_pd(c.trend + i, _mm256_blendv_pd(trend, new_trend, present));
+			_mm256_storeu_pd(c.season + i, _mm256_blendv_pd(season, new_season, present));
+			_mm256_storeu_pd(c.var + i, _mm256_blendv_pd(var, new_var, present));
+			_mm256_storeu_pd(c.seen + i, _mm256_blendv_pd(seen, _mm256_add_pd(seen, one), present));
+			_mm256_storeu_pd(c.forecast + i, _mm256_blendv_pd(_mm256_loadu_pd(c.forecast + i), forecast, present));
+			_mm256_storeu_pd(c.score + i, score);
+		}
+
+		window_kernels::BaselineColumns tail{ c.level + i, c.trend + i, c.season + i, c.var + i, c.seen + i, c.forecast + i, c.score + i };
+		update_scalar(values + i, n - i, p, tail);
+		_mm256_zeroupper();
+	}
+
+#endif
+
+	window_kernels::Isa detect() {
+
+#ifdef WINDOW_KERNELS_X86
+		// runs CPUID once and also checks that the OS saves the YMM registers (OSXSAVE/XGETBV)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			return window_kernels::Isa::avx2;
+		}
+		if (__builtin_cpu_supports("sse4.1")) {
+			return window_kernels::Isa::sse4;
+		}
+#endif
+		return window_kernels::Isa::scalar;
+	}
+
+}
+
+
+namespace window_kernels {
+
+	Isa best() {
+
+		static const Isa isa = detect();
+		return isa;
+	}
+
+
+	Accumulate get(Isa isa) {
+
+		switch (isa) {
+			case Isa::scalar: return accumulate_scalar;
+#ifdef WINDOW_KERNELS_X86
+			case Isa::sse4: return accumulate_sse4;
+			case Isa::avx2: return accumulate_avx2;
+#else
+			default: return nullptr;
+#endif
+		}
+		return nullptr;
+	}
+
+
+	Update get_update(Isa isa) {
+
+		switch (isa) {
+			case Isa::scalar:
+			case Isa::sse4:
+				return update_scalar;
+#ifdef WINDOW_KERNELS_X86
+			case Isa::avx2: return update_avx2;
+#else
+			default: return nullptr;
+#endif
+		}
+		return nullptr;
+	}
+
+
+	const char* name(Isa isa) {
+
+		switch (isa) {
+			case Isa::scalar: return "scalar";
+			case Isa::sse4: return "sse4";
+			case Isa::avx2: return "avx2";
+		}
+		return "unknown";
+	}
+
+
+	void accumulate(const double* values, std::size_t n, double* min, double* max, double* sum, double* sumsq) {
+
+		static const Accumulate best_accumulate = get(best());
+		best_accumulate(values, n, min, max, sum, sumsq);
+	}
+
+
+
+	void update(const double* values, std::size_t n, const BaselineParams& params, const BaselineColumns& columns) {
+
+		static const Update best_update = get_update(best());
+		best_update(values, n, params, columns);
+	}
+
+}
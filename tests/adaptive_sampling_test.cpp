@@ -0,0 +1,17 @@
+#include "test.hpp"
+#include "adaptive_sampling.hpp"
+
+
+TEST(adaptive_grows_from_min) {
+
+	// a flat signal from a 1 ms minimum: half of 1 ms rounds down to nothing, the interval must still grow
+	auto options = AdaptiveOptions::parse(json::parse(R"({ "min": 0.001, "max": 1 })"));
+	CollectorSchedule schedule(std::chrono::milliseconds(1000), options);
+	auto now = std::chrono::steady_clock::now();
+
+	for (int run = 0; run != 40; ++run) {
+		schedule.update(test::batch({ { "flat", 5 } }), now);
+		now = schedule.next_run();
+	}
+	CHECK_EQ(schedule.interval().count(), 1000);
+}
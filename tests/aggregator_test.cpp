@@ -0,0 +1,72 @@
+#include "test.hpp"
+#include "aggregator.hpp"
+
+
+namespace {
+
+	// the value of "<series>.<stat>" in a flushed summary, NaN if it isn't there
+	double stat(const std::vector<std::unique_ptr<Metric>>& summary, const std::string& series) {
+
+		for (const auto& metric : summary) {
+			if (metric->series() == series) return metric->get_value();
+		}
+		return std::nan("");
+	}
+
+}
+
+
+TEST(aggregator_windows) {
+
+	Aggregator aggregator(std::chrono::milliseconds(1000), 0.01);
+	auto now = std::chrono::steady_clock::now();
+
+	aggregator.add(test::batch({ { "a", 1 }, { "b", 10 } }));
+	aggregator.add(test::batch({ { "a", 3 }, { "b", 30 } }));
+
+	auto summary = aggregator.flush(now);
+	CHECK_EQ(summary.size(), 14u);
+	CHECK_EQ(stat(summary, "test.a.min"), 1.0);
+	CHECK_EQ(stat(summary, "test.a.mean"), 2.0);
+	CHECK_EQ(stat(summary, "test.b.max"), 30.0);
+
+	// the statistics start over with the window
+	aggregator.add(test::batch({ { "a", 5 }, { "b", 50 } }));
+	summary = aggregator.flush(now);
+	CHECK_EQ(stat(summary, "test.a.min"), 5.0);
+	CHECK_EQ(stat(summary, "test.b.mean"), 50.0);
+}
+
+
+TEST(aggregator_eviction) {
+
+	Aggregator aggregator(std::chrono::milliseconds(1000), 0.01);
+	auto now = std::chrono::steady_clock::now();
+
+	aggregator.add(test::batch({ { "a", 1 }, { "b", 2 }, { "c", 3 } }));
+	aggregator.flush(now);
+
+	// "b" is gone for a whole window and is forgotten, the series after it move down
+	aggregator.add(test::batch({ { "a", 4 }, { "c", 6 } }));
+	aggregator.add(test::batch({ { "a", 5 }, { "c", 7 } }));
+	auto summary = aggregator.flush(now);
+	CHECK_EQ(summary.size(), 14u);
+	CHECK(std::isnan(stat(summary, "test.b.max")));
+
+	// positions cached from the last tick point at the moved series
+	aggregator.add(test::batch({ { "a", 8 }, { "c", 9 } }));
+	summary = aggregator.flush(now);
+	CHECK_EQ(stat(summary, "test.a.max"), 8.0);
+	CHECK_EQ(stat(summary, "test.c.max"), 9.0);
+
+	aggregator.flush(now);
+	CHECK_EQ(aggregator.flush(now).size(), 0u);
+
+	// a series that comes back starts over, after the ones still known
+	aggregator.add(test::batch({ { "b", 20 }, { "d", 40 } }));
+	summary = aggregator.flush(now);
+	CHECK_EQ(summary.size(), 14u);
+	CHECK_EQ(summary.front()->series(), std::string("test.b.min"));
+	CHECK_EQ(stat(summary, "test.b.mean"), 20.0);
+	CHECK_EQ(stat(summary, "test.d.mean"), 40.0);
+}
@@ -0,0 +1,61 @@
+#include "test.hpp"
+#include "anomaly_detector.hpp"
+
+
+TEST(anomaly_season_phase) {
+
+	AnomalyOptions options;
+	options.alpha = 0.2;
+	options.gamma = 0.5;
+	options.warmup = 20;
+	options.k = 4;
+	options.season = 2;
+	options.period = std::chrono::seconds(1);
+	AnomalyDetector detector(options);
+	auto start = std::chrono::steady_clock::now();
+
+	// a square wave of two periods sampled 4 times a period, as an adaptive collector would: the phase follows
+	// the time, so the season is learned and only the spike is flagged
+	std::size_t flagged = 0;
+	auto elapsed = std::chrono::milliseconds(0);
+	for (int tick = 0; tick != 400; ++tick, elapsed += std::chrono::milliseconds(250)) {
+
+		double value = (elapsed.count() / 1000 % 2 == 0 ? 10 : 50) + tick % 5 * 0.1;
+		flagged += detector.evaluate(test::batch({ { "wave", value } }), start + elapsed).size() * (tick >= 200);
+	}
+	CHECK_EQ(flagged, 0u);
+
+	auto events = detector.evaluate(test::batch({ { "wave", 10 + 5 } }), start + elapsed);
+	CHECK_EQ(events.size(), 1u);
+	CHECK_EQ(events[0]->series(), std::string("anomaly.test.wave"));
+}
+
+
+TEST(anomaly_eviction) {
+
+	AnomalyOptions options;
+	options.series = { "test.?" };
+	options.warmup = 5;
+	AnomalyDetector detector(options);
+	auto now = std::chrono::steady_clock::now();
+
+	auto tick = [&](std::initializer_list<std::pair<const char*, double>> samples) {
+		now += std::chrono::minutes(1);
+		return detector.evaluate(test::batch(samples), now);
+	};
+
+	for (int i = 0; i != 10; ++i) {
+		CHECK(tick({ { "a", 10 }, { "ignored", 1 }, { "b", 20 }, { "c", 30 } }).empty());
+	}
+
+	// b has no sample for more than 10 minutes and is forgotten, a and c keep their baselines
+	for (int i = 0; i != 12; ++i) {
+		CHECK(tick({ { "a", 10 }, { "ignored", 1 }, { "c", 30 } }).empty());
+	}
+	auto events = tick({ { "a", 10 }, { "ignored", 1 }, { "c", 60 } });
+	CHECK_EQ(events.size(), 1u);
+	CHECK_EQ(events[0]->series(), std::string("anomaly.test.c"));
+
+	// so b starts over with a new warmup instead of being compared with its old baseline
+	CHECK(tick({ { "a", 10 }, { "b", 1000 }, { "c", 30 } }).empty());
+}
@@ -0,0 +1,52 @@
+#include "test.hpp"
+#include "burst_capture.hpp"
+#include <cmath>
+
+
+TEST(burst_period_means) {
+
+	BurstOptions options;
+	options.memory = 1 << 16;
+	BurstCapture capture(options);
+
+	// the stages get the mean of the period's batches rather than the last one, a missing value isn't counted
+	capture.record(test::batch({ { "a", 1 }, { "b", 10 } }));
+	capture.record(test::batch({ { "a", 2 }, { "b", std::nan("") } }));
+	capture.record(test::batch({ { "a", 6 }, { "b", 30 } }));
+	auto last = test::batch({ { "a", 3 }, { "b", 40 } });
+	capture.record(last);
+	capture.take_means(last);
+	CHECK_EQ(last[0]->get_value(), 3.0);
+	CHECK_EQ(last[1]->get_value(), 80.0 / 3);
+
+	// the next period starts over, and so does a new layout
+	capture.record(test::batch({ { "a", 5 }, { "b", 50 } }));
+	last = test::batch({ { "b", 7 } });
+	capture.record(last);
+	capture.take_means(last);
+	CHECK_EQ(last[0]->get_value(), 7.0);
+}
+
+
+TEST(burst_oversized_means) {
+
+	// 2 words of ring, a batch takes 2 + its values: nothing is kept, but the means are still the period's
+	BurstOptions options;
+	options.memory = 16;
+	BurstCapture capture(options);
+
+	capture.record(test::batch({ { "a", 1 }, { "b", 10 } }));
+	auto last = test::batch({ { "a", 3 }, { "b", 30 } });
+	capture.record(last);
+	capture.take_means(last);
+	CHECK_EQ(last[0]->get_value(), 2.0);
+	CHECK_EQ(last[1]->get_value(), 20.0);
+
+	// and start over with other series
+	capture.record(test::batch({ { "a", 5 }, { "b", 50 } }));
+	last = test::batch({ { "a", 7 }, { "c", 70 } });
+	capture.record(last);
+	capture.take_means(last);
+	CHECK_EQ(last[0]->get_value(), 7.0);
+	CHECK_EQ(last[1]->get_value(), 70.0);
+}
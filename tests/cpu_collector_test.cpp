@@ -0,0 +1,83 @@
+#include "test.hpp"
+#include "collector.hpp"
+#include <filesystem>
+#include <fstream>
+#include <cmath>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+
+namespace {
+
+	// a /proc with only "stat", rewritten in place between ticks as the files stay open; removed with the object
+	struct ProcTree {
+
+		ProcTree()
+			: root(fs::temp_directory_path() / ("cpu_collector_test-" + std::to_string(::getpid())))
+		{
+			fs::remove_all(root);
+			fs::create_directory(root);
+		}
+
+		~ProcTree() {
+			std::error_code ec;
+			fs::remove_all(root, ec);
+		}
+
+		// the fixture without the lines that start with `drop`
+		void stat(const std::string& fixture, const std::string& drop = "-") const {
+
+			std::ifstream in(FIXTURES_DIR "/proc/" + fixture);
+			std::ofstream out(root / "stat");
+			std::string line;
+			while (std::getline(in, line)) {
+				if (line.compare(0, drop.size(), drop) != 0) out << line << "\n";
+			}
+		}
+
+		fs::path root;
+	};
+
+	double value(const SampleBatch& batch, const std::string& series) {
+
+		for (const auto& metric : batch.metrics) {
+			if (metric->series() == series) return metric->get_value();
+		}
+		return std::nan("");
+	}
+
+}
+
+
+TEST(cpu_offline) {
+
+	ProcTree proc;
+	proc.stat("stat");
+
+	ProcSnapshot snapshot(proc.root.string());
+	SelfStats self;
+	CollectorContext context{ snapshot, self };
+	auto collector = CollectorRegistry::create("cpu");
+	collector->configure(json::parse(R"({ "type": "cpu", "ids": [0, 2, 3] })"));
+	collector->prepare(context);
+
+	// cpu2 goes offline: it has no sample, and cpu3 is still read from its own line
+	proc.stat("stat-cpu2-offline");
+	snapshot.next_tick();
+	SampleBatch batch;
+	collector->collect(batch);
+	CHECK_EQ(batch.metrics.size(), 2u);
+	CHECK_NEAR(value(batch, "cpu.0"), 50.0, 1e-9);
+	CHECK_NEAR(value(batch, "cpu.3"), 75.0, 1e-9);
+	CHECK(batch.layout_changed);
+
+	// the highest cpu goes offline as well, which isn't an invalid id
+	proc.stat("stat-cpu2-offline", "cpu3 ");
+	snapshot.next_tick();
+	SampleBatch next;
+	collector->collect(next);
+	CHECK_EQ(next.metrics.size(), 1u);
+	CHECK_EQ(next.metrics[0]->series(), std::string("cpu.0"));
+	CHECK(next.layout_changed);
+}
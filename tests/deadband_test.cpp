@@ -0,0 +1,55 @@
+#include "test.hpp"
+#include "deadband.hpp"
+
+
+namespace {
+
+	std::vector<std::string> names(const std::vector<const Metric*>& selected) {
+
+		std::vector<std::string> result;
+		for (const auto* metric : selected) {
+			result.push_back(metric->series());
+		}
+		return result;
+	}
+
+}
+
+
+TEST(deadband_filter) {
+
+	DeadbandOptions options;
+	options.absolute = 1;
+	options.heartbeat = std::chrono::seconds(60);
+	DeadbandFilter filter(options);
+	auto now = std::chrono::steady_clock::now();
+
+	CHECK_EQ(filter.filter(test::batch({ { "a", 1 }, { "b", 10 } }), now).size(), 2u);
+	CHECK(filter.filter(test::batch({ { "a", 1.5 }, { "b", 10 } }), now + std::chrono::seconds(1)).empty());
+
+	auto selected = names(filter.filter(test::batch({ { "a", 2.5 }, { "b", 10 } }), now + std::chrono::seconds(2)));
+	CHECK(selected == std::vector<std::string>{ "test.a" });
+
+	// b's heartbeat, a was written 58 s ago
+	selected = names(filter.filter(test::batch({ { "a", 2.5 }, { "b", 10 } }), now + std::chrono::seconds(60)));
+	CHECK(selected == std::vector<std::string>{ "test.b" });
+}
+
+
+TEST(deadband_eviction) {
+
+	DeadbandOptions options;
+	options.heartbeat = std::chrono::milliseconds(0);
+	DeadbandFilter filter(options);
+	auto now = std::chrono::steady_clock::now();
+
+	CHECK_EQ(filter.filter(test::batch({ { "a", 1 }, { "b", 2 }, { "c", 3 } }), now).size(), 3u);
+	CHECK(filter.filter(test::batch({ { "a", 1 }, { "c", 3 } }), now + std::chrono::minutes(5)).empty());
+
+	// b is forgotten after 10 minutes without a sample, a and c keep their last values across the compaction
+	CHECK(filter.filter(test::batch({ { "a", 1 }, { "c", 3 } }), now + std::chrono::minutes(11)).empty());
+
+	auto selected = names(filter.filter(test::batch({ { "a", 1 }, { "b", 2 }, { "c", 3 } }), now + std::chrono::minutes(12)));
+	CHECK(selected == std::vector<std::string>{ "test.b" });
+	CHECK(filter.filter(test::batch({ { "a", 1 }, { "b", 2 }, { "c", 3 } }), now + std::chrono::minutes(13)).empty());
+}
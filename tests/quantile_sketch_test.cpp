@@ -0,0 +1,107 @@
+#include "test.hpp"
+#include "quantile_sketch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+	// every quantile is within `accuracy` of the exact value of the same rank, q * (n - 1) in the sorted order
+	void check_quantiles(std::vector<double> values, double accuracy, std::initializer_list<double> qs = { 0.0, 0.5, 0.9, 0.99 }) {
+
+		QuantileSketch sketch(accuracy);
+		for (double value : values) {
+			sketch.add(value);
+		}
+		std::sort(values.begin(), values.end());
+
+		CHECK_EQ(sketch.count(), values.size());
+		CHECK_EQ(sketch.max(), values.back());
+
+		for (double q : qs) {
+
+			double exact = values[static_cast<std::size_t>(q * (values.size() - 1))];
+			CHECK_NEAR(sketch.quantile(q), exact, accuracy * std::fabs(exact) * (1 + 1e-9));
+		}
+	}
+
+}
+
+
+TEST(sketch_uniform) {
+
+	std::mt19937_64 random(41);
+	std::uniform_real_distribution<double> uniform(0.5, 100.0);
+
+	std::vector<double> values(100000);
+	for (auto& value : values) value = uniform(random);
+
+	check_quantiles(values, 0.01);
+	check_quantiles(values, 0.005);
+
+	// at 0.1% MAX_BINS only spans a factor of ~60, the lowest buckets are collapsed and the rest stays accurate
+	check_quantiles(values, 0.001, { 0.5, 0.9, 0.99 });
+}
+
+
+TEST(sketch_lognormal) {
+
+	// latencies: a long tail over several orders of magnitude
+	std::mt19937_64 random(42);
+	std::lognormal_distribution<double> lognormal(0.0, 2.0);
+
+	std::vector<double> values(100000);
+	for (auto& value : values) value = lognormal(random);
+
+	check_quantiles(values, 0.01);
+	check_quantiles(values, 0.02);
+}
+
+
+TEST(sketch_constant) {
+
+	check_quantiles(std::vector<double>(1000, 42.0), 0.01);
+	check_quantiles(std::vector<double>(1000, -3.5), 0.01);
+	check_quantiles(std::vector<double>(1000, 0.0), 0.01);
+}
+
+
+TEST(sketch_nan) {
+
+	// missing samples, the first one among them, are neither counted nor the maximum
+	QuantileSketch sketch(0.01);
+	sketch.add(std::nan(""));
+	for (double value : { 10.0, 20.0, 30.0 }) {
+		sketch.add(value);
+		sketch.add(std::nan(""));
+	}
+	CHECK_EQ(sketch.count(), 3u);
+	CHECK_EQ(sketch.max(), 30.0);
+	CHECK_NEAR(sketch.quantile(0.0), 10.0, 0.1);
+	CHECK_NEAR(sketch.quantile(0.5), 20.0, 0.2);
+}
+
+
+TEST(sketch_merge) {
+
+	std::mt19937_64 random(43);
+	std::normal_distribution<double> normal(0.0, 50.0); // both signs and the zero bucket
+
+	std::vector<double> values(20000);
+	QuantileSketch a, b;
+	for (std::size_t i = 0; i != values.size(); ++i) {
+		values[i] = normal(random);
+		(i % 2 ? a : b).add(values[i]);
+	}
+	a.merge(b);
+	std::sort(values.begin(), values.end());
+
+	CHECK_EQ(a.count(), values.size());
+	for (double q : { 0.1, 0.5, 0.9, 0.99 }) {
+
+		double exact = values[static_cast<std::size_t>(q * (values.size() - 1))];
+		CHECK_NEAR(a.quantile(q), exact, 0.01 * std::fabs(exact) * (1 + 1e-9));
+	}
+}
@@ -0,0 +1,43 @@
+#include "test.hpp"
+#include "series_slots.hpp"
+
+
+TEST(slots_layouts) {
+
+	SeriesSlots slots("test");
+	auto a = slots.add("test.a");
+	auto c = slots.add("test.c");
+
+	slots.read(test::batch({ { "a", 1 }, { "b", 2 }, { "c", 3 } }));
+	CHECK_EQ(slots[a], 1.0);
+	CHECK_EQ(slots[c], 3.0);
+
+	// another layout, then the first one again from its kept binding
+	slots.read(test::batch({ { "c", 30 } }));
+	CHECK(std::isnan(slots[a]));
+	CHECK_EQ(slots[c], 30.0);
+
+	slots.read(test::batch({ { "a", 4 }, { "b", 5 }, { "c", 6 } }));
+	CHECK_EQ(slots[a], 4.0);
+	CHECK_EQ(slots[c], 6.0);
+}
+
+
+TEST(slots_replaced_series) {
+
+	SeriesSlots slots("test");
+	auto b = slots.add("test.b");
+
+	slots.read(test::batch({ { "a", 1 }, { "b", 2 } }));
+	CHECK_EQ(slots[b], 2.0);
+
+	// "b" is replaced by "x" of the same type at the same position: the size and the types still match, only the
+	// collector's layout_changed tells the binding apart
+	SeriesSlots::series_changed();
+	slots.read(test::batch({ { "a", 1 }, { "x", 7 } }));
+	CHECK(std::isnan(slots[b]));
+
+	SeriesSlots::series_changed();
+	slots.read(test::batch({ { "a", 1 }, { "b", 8 } }));
+	CHECK_EQ(slots[b], 8.0);
+}
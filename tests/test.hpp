@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cmath>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "metrics.hpp"
+
+
+// a minimal test registry: every TEST(name) is a function registered under its name, the unit_tests binary
+// runs the one given on its command line (or all of them), CMakeLists.txt adds one ctest test per name
+namespace test {
+
+	inline std::map<std::string, std::function<void()>>& registry() {
+
+		static std::map<std::string, std::function<void()>> tests;
+		return tests;
+	}
+
+	struct Register {
+		Register(const char* name, std::function<void()> body) {
+			registry().emplace(name, std::move(body));
+		}
+	};
+
+	struct Failure : std::runtime_error {
+		using std::runtime_error::runtime_error;
+	};
+
+	template<typename A, typename B>
+	void fail(const char* file, int line, const char* expression, const A& actual, const B& expected) {
+
+		std::ostringstream message;
+		message << file << ":" << line << ": " << expression << ": got " << actual << ", expected " << expected;
+		throw Failure(message.str());
+	}
+
+	// a tick's batch of PluginMetric samples, the series are "test.<name>"
+	inline std::vector<std::unique_ptr<Metric>> batch(std::initializer_list<std::pair<const char*, double>> samples) {
+
+		std::vector<std::unique_ptr<Metric>> metrics;
+		for (const auto& [name, value] : samples) {
+			metrics.emplace_back(new PluginMetric("test", name, value));
+		}
+		return metrics;
+	}
+
+}
+
+
+#define TEST(name) \
+	static void test_##name(); \
+	static test::Register register_##name(#name, test_##name); \
+	static void test_##name()
+
+#define CHECK(condition) \
+	do { if (!(condition)) test::fail(__FILE__, __LINE__, #condition, "false", "true"); } while (0)
+
+#define CHECK_EQ(actual, expected) \
+	do { if (!((actual) == (expected))) test::fail(__FILE__, __LINE__, #actual, (actual), (expected)); } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+	do { if (!(std::fabs((actual) - (expected)) <= (tolerance))) test::fail(__FILE__, __LINE__, #actual, (actual), (expected)); } while (0)
@@ -0,0 +1,173 @@
+#include "test.hpp"
+#include "thermal_stats.hpp"
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+
+namespace {
+
+	// a writable copy of tests/fixtures/sysfs, removed with the object
+	struct SysfsCopy {
+
+		SysfsCopy()
+			: root(fs::temp_directory_path() / ("thermal_stats_test-" + std::to_string(::getpid())))
+		{
+			fs::remove_all(root);
+			fs::copy(FIXTURES_DIR "/sysfs", root, fs::copy_options::recursive);
+		}
+
+		~SysfsCopy() {
+			std::error_code ec;
+			fs::remove_all(root, ec);
+		}
+
+		void write(const std::string& path, const std::string& value) const {
+			std::ofstream(root / path) << value << "\n";
+		}
+
+		// the attribute still opens, but every read fails (EISDIR), like a sensor that returns EIO
+		void make_unreadable(const std::string& path) const {
+			fs::remove(root / path);
+			fs::create_directory(root / path);
+		}
+
+		fs::path root;
+	};
+
+	const SensorTemp* find(const ThermalSample& sample, const std::string& sensor) {
+
+		for (const auto& s : sample.sensors) {
+			if (s.sensor == sensor) return &s;
+		}
+		return nullptr;
+	}
+
+}
+
+
+TEST(thermal_cpus) {
+
+	SysfsCopy sysfs;
+	ThermalStatsReader reader({}, {}, sysfs.root.string());
+
+	// cpu2 is offline, cpu1 has no thermal_throttle
+	const auto& first = reader.sample();
+	CHECK_EQ(first.cpus.size(), 2u);
+	CHECK_EQ(first.cpus[0].cpu, 0);
+	CHECK_EQ(first.cpus[1].cpu, 1);
+	CHECK(first.cpus[0].has_freq && first.cpus[0].has_throttle && first.cpus[0].has_package_throttle);
+	CHECK(first.cpus[1].has_freq && !first.cpus[1].has_throttle && !first.cpus[1].has_package_throttle);
+	CHECK_NEAR(first.cpus[0].freq, 2400.0, 1e-9);
+	CHECK_NEAR(first.cpus[1].freq, 1800.0, 1e-9);
+	CHECK_EQ(first.cpus[0].core_throttle, 0.0);
+
+	sysfs.write("devices/system/cpu/cpu0/cpufreq/scaling_cur_freq", "3100000");
+	sysfs.write("devices/system/cpu/cpu0/thermal_throttle/core_throttle_count", "1005");
+	sysfs.write("devices/system/cpu/cpu0/thermal_throttle/package_throttle_count", "7");
+	::usleep(10000);
+
+	const auto& second = reader.sample();
+	CHECK_NEAR(second.cpus[0].freq, 3100.0, 1e-9);
+	CHECK(second.cpus[0].core_throttle > 0 && second.cpus[0].core_throttle <= 1000 / 0.01);
+	CHECK_EQ(second.cpus[0].package_throttle, 0.0);
+}
+
+
+TEST(thermal_hwmon) {
+
+	SysfsCopy sysfs;
+	ThermalStatsReader reader({ 0 }, { "*" }, sysfs.root.string());
+	const auto& sample = reader.sample();
+
+	// in hwmon order, temp2 before temp10; zones after hwmon
+	const char* expected[] = { "coretemp/Package id 0", "coretemp/Core 0", "coretemp/Core 8", "nvme/temp1", "hwmon2/temp1",
+		"acpitz/zone0", "x86_pkg_temp/zone1" };
+	CHECK_EQ(sample.sensors.size(), std::size(expected));
+	for (std::size_t i = 0; i != sample.sensors.size() && i != std::size(expected); ++i) {
+		CHECK_EQ(sample.sensors[i].sensor, std::string(expected[i]));
+	}
+
+	CHECK_NEAR(find(sample, "coretemp/Package id 0")->temp, 45.0, 1e-9);
+	CHECK_NEAR(find(sample, "nvme/temp1")->temp, 38.85, 1e-9);
+	CHECK_NEAR(find(sample, "hwmon2/temp1")->temp, -5.25, 1e-9); // no "name", negative
+}
+
+
+TEST(thermal_zone) {
+
+	SysfsCopy sysfs;
+	ThermalStatsReader reader({ 0 }, { "*/zone*" }, sysfs.root.string());
+
+	// zone2 has no "temp", the cooling devices next to the zones aren't sensors
+	const auto& sample = reader.sample();
+	CHECK_EQ(sample.sensors.size(), 2u);
+	CHECK_NEAR(find(sample, "acpitz/zone0")->temp, 27.8, 1e-9);
+	CHECK_NEAR(find(sample, "x86_pkg_temp/zone1")->temp, 52.0, 1e-9);
+
+	sysfs.write("class/thermal/thermal_zone1/temp", "61500");
+	CHECK_NEAR(find(reader.sample(), "x86_pkg_temp/zone1")->temp, 61.5, 1e-9);
+}
+
+
+TEST(thermal_missing) {
+
+	SysfsCopy sysfs;
+
+	// only the label of nvme's temp3 exists
+	ThermalStatsReader reader({ 0 }, { "nvme/*" }, sysfs.root.string());
+	CHECK_EQ(reader.sample().sensors.size(), 1u);
+
+	// the two throttle counters are independent
+	fs::remove(sysfs.root / "devices/system/cpu/cpu0/thermal_throttle/package_throttle_count");
+	ThermalStatsReader core_only({ 0 }, {}, sysfs.root.string());
+	CHECK(core_only.sample().cpus[0].has_throttle && !core_only.sample().cpus[0].has_package_throttle);
+
+	fs::remove_all(sysfs.root / "devices/system/cpu/cpu0/thermal_throttle");
+	fs::remove(sysfs.root / "devices/system/cpu/cpu0/cpufreq/scaling_cur_freq");
+	fs::remove_all(sysfs.root / "class/hwmon/hwmon1");
+	ThermalStatsReader bare({ 0 }, { "nvme/*", "coretemp/Core 0" }, sysfs.root.string());
+	const auto& sample = bare.sample();
+	CHECK(!sample.cpus[0].has_freq && !sample.cpus[0].has_throttle);
+	CHECK_EQ(sample.sensors.size(), 1u);
+
+	// nothing left to report
+	bool thrown = false;
+	try {
+		ThermalStatsReader({ 0 }, { "nvme/*" }, sysfs.root.string());
+	}
+	catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+
+	thrown = false;
+	try {
+		ThermalStatsReader({ 7 }, {}, sysfs.root.string());
+	}
+	catch (const std::invalid_argument&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+}
+
+
+TEST(thermal_unreadable) {
+
+	SysfsCopy sysfs;
+	sysfs.make_unreadable("class/hwmon/hwmon0/temp2_input");
+	sysfs.make_unreadable("class/thermal/thermal_zone0/temp");
+	sysfs.make_unreadable("devices/system/cpu/cpu0/thermal_throttle/core_throttle_count");
+
+	// the unreadable attributes are skipped instead of failing every batch read
+	ThermalStatsReader reader({ 0 }, { "coretemp/*", "*/zone*" }, sysfs.root.string());
+	const auto& sample = reader.sample();
+
+	CHECK(sample.cpus[0].has_freq && !sample.cpus[0].has_throttle);
+	CHECK_EQ(sample.sensors.size(), 3u);
+	CHECK(find(sample, "coretemp/Core 0") == nullptr);
+	CHECK(find(sample, "acpitz/zone0") == nullptr);
+	CHECK_NEAR(find(sample, "coretemp/Core 8")->temp, 44.5, 1e-9);
+}
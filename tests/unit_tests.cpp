@@ -0,0 +1,33 @@
+// the unit tests, built by CMakeLists.txt as unit_tests and run by ctest:
+//   ./unit_tests [test]
+// without a name every test is run
+
+#include "test.hpp"
+
+
+int main(int argc, char* argv[]) {
+
+	int failed = 0;
+	int run = 0;
+
+	for (const auto& [name, body] : test::registry()) {
+
+		if (argc > 1 && name != argv[1]) continue;
+
+		++run;
+		try {
+			body();
+			std::cout << "ok    " << name << std::endl;
+		}
+		catch (const std::exception& ex) {
+			std::cout << "FAIL  " << name << ": " << ex.what() << std::endl;
+			++failed;
+		}
+	}
+
+	if (run == 0) {
+		std::cerr << "Error : no test named " << (argc > 1 ? argv[1] : "") << std::endl;
+		return 1;
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,40 @@
+#include "test.hpp"
+#include "vm_stats.hpp"
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+
+TEST(vmstat_layout) {
+
+	auto path = fs::temp_directory_path() / ("vm_stats_test-" + std::to_string(::getpid()));
+	auto write = [&](const char* text) {
+		std::ofstream(path) << text; // in place, the file stays open
+	};
+
+	write("nr_free_pages 100\npgfault 1000\npgmajfault 10\n");
+	ProcSnapshot snapshot;
+	VmStatsReader reader({ "nr_free_pages", "pgfault", "pgmajfault" }, snapshot.file(path.string()));
+	std::vector<VmRate> rates;
+	reader.sample(rates);
+	CHECK_EQ(rates.size(), 3u);
+
+	// a new field shifts the lines: the table is compiled again and the tick still has every field, with
+	// the rates against the previous values
+	::usleep(10000);
+	write("nr_free_pages 90\nnr_new 5\npgfault 2000\npgmajfault 10\n");
+	snapshot.next_tick();
+	reader.sample(rates);
+
+	CHECK_EQ(rates.size(), 3u);
+	CHECK_EQ(rates[0].field, std::string("nr_free_pages"));
+	CHECK_EQ(rates[0].value, 90.0);
+	CHECK_EQ(rates[1].field, std::string("pgfault"));
+	CHECK(rates[1].value > 0 && rates[1].value <= 1000 / 0.01);
+	CHECK_EQ(rates[2].field, std::string("pgmajfault"));
+	CHECK_EQ(rates[2].value, 0.0);
+
+	fs::remove(path);
+}
@@ -0,0 +1,137 @@
+#include "test.hpp"
+#include "window_kernels.hpp"
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+
+// every implementation the CPU supports has to return bit-for-bit the results of the scalar one, on the
+// vector bodies, the tails (sizes that aren't a multiple of the lane count) and the NaN lanes
+namespace {
+
+	constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+	constexpr double INF = std::numeric_limits<double>::infinity();
+
+	bool same_bits(const std::vector<double>& a, const std::vector<double>& b) {
+		return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(double)) == 0;
+	}
+
+	bool supported(window_kernels::Isa isa) {
+		return window_kernels::get(isa) && isa <= window_kernels::best();
+	}
+
+	struct Stats {
+
+		explicit Stats(std::size_t series) : min(series, INF), max(series, -INF), sum(series, 0), sumsq(series, 0) {}
+
+		bool same(const Stats& other) const {
+			return same_bits(min, other.min) && same_bits(max, other.max) && same_bits(sum, other.sum) && same_bits(sumsq, other.sumsq);
+		}
+
+		std::vector<double> min, max, sum, sumsq;
+	};
+
+	// one window, tick after tick, as the Aggregator does it
+	Stats fold(window_kernels::Accumulate accumulate, const std::vector<double>& columns, std::size_t series) {
+
+		Stats stats(series);
+		for (std::size_t offset = 0; offset != columns.size(); offset += series) {
+			accumulate(columns.data() + offset, series, stats.min.data(), stats.max.data(), stats.sum.data(), stats.sumsq.data());
+		}
+		return stats;
+	}
+
+	constexpr std::size_t PHASES = 12;
+
+	struct Baselines {
+
+		explicit Baselines(std::size_t series)
+			: level(series), trend(series), season(series * PHASES), var(series), seen(series), forecast(series), score(series)
+		{}
+
+		bool same(const Baselines& other) const {
+			return same_bits(level, other.level) && same_bits(trend, other.trend) && same_bits(season, other.season)
+				&& same_bits(var, other.var) && same_bits(seen, other.seen) && same_bits(forecast, other.forecast)
+				&& same_bits(score, other.score);
+		}
+
+		std::vector<double> level, trend, season, var, seen, forecast, score;
+	};
+
+	// the tick's value of every series: a season of PHASES ticks, noise, a spike now and then, some missing values
+	void fill(std::vector<double>& values, std::size_t tick) {
+
+		for (std::size_t i = 0; i != values.size(); ++i) {
+
+			auto h = (i * 2654435761u + tick * 40503u) % 1000;
+			double value = 10 * static_cast<double>((tick + i) % PHASES) + static_cast<double>(h) / 100;
+			values[i] = h == 7 ? NaN : h == 3 ? value + 500 : value;
+		}
+	}
+
+	// the same ticks through both implementations, compared after every tick since `score` and `forecast` are
+	// per-tick outputs
+	void compare_baselines(window_kernels::Update update, window_kernels::Update reference_update, std::size_t series, std::size_t ticks) {
+
+		const window_kernels::BaselineParams params{ 0.1, 0.01, 0.2, 9, 0.01, 24 };
+		Baselines state(series), reference(series);
+		std::vector<double> values(series);
+
+		for (std::size_t tick = 0; tick != ticks; ++tick) {
+
+			fill(values, tick);
+
+			auto columns = [&](Baselines& s) {
+				return window_kernels::BaselineColumns{ s.level.data(), s.trend.data(), s.season.data() + tick % PHASES * series
+					, s.var.data(), s.seen.data(), s.forecast.data(), s.score.data() };
+			};
+			update(values.data(), series, params, columns(state));
+			reference_update(values.data(), series, params, columns(reference));
+			CHECK(state.same(reference));
+		}
+	}
+
+}
+
+
+TEST(kernels_accumulate_exact) {
+
+	// per-core loads in percent with some negative, missing and infinite values
+	std::mt19937_64 random(42);
+	std::normal_distribution<double> load(50, 30);
+
+	for (std::size_t series : { 1u, 3u, 4u, 7u, 9u, 256u, 1001u }) {
+
+		std::vector<double> columns(series * 100);
+		for (std::size_t i = 0; i != columns.size(); ++i) {
+			columns[i] = i % 50 == 7 ? NaN : i % 997 == 5 ? -INF : load(random);
+		}
+
+		auto reference = fold(window_kernels::get(window_kernels::Isa::scalar), columns, series);
+
+		for (auto isa : { window_kernels::Isa::sse4, window_kernels::Isa::avx2 }) {
+
+			if (!supported(isa)) {
+				std::cout << "      " << window_kernels::name(isa) << " isn't supported, skipped" << std::endl;
+				continue;
+			}
+			CHECK(fold(window_kernels::get(isa), columns, series).same(reference));
+		}
+	}
+}
+
+
+TEST(kernels_update_exact) {
+
+	if (!supported(window_kernels::Isa::avx2)) {
+		std::cout << "      avx2 isn't supported, nothing to compare" << std::endl;
+		return;
+	}
+
+	for (std::size_t series : { 1u, 3u, 4u, 5u, 1000u, 4099u }) {
+
+		compare_baselines(window_kernels::get_update(window_kernels::Isa::avx2), window_kernels::get_update(window_kernels::Isa::scalar)
+			, series, 600);
+	}
+}